@@ -0,0 +1,326 @@
+/*
+ * @file   pipeline_bench.cpp
+ * @brief  End-to-end throughput benchmark of pipelines built by sys_builder,
+ *         either out of a JSON configuration file or generated with a given
+ *         graph shape, packet length, packet count and item type.
+ *
+ * Usage: pipeline_bench [options]
+ *   --config <file>      run the pipeline of a JSON configuration file
+ *   --shape <shape>      generated graph: chain (default), fanin or fanout
+ *   --depth <n>          adders of a chain (default 4)
+ *   --width <n>          sources of a fan-in (power of two) or branches of a fan-out (default 4)
+ *   --paket-len <n>      items per packet (default 4096)
+ *   --pakets <n>         packets per run (default 256)
+ *   --type <type>        item type, e.g. UINT8, INT32, FLOAT, COMPLEX_FLOAT (default UINT8)
+ *   --reps <n>           runs, the fastest one is reported (default 5)
+ *   --no-fusion          disable __fusion__
+ *   --replicas <n>       run every adder by <n> replicas (__replicas__), on as many threads
+ *   --dispatch <policy>  dispatch of the replicas, ROUND_ROBIN (default) or LEAST_LOADED
+ *   --log                connect every node to the logger
+ *   --stages             per-stage breakdown, through __instrumentation__
+ *   --json <file>        also write the results as JSON
+ *
+ * The generated graphs only use the vector source, adder and vector sink nodes:
+ *   chain:  src_0000 -> add_0000.Proc -> ... -> add_<depth-1> -> sink, adder k
+ *           taking its In1 from source k+1
+ *   fanin:  <width> sources reduced by a binary tree of adders into one sink
+ *   fanout: one source feeding the Proc port of <width> adders, each with its
+ *           own In1 source and sink
+ * The sources are started in name order, so the In1 sources of an adder are
+ * always named before the source which triggers its Proc port.
+ */
+
+#include "sys_builder.h"
+#include "logging.h"
+#include "json11.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace {
+
+using json11::Json;
+
+struct bench_options
+{
+  std::string config;
+  std::string shape = "chain";
+  int depth = 4;
+  int width = 4;
+  int paketLen = 4096;
+  int pakets = 256;
+  std::string type = "UINT8";
+  int reps = 5;
+  bool fusion = true;
+  int replicas = 0;
+  std::string dispatch;
+  bool log = false;
+  bool stages = false;
+  std::string jsonFile;
+};
+
+std::string node_name(const char* prefix, int k)
+{
+  char buf[32];
+  std::snprintf(buf, sizeof(buf), "%s_%04d", prefix, k);
+  return buf;
+}
+
+class graph_generator
+{
+private:
+  const bench_options& opt_;
+  Json::object nodes_;
+
+  Json connections(const std::vector<std::vector<std::string>>& to) const
+  {
+    Json::object con;
+    int k = 0;
+    for (auto const& c : to)
+      con[std::to_string(++k)] = Json(Json::array(c.begin(), c.end()));
+    if (opt_.log)
+      con[std::to_string(++k)] = Json(Json::array{"logger", "", ""});
+    return Json(con);
+  }
+
+public:
+  explicit graph_generator(const bench_options& opt) : opt_(opt) {}
+
+  void src(const std::string& name, const std::vector<std::vector<std::string>>& to)
+  {
+    nodes_[name] = Json::object{
+      {"__proc_type__", "SRC_VEC_PROC"}, {"__out_data_type__", opt_.type},
+      {"__out_vector_size__", opt_.paketLen}, {"__trig_start__", true},
+      {"__adjacency_connection_to__", connections(to)},
+      {"__repeat__", false}, {"__vlen__", opt_.paketLen}};
+  }
+
+  void adder(const std::string& name, const std::vector<std::vector<std::string>>& to)
+  {
+    Json::object node{
+      {"__proc_type__", "ADDER_PROC"}, {"__out_data_type__", opt_.type},
+      {"__out_vector_size__", opt_.paketLen}, {"__trig_start__", false},
+      {"__adjacency_connection_to__", connections(to)}};
+    if (opt_.replicas > 0)
+      node["__replicas__"] = opt_.replicas;
+    if (!opt_.dispatch.empty())
+      node["__replica_dispatch__"] = opt_.dispatch;
+    nodes_[name] = Json(node);
+  }
+
+  void sink(const std::string& name)
+  {
+    nodes_[name] = Json::object{
+      {"__proc_type__", "SINK_VEC_PROC"}, {"__in_data_type__", opt_.type}, {"__out_data_type__", opt_.type},
+      {"__out_vector_size__", opt_.paketLen}, {"__trig_start__", false},
+      {"__adjacency_connection_to__", connections({})}};
+  }
+
+  Json build()
+  {
+    if (opt_.shape == "chain") {
+      // the In1 sources come first, the Proc source of the head is started last
+      for (int k = 0; k < opt_.depth; k++)
+        src(node_name("src", k), {{node_name("add", k), "NewData", "In1"}});
+      src(node_name("src", opt_.depth), {{node_name("add", 0), "NewData", "Proc"}});
+      for (int k = 0; k < opt_.depth; k++)
+        adder(node_name("add", k), {{k + 1 < opt_.depth ? node_name("add", k + 1) : "sink", "NewData", "Proc"}});
+      sink("sink");
+    } else if (opt_.shape == "fanin") {
+      // leaves first: node n of the tree has children 2n+1 (In1) and 2n+2 (Proc)
+      const int leaves = opt_.width;
+      const int adders = leaves - 1;
+      for (int k = 0; k < leaves; k++) {
+        const int parent = (adders + k - 1) / 2;
+        src(node_name("src", k), {{node_name("add", parent), "NewData", (adders + k) % 2 ? "In1" : "Proc"}});
+      }
+      for (int n = 0; n < adders; n++) {
+        if (n == 0)
+          adder(node_name("add", n), {{"sink", "NewData", "Proc"}});
+        else
+          adder(node_name("add", n), {{node_name("add", (n - 1) / 2), "NewData", n % 2 ? "In1" : "Proc"}});
+      }
+      sink("sink");
+    } else if (opt_.shape == "fanout") {
+      std::vector<std::vector<std::string>> to;
+      for (int k = 0; k < opt_.width; k++) {
+        src(node_name("src", k), {{node_name("add", k), "NewData", "In1"}});
+        adder(node_name("add", k), {{node_name("sink", k), "NewData", "Proc"}});
+        sink(node_name("sink", k));
+        to.push_back({node_name("add", k), "NewData", "Proc"});
+      }
+      src(node_name("src", opt_.width), to);
+    } else {
+      throw std::invalid_argument("unknown graph shape: " + opt_.shape);
+    }
+
+    if (opt_.log)
+      nodes_["logger"] = Json::object{{"__proc_type__", "LOGGER"}};
+
+    return Json(nodes_);
+  }
+};
+
+Json with_general(const Json& cfg, const bench_options& opt)
+{
+  Json::object root = cfg.object_items();
+  Json::object general = cfg["__general__"].object_items();
+  general["__fusion__"] = opt.fusion;
+  general["__instrumentation__"] = opt.stages;
+  root["__general__"] = Json(general);
+  return Json(root);
+}
+
+Json make_config(const bench_options& opt)
+{
+  if (!opt.config.empty()) {
+    std::ifstream t(opt.config);
+    std::string text((std::istreambuf_iterator<char>(t)), std::istreambuf_iterator<char>());
+    std::string err;
+    Json cfg = Json::parse(text, err);
+    if (!err.empty())
+      throw std::invalid_argument(opt.config + ": " + err);
+    return with_general(cfg, opt);
+  }
+
+  graph_generator gen(opt);
+  Json cfg = Json::object{
+    {"__sim_model_info__", Json::object{{"__name__", "pipeline_bench_" + opt.shape}}},
+    {"__general__", Json::object{{"__paket_len__", opt.paketLen}, {"__num_of_paket__", opt.pakets}}},
+    {"__processors__", gen.build()}};
+  return with_general(cfg, opt);
+}
+
+struct stage_result
+{
+  std::string name;
+  uint64_t calls;
+  double meanNs;
+  uint64_t p99Ns;
+  double itemsPerSec;
+  double busyShare; //< share of the run time spent in this stage (self time)
+};
+
+int parse_args(int argc, char* argv[], bench_options& opt)
+{
+  for (int i = 1; i < argc; i++) {
+    auto value = [&](const char* name) -> const char* {
+      if (i + 1 >= argc)
+        throw std::invalid_argument(std::string("missing value of ") + name);
+      return argv[++i];
+    };
+    if      (!std::strcmp(argv[i], "--config"))    opt.config = value("--config");
+    else if (!std::strcmp(argv[i], "--shape"))     opt.shape = value("--shape");
+    else if (!std::strcmp(argv[i], "--depth"))     opt.depth = std::max(1, std::atoi(value("--depth")));
+    else if (!std::strcmp(argv[i], "--width"))     opt.width = std::max(2, std::atoi(value("--width")));
+    else if (!std::strcmp(argv[i], "--paket-len")) opt.paketLen = std::max(1, std::atoi(value("--paket-len")));
+    else if (!std::strcmp(argv[i], "--pakets"))    opt.pakets = std::max(1, std::atoi(value("--pakets")));
+    else if (!std::strcmp(argv[i], "--type"))      opt.type = value("--type");
+    else if (!std::strcmp(argv[i], "--reps"))      opt.reps = std::max(1, std::atoi(value("--reps")));
+    else if (!std::strcmp(argv[i], "--no-fusion")) opt.fusion = false;
+    else if (!std::strcmp(argv[i], "--replicas"))  opt.replicas = std::max(0, std::atoi(value("--replicas")));
+    else if (!std::strcmp(argv[i], "--dispatch"))  opt.dispatch = value("--dispatch");
+    else if (!std::strcmp(argv[i], "--log"))       opt.log = true;
+    else if (!std::strcmp(argv[i], "--stages"))    opt.stages = true;
+    else if (!std::strcmp(argv[i], "--json"))      opt.jsonFile = value("--json");
+    else return i;
+  }
+
+  if (opt.shape == "fanin" && (opt.width & (opt.width - 1)) != 0)
+    throw std::invalid_argument("the width of a fan-in must be a power of two");
+  return 0;
+}
+
+} // namespace
+
+int main(int argc, char* argv[])
+{
+  bench_options opt;
+  Json cfg;
+  try {
+    if (int bad = parse_args(argc, argv, opt)) {
+      std::cerr << "Unknown option " << argv[bad] << ", see the head of pipeline_bench.cpp\n";
+      return 1;
+    }
+    cfg = make_config(opt);
+  }
+  catch (const std::exception& e) {
+    std::cerr << e.what() << "\n";
+    return 1;
+  }
+
+  pl_proc::PL_Log::StartLog("pipeline_bench", pl_proc::LogLevel::WARNING, "", pl_proc::EventLogFormat::BINARY);
+
+  const int pakets = std::max(1, cfg["__general__"]["__num_of_paket__"].int_value());
+  const int paketLen = cfg["__general__"]["__paket_len__"].int_value();
+
+  // the pipeline is built again for every run, outside of the timed section
+  double best = 0.0;
+  std::vector<stage_result> stages;
+  for (int rep = 0; rep < opt.reps; rep++) {
+    pl_proc::sys_builder sb(cfg);
+    sb.connect_pipeline_proc();
+    sb.connect_pipeline_2_logger();
+
+    const auto t0 = std::chrono::steady_clock::now();
+    sb.run_sim();
+    pl_proc::PL_Log::FlushLog();
+    const double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+    if (rep != 0 && secs >= best)
+      continue;
+
+    best = secs;
+    stages.clear();
+    if (!opt.stages)
+      continue;
+    for (auto const& node : cfg["__processors__"].object_items()) {
+      const pl_proc::proc_stats* st = sb.get_proc_stats(node.first);
+      if (st == nullptr)
+        continue;
+      const pl_proc::call_stats& cs = st->process_.calls() ? st->process_ : st->start_;
+      stages.push_back(stage_result{node.first, cs.calls(), cs.latency().mean(), cs.latency().percentile(99.0),
+                                    cs.items_per_sec(), cs.latency().sum() * 1e-9 / secs});
+    }
+  }
+
+  const double paketsPerSec = pakets / best;
+  const double samplesPerSec = paketsPerSec * paketLen;
+  std::printf("%s: %d pakets of %d items, best of %d runs: %.6f s, %.1f pakets/s, %.3e samples/s\n",
+              opt.config.empty() ? opt.shape.c_str() : opt.config.c_str(), pakets, paketLen, opt.reps,
+              best, paketsPerSec, samplesPerSec);
+  if (opt.stages) {
+    std::printf("%-16s %10s %12s %12s %14s %8s\n", "stage", "calls", "mean_ns", "p99_ns", "items/s", "busy%");
+    for (auto const& s : stages) {
+      if (s.calls == 0)
+        continue; // fused
+      std::printf("%-16s %10llu %12.1f %12llu %14.3e %7.1f%%\n", s.name.c_str(), (unsigned long long)s.calls,
+                  s.meanNs, (unsigned long long)s.p99Ns, s.itemsPerSec, 100.0 * s.busyShare);
+    }
+    std::printf("(the stages of a fused chain run inside their head and are not instrumented, nor replicated ones)\n");
+  }
+
+  if (!opt.jsonFile.empty()) {
+    Json::array jstages;
+    for (auto const& s : stages)
+      jstages.push_back(Json::object{{"name", s.name}, {"calls", double(s.calls)}, {"mean_ns", s.meanNs},
+                                     {"p99_ns", double(s.p99Ns)}, {"items_per_sec", s.itemsPerSec},
+                                     {"busy_share", s.busyShare}});
+    Json result = Json::object{
+      {"config", opt.config}, {"shape", opt.shape}, {"depth", opt.depth}, {"width", opt.width},
+      {"type", opt.type}, {"fusion", opt.fusion}, {"replicas", opt.replicas}, {"log", opt.log},
+      {"pakets", pakets}, {"paket_len", paketLen}, {"reps", opt.reps}, {"seconds", best},
+      {"pakets_per_sec", paketsPerSec}, {"samples_per_sec", samplesPerSec}, {"stages", jstages}};
+    std::ofstream fout(opt.jsonFile, std::ios::out | std::ios::trunc);
+    fout << result.dump() << "\n";
+  }
+
+  pl_proc::PL_Log::StopLog();
+  return 0;
+}
@@ -0,0 +1,372 @@
+/*
+ * @file   primitives_bench.cpp
+ * @brief  Micro-benchmarks of the pmt and processor primitives the pipeline
+ *         is built on. Run with --benchmark_out=<file> --benchmark_out_format=json
+ *         to get results which can be diffed across commits
+ *         (e.g. with tools/compare.py of Google Benchmark).
+ */
+
+#include <benchmark/benchmark.h>
+
+#include "pmt.h"
+#include "signal_slot.h"
+#include "processor_factory.h"
+#include "stream_tags.h"
+#include "logging.h"
+#include "object_id_map.h"
+#include "seq_tracker.h"
+#include "reorder_buffer.h"
+#include "util.h"
+
+#include <algorithm>
+#include <complex>
+#include <cstdint>
+#include <list>
+#include <mutex>
+#include <random>
+#include <string>
+#include <tuple>
+#include <unordered_map>
+#include <vector>
+
+namespace pl_proc {
+
+namespace {
+
+const std::list<std::tuple<std::string, std::string, std::string>> kNoCon;
+
+template <class T>
+void BM_MakeGenVector(benchmark::State& state)
+{
+  const size_t len = state.range(0);
+  for (auto _ : state) {
+    pmt::pmt_t v = pmt::make_genVector<T>(len, T(0));
+    benchmark::DoNotOptimize(v.get());
+  }
+  state.SetBytesProcessed(state.iterations() * len * sizeof(T));
+}
+
+template <class T>
+void BM_GenVectorRaw(benchmark::State& state)
+{
+  const size_t len = state.range(0);
+  pmt::pmt_t v = pmt::make_genVector<T>(len, T(1));
+  for (auto _ : state) {
+    const T* p = pmt::genVector_raw<T>(v);
+    benchmark::DoNotOptimize(p);
+  }
+}
+
+void BM_DictAdd(benchmark::State& state)
+{
+  const size_t n = state.range(0);
+  std::vector<pmt::pmt_t> keys;
+  for (size_t k = 0; k < n; k++)
+    keys.push_back(pmt::intern("key" + std::to_string(k)));
+  const pmt::pmt_t value = pmt::from_long(1);
+
+  for (auto _ : state) {
+    pmt::pmt_t dict = pmt::make_dict();
+    for (auto const& key : keys)
+      dict = pmt::dict_add(dict, key, value);
+    benchmark::DoNotOptimize(dict.get());
+  }
+  state.SetItemsProcessed(state.iterations() * n);
+}
+
+void BM_DictRef(benchmark::State& state)
+{
+  const size_t n = state.range(0);
+  std::vector<pmt::pmt_t> keys;
+  pmt::pmt_t dict = pmt::make_dict();
+  for (size_t k = 0; k < n; k++) {
+    keys.push_back(pmt::intern("key" + std::to_string(k)));
+    dict = pmt::dict_add(dict, keys.back(), pmt::from_long(k));
+  }
+  const pmt::pmt_t notFound = pmt::get_PMT_NIL();
+
+  for (auto _ : state) {
+    for (auto const& key : keys)
+      benchmark::DoNotOptimize(pmt::dict_ref(dict, key, notFound).get());
+  }
+  state.SetItemsProcessed(state.iterations() * n);
+}
+
+void BM_Intern(benchmark::State& state)
+{
+  const std::string name = "intern_bench_symbol";
+  pmt::intern(name);
+  for (auto _ : state)
+    benchmark::DoNotOptimize(pmt::intern(name).get());
+}
+
+void BM_SignalEmit(benchmark::State& state)
+{
+  const size_t nslots = state.range(0);
+  signal_slot<pmt::pmt_t&> sig;
+  uint64_t calls = 0;
+  for (size_t k = 0; k < nslots; k++)
+    sig.connect([&calls](pmt::pmt_t&) { calls++; });
+
+  pmt::pmt_t items = pmt::make_genVector<std::uint8_t>(16, 0);
+  for (auto _ : state)
+    sig.emit(items);
+  benchmark::DoNotOptimize(calls);
+  state.SetItemsProcessed(state.iterations() * nslots);
+}
+
+// emitNewTag with 0 (nobody logging) or 1 observer of the TAG signal.
+void BM_EmitNewTag(benchmark::State& state)
+{
+  const size_t len = 1024;
+  processor::sptr adder = proc_factory::createADDER("UINT8", 1, std::string("adder"), kNoCon, len, false);
+  uint64_t tags = 0;
+  if (state.range(0))
+    adder->getOnNewTag()->connect([&tags](tag_t&) { tags++; });
+
+  for (auto _ : state)
+    adder->emitNewTag(pmt::DataType::UINT8);
+  benchmark::DoNotOptimize(tags);
+}
+
+// emitNewTag of 16 item packets gathered in batches of range(0) TAGs, to one observer of the batches.
+void BM_EmitNewTagBatch(benchmark::State& state)
+{
+  processor::sptr adder = proc_factory::createADDER("UINT8", 1, std::string("adder"), kNoCon, 16, false);
+  uint64_t tags = 0;
+  adder->getOnNewTags()->connect([&tags](const tag_span& batch) { tags += batch.size(); });
+  adder->setTagBatchSize(state.range(0));
+
+  for (auto _ : state)
+    adder->emitNewTag(pmt::DataType::UINT8);
+  adder->flushTags();
+  benchmark::DoNotOptimize(tags);
+}
+
+template <class T>
+void BM_AdderProcess(benchmark::State& state)
+{
+  const size_t len = state.range(0);
+  processor::sptr adder = std::make_shared<adder_blk<T>>(1, std::string("adder"), kNoCon, len, false);
+  pmt::pmt_t in1 = pmt::make_genVector<T>(len, T(1));
+  pmt::pmt_t in2 = pmt::make_genVector<T>(len, T(2));
+  adder->bindInput("In1", in1);
+  adder->bindInput("Proc", in2);
+  adder->setInput1(in1);
+
+  for (auto _ : state) {
+    adder->process(in2);
+    benchmark::DoNotOptimize(adder->getOutputItems().get());
+  }
+  state.SetItemsProcessed(state.iterations() * len);
+  state.SetBytesProcessed(state.iterations() * len * sizeof(T));
+}
+
+// Cost on the logging thread; the tags are encoded and written by the event log writer.
+void BM_TagRingRange(benchmark::State& state)
+{
+  // a ring holding range(0) tags, one every 16 items, queried for 256 item windows
+  const size_t ntags = state.range(0);
+  tag_ring ring(ntags);
+  const pmt::pmt_t key = pmt::intern("burst");
+  const pmt::pmt_t value = pmt::from_long(1);
+  for (size_t k = 0; k < ntags; k++)
+    ring.push(stream_tag{16 * k, key, value, 1});
+
+  std::vector<stream_tag> tags;
+  tags.reserve(ntags);
+  uint64_t start = 0;
+  for (auto _ : state) {
+    tags.clear();
+    ring.get_in_range(tags, start, start + 256);
+    benchmark::DoNotOptimize(tags.data());
+    start = (start + 256) % (16 * ntags);
+  }
+}
+
+void BM_LogTag(benchmark::State& state)
+{
+  static bool started = false;
+  if (!started) {
+    PL_Log::StartLog("pl_proc_bench", LogLevel::WARNING, "./", EventLogFormat::BINARY);
+    started = true;
+  }
+
+  const size_t len = state.range(0);
+  pmt::pmt_t value = pmt::make_genVector<std::uint8_t>(len, 1);
+  JobRunID *jobRunId = jobRunId->getInstance();
+  const ObjectID objId = ObjectID::ForModuleIndex(*jobRunId, static_cast<ObjectIDModuleType>(ModuleType::ADDER_MODULE), 1, 0);
+  const tag_t tag(timing::now_ns(), objId, pmt::DataType::UINT8, value);
+
+  for (auto _ : state)
+    PL_Log::LogTag(tag);
+  PL_Log::FlushLog();
+  state.SetBytesProcessed(state.iterations() * len);
+}
+
+// LogTags of batches of range(1) TAGs of range(0) bytes, per TAG.
+void BM_LogTags(benchmark::State& state)
+{
+  static bool started = false;
+  if (!started) {
+    PL_Log::StartLog("pl_proc_bench", LogLevel::WARNING, "./", EventLogFormat::BINARY);
+    started = true;
+  }
+
+  const size_t len = state.range(0);
+  const size_t n = state.range(1);
+  pmt::pmt_t value = pmt::make_genVector<std::uint8_t>(len, 1);
+  JobRunID *jobRunId = jobRunId->getInstance();
+  const ObjectID objId = ObjectID::ForModuleIndex(*jobRunId, static_cast<ObjectIDModuleType>(ModuleType::ADDER_MODULE), 1, 0);
+  std::vector<tag_t> batch(n, tag_t(timing::now_ns(), objId, pmt::DataType::UINT8, value));
+
+  for (auto _ : state)
+    PL_Log::LogTags(tag_span{batch.data(), batch.size()});
+  PL_Log::FlushLog();
+  state.SetItemsProcessed(state.iterations() * n);
+  state.SetBytesProcessed(state.iterations() * n * len);
+}
+
+// In-flight packets of one module per thread: insert the newest, look up and erase
+// the one range(0) packets older, in a map shared by all threads.
+void BM_ObjectIdMap(benchmark::State& state)
+{
+  static object_id_map<uint32_t> map(1 << 14);
+  const uint32_t window = state.range(0);
+  JobRunID *jobRunId = jobRunId->getInstance();
+  const ObjectID objId = ObjectID::ForModuleIndex(*jobRunId, static_cast<ObjectIDModuleType>(ModuleType::ADDER_MODULE),
+                                                  state.thread_index(), 0);
+  uint32_t p = 0, value = 0;
+  for (auto _ : state) {
+    map.insert(objId.WithPaketIndex(p), p);
+    if (p >= window) {
+      const ObjectID old = objId.WithPaketIndex(p - window);
+      map.find(old, value);
+      map.erase(old);
+    }
+    p++;
+  }
+  for (uint32_t k = p > window ? p - window : 0; k < p; k++)
+    map.erase(objId.WithPaketIndex(k));
+  benchmark::DoNotOptimize(value);
+  state.SetItemsProcessed(state.iterations());
+}
+
+// Same as BM_ObjectIdMap with a locked std::unordered_map hashing with ObjectID::Hash().
+void BM_ObjectIdUnorderedMap(benchmark::State& state)
+{
+  struct id_hash { size_t operator()(const ObjectID& id) const { return id.Hash(); } };
+  static std::mutex mutex;
+  static std::unordered_map<ObjectID, uint32_t, id_hash> map;
+  const uint32_t window = state.range(0);
+  JobRunID *jobRunId = jobRunId->getInstance();
+  const ObjectID objId = ObjectID::ForModuleIndex(*jobRunId, static_cast<ObjectIDModuleType>(ModuleType::ADDER_MODULE),
+                                                  state.thread_index(), 0);
+  uint32_t p = 0, value = 0;
+  for (auto _ : state) {
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      map.emplace(objId.WithPaketIndex(p), p);
+    }
+    if (p >= window) {
+      const ObjectID old = objId.WithPaketIndex(p - window);
+      std::lock_guard<std::mutex> lock(mutex);
+      auto it = map.find(old);
+      if (it != map.end()) {
+        value = it->second;
+        map.erase(it);
+      }
+    }
+    p++;
+  }
+  std::lock_guard<std::mutex> lock(mutex);
+  for (uint32_t k = p > window ? p - window : 0; k < p; k++)
+    map.erase(objId.WithPaketIndex(k));
+  benchmark::DoNotOptimize(value);
+  state.SetItemsProcessed(state.iterations());
+}
+
+// Sequence numbers of range(0) packets, with one late packet every range(1) packets (0: none).
+void BM_SeqTrackerObserve(benchmark::State& state)
+{
+  const size_t n = state.range(0);
+  const size_t every = state.range(1);
+  std::vector<ObjectIDPaketSeqType> seqs(n);
+  for (size_t k = 0; k < n; k++)
+    seqs[k] = k;
+  for (size_t k = every; every != 0 && k < n; k += every)
+    std::swap(seqs[k - 1], seqs[k]);
+
+  for (auto _ : state) {
+    seq_tracker tracker;
+    for (ObjectIDPaketSeqType seq : seqs)
+      tracker.observe(seq);
+    benchmark::DoNotOptimize(tracker.late());
+  }
+  state.SetItemsProcessed(state.iterations() * n);
+}
+
+// 4096 packets shuffled within blocks of range(0) packets (1: in order), through a
+// reorder buffer of range(0) packets.
+void BM_ReorderBuffer(benchmark::State& state)
+{
+  const size_t n = 4096;
+  const size_t block = state.range(0);
+  std::vector<ObjectIDPaketSeqType> seqs(n);
+  for (size_t k = 0; k < n; k++)
+    seqs[k] = k;
+  std::mt19937 gen(1);
+  for (size_t k = 0; k + block <= n; k += block)
+    std::shuffle(seqs.begin() + k, seqs.begin() + k + block, gen);
+
+  reorder_buffer<ObjectIDPaketSeqType> buffer(block);
+  uint64_t delivered = 0;
+  auto release = [&delivered](ObjectIDPaketSeqType, const ObjectIDPaketSeqType&) { delivered++; };
+  ObjectIDPaketSeqType base = 0;
+  for (auto _ : state) {
+    for (ObjectIDPaketSeqType seq : seqs) {
+      switch (buffer.arrive(base + seq, release)) {
+      case reorder_event::IN_ORDER:
+        delivered++;
+        buffer.advance(release);
+        break;
+      case reorder_event::BUFFERED:
+        buffer.item(base + seq) = base + seq;
+        break;
+      case reorder_event::LATE:
+        break;
+      }
+    }
+    base += n;
+  }
+  benchmark::DoNotOptimize(delivered);
+  state.SetItemsProcessed(state.iterations() * n);
+}
+
+} // namespace
+
+BENCHMARK_TEMPLATE(BM_MakeGenVector, std::uint8_t)->RangeMultiplier(16)->Range(16, 1 << 20);
+BENCHMARK_TEMPLATE(BM_MakeGenVector, float)->RangeMultiplier(16)->Range(16, 1 << 20);
+BENCHMARK_TEMPLATE(BM_GenVectorRaw, std::uint8_t)->Arg(1024);
+BENCHMARK_TEMPLATE(BM_GenVectorRaw, std::complex<float>)->Arg(1024);
+BENCHMARK(BM_DictAdd)->RangeMultiplier(4)->Range(4, 256);
+BENCHMARK(BM_DictRef)->RangeMultiplier(4)->Range(4, 256);
+BENCHMARK(BM_Intern);
+BENCHMARK(BM_SignalEmit)->Arg(1)->Arg(2)->Arg(8);
+BENCHMARK(BM_EmitNewTag)->Arg(0)->Arg(1);
+BENCHMARK(BM_EmitNewTagBatch)->Arg(1)->Arg(16)->Arg(256);
+BENCHMARK_TEMPLATE(BM_AdderProcess, std::uint8_t)->RangeMultiplier(16)->Range(16, 1 << 20);
+BENCHMARK_TEMPLATE(BM_AdderProcess, std::int32_t)->RangeMultiplier(16)->Range(16, 1 << 20);
+BENCHMARK_TEMPLATE(BM_AdderProcess, float)->RangeMultiplier(16)->Range(16, 1 << 20);
+BENCHMARK_TEMPLATE(BM_AdderProcess, std::complex<float>)->RangeMultiplier(16)->Range(16, 1 << 20);
+BENCHMARK(BM_TagRingRange)->Arg(64)->Arg(1024);
+BENCHMARK(BM_LogTag)->Arg(16)->Arg(1024);
+BENCHMARK(BM_LogTags)->Args({16, 1})->Args({16, 64});
+BENCHMARK(BM_ObjectIdMap)->Arg(256)->Threads(1)->Threads(4);
+BENCHMARK(BM_ObjectIdUnorderedMap)->Arg(256)->Threads(1)->Threads(4);
+BENCHMARK(BM_SeqTrackerObserve)->Args({4096, 0})->Args({4096, 16});
+BENCHMARK(BM_ReorderBuffer)->Arg(1)->Arg(8)->Arg(64);
+
+} // namespace pl_proc
+
+BENCHMARK_MAIN();
@@ -0,0 +1,89 @@
+/*
+ * @file   static_pipeline_bench.cpp
+ * @brief  Benchmark of the compile-time pipeline against the dynamic one
+ *         built out of processor nodes and signal/slot connections.
+ */
+
+#include <benchmark/benchmark.h>
+
+#include "static_pipeline.h"
+#include "processor_factory.h"
+#include "util.h"
+
+#include <cstdint>
+#include <list>
+#include <tuple>
+#include <vector>
+
+namespace pl_proc {
+
+namespace {
+
+const size_t kNumPakets = 64;
+
+using adder_pipeline = static_pipeline<
+  static_vec_sink<
+    static_adder<static_vec_src<std::uint8_t, 0>,
+                 static_vec_src<std::uint8_t, 1>>>>;
+
+void BM_StaticPipeline_Adder(benchmark::State& state)
+{
+  const size_t pkt_len = state.range(0);
+  const std::vector<std::uint8_t> data1 = genrandvec<std::uint8_t>(0, 1, pkt_len * kNumPakets);
+  const std::vector<std::uint8_t> data2 = genrandvec<std::uint8_t>(0, 1, pkt_len * kNumPakets);
+  adder_pipeline pipeline(pkt_len, {&data1, &data2});
+
+  for (auto _ : state) {
+    if (!pipeline.run_paket()) {
+      pipeline.rewind();
+      pipeline.run_paket();
+    }
+    benchmark::DoNotOptimize(pipeline.getData().data());
+  }
+  state.SetItemsProcessed(state.iterations() * pkt_len);
+}
+
+// Same graph as config/sample_pipeline.json, wired like sys_builder does it.
+void BM_DynamicPipeline_Adder(benchmark::State& state)
+{
+  const size_t pkt_len = state.range(0);
+  const std::list<std::tuple<std::string, std::string, std::string>> noCon;
+  pmt::pmt_t data1 = pmt::init_genVector<std::uint8_t>(pkt_len * kNumPakets, genrandvec<std::uint8_t>(0, 1, pkt_len * kNumPakets));
+  pmt::pmt_t data2 = pmt::init_genVector<std::uint8_t>(pkt_len * kNumPakets, genrandvec<std::uint8_t>(0, 1, pkt_len * kNumPakets));
+
+  processor::sptr src1 = proc_factory::createSRC("UINT8", 1, std::string("vec_src1"), noCon, pkt_len, true, data1, false, 1);
+  processor::sptr src2 = proc_factory::createSRC("UINT8", 2, std::string("vec_src2"), noCon, pkt_len, true, data2, false, 1);
+  processor::sptr adder = proc_factory::createADDER("UINT8", 3, std::string("adder"), noCon, pkt_len, false);
+  processor::sptr sink = proc_factory::createSINK("UINT8", 4, std::string("vec_sink"), noCon, pkt_len, false);
+
+  adder->bindInput("In1", src1->getOutputItems());
+  adder->bindInput("Proc", src2->getOutputItems());
+  sink->bindInput("Proc", adder->getOutputItems());
+  src1->getOnNewDataGen()->connect_member<processor>(adder, &processor::setInput1);
+  src2->getOnNewDataGen()->connect_member<processor>(adder, &processor::process);
+  adder->getOnNewDataGen()->connect_member<processor>(sink, &processor::process);
+
+  auto rewind = [](const processor::sptr& src) { std::static_pointer_cast<vec_src_blk<std::uint8_t>>(src)->rewind(); };
+
+  size_t paket = 0;
+  for (auto _ : state) {
+    if (paket++ == kNumPakets) {
+      rewind(src1);
+      rewind(src2);
+      paket = 1;
+    }
+    src1->start();
+    src2->start();
+    benchmark::DoNotOptimize(adder->getOutputItems().get());
+  }
+  state.SetItemsProcessed(state.iterations() * pkt_len);
+}
+
+} // namespace
+
+BENCHMARK(BM_StaticPipeline_Adder)->RangeMultiplier(8)->Range(8, 1 << 18);
+BENCHMARK(BM_DynamicPipeline_Adder)->RangeMultiplier(8)->Range(8, 1 << 18);
+
+} // namespace pl_proc
+
+BENCHMARK_MAIN();
@@ -17,7 +17,7 @@
 #include <vector>
 #include <algorithm>
 #include <functional>
-#include <assert.h>
+#include <stdexcept>
 
 
 namespace pl_proc {
@@ -37,38 +37,67 @@ adder_blk<T>::adder_blk(ObjectIDModuleIndexType moduleIndex,
               trigStart)
 {
   output_items_ = pmt::make_genVector<T>(noutput_items_, 0);
+  out_.bind(output_items_);
 }
 
 template <class T>
-void adder_blk<T>::setInput1(pmt::pmt_t& input_items1)
+void adder_blk<T>::checkInputLength(const typed_buffer<T>& in) const
+{
+  if (in.size() != noutput_items_)
+    throw std::invalid_argument("adder input length must match the output vector size");
+}
+
+template <class T>
+bool adder_blk<T>::bindInput(const std::string& port, const pmt::pmt_t& items)
 {
   std::lock_guard<std::mutex> locker(mutex_);
 
-  assert(pmt::getLength_genVector<T>(input_items1) == noutput_items_);
+  if (port != "In1" && port != "Proc")
+    return false;
+
+  typed_buffer<T>& in = (port == "In1") ? in1_ : in2_;
+  in.bind(items);
+  checkInputLength(in);
+  return true;
+}
 
-  input_items1_ = input_items1;
-  pmt::genVector_fill<T>(output_items_, 0);
-  emitFirstInput();
+template <class T>
+void adder_blk<T>::setInput1(pmt::pmt_t& input_items1)
+{
+  // Bound at connect time; only a producer swapping its buffer costs a type check
+  if (!in1_.is_bound_to(input_items1)) {
+    in1_.bind(input_items1);
+    checkInputLength(in1_);
+  }
 }
 
 template <class T>
 void adder_blk<T>::process(pmt::pmt_t& input_items2)
 {
-//  std::lock_guard<std::mutex> locker(mutex_);
-  assert(pmt::getLength_genVector<T>(output_items_) == pmt::getLength_genVector<T>(input_items2));
+  if (!in2_.is_bound_to(input_items2)) {
+    in2_.bind(input_items2);
+    checkInputLength(in2_);
+  }
 
-  const T* inVec1 = pmt::genVector_raw<T>(input_items1_);
-  const T* inVec2 = pmt::genVector_raw<T>(input_items2);
-  T* outVec = pmt::genVector_writable_raw<T>(output_items_);
+  // In1 holds the packet of the same sequence number, set by the input aligner of the node
+  checkInputsAligned();
 
-  std::transform(inVec1, inVec1+pmt::getLength_genVector<T>(input_items1_),
-                 inVec2,
-                 outVec, std::plus<T>());
+  processTile(in2_.data(), out_.data(), 0, out_.size());
 
-  emitNewTag(pmt::getType_genVector<T>(output_items_));
+  emitNewTag(out_.data_type());
   emitNewData();
 }
 
+template <class T>
+void adder_blk<T>::processTile(const void* in, void* out, size_t offset, size_t n)
+{
+  const T* inVec1 = in1_.data() + offset;
+  const T* inVec2 = static_cast<const T*>(in);
+
+  std::transform(inVec1, inVec1 + n,
+                 inVec2,
+                 static_cast<T*>(out), std::plus<T>());
+}
 
 template class adder_blk<std::int8_t>;
 template class adder_blk<std::uint8_t>;
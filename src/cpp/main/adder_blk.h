@@ -17,6 +17,7 @@
 #define ADD_BLK_IMPL_H
 
 #include "processor.h"
+#include "typed_buffer.h"
 #include <vector>
 #include <mutex>
 
@@ -27,6 +28,11 @@ template <class T>
 class adder_blk : public processor
 {
 private:
+  typed_buffer<T> in1_;
+  typed_buffer<T> in2_;
+  typed_buffer<T> out_;
+
+  void checkInputLength(const typed_buffer<T>& in) const;
 
 public:
   adder_blk(ObjectIDModuleIndexType moduleIndex,
@@ -38,7 +44,13 @@ public:
   void setInput1(pmt::pmt_t& input_items1) override;
   void start() override { return; };
   bool getDone() override { return true; };  
+  bool bindInput(const std::string& port, const pmt::pmt_t& items) override;
   void process(pmt::pmt_t& input_items2) override;
+  bool isElementwise() const override { return true; };
+  bool isInput1Bound() const override { return in1_.is_bound(); };
+  void processTile(const void* in, void* out, size_t offset, size_t n) override;
+  bool isStateless() const override { return true; };
+  pmt::DataType getOutputDataType() const override { return out_.data_type(); };
 };
 
 } // namespace pl_proc
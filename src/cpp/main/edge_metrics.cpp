@@ -0,0 +1,90 @@
+/**
+ * @file   edge_metrics.cpp
+ *
+ * @author Armin Zare Zadeh ali.a.zarezadeh@gmail.com
+ *         Eric J. Mayo eric@pozicom.net
+ *
+ * @brief   edge_metrics.cpp includes the occupancy and back-pressure metrics of the pipeline connections
+ */
+
+#include "edge_metrics.h"
+
+
+namespace pl_proc {
+
+std::atomic<bool> edge_stats::enabled_(false);
+
+uint64_t edge_stats::enter()
+{
+  const uint64_t now = now_ns();
+  const uint64_t last = lastLeaveNs_.load(std::memory_order_relaxed);
+  if (last != 0 && now > last)
+    starvedNs_.fetch_add(now - last, std::memory_order_relaxed);
+
+  deliveries_.fetch_add(1, std::memory_order_relaxed);
+  const uint64_t depth = depth_.fetch_add(1, std::memory_order_relaxed) + 1;
+  uint64_t hw = highWater_.load(std::memory_order_relaxed);
+  while (depth > hw && !highWater_.compare_exchange_weak(hw, depth, std::memory_order_relaxed)) {}
+  return now;
+}
+
+void edge_stats::leave(uint64_t enterNs)
+{
+  const uint64_t now = now_ns();
+  blockedNs_.fetch_add(now - enterNs, std::memory_order_relaxed);
+  depth_.fetch_sub(1, std::memory_order_relaxed);
+  lastLeaveNs_.store(now, std::memory_order_relaxed);
+}
+
+bool edge_metrics_sampler::start(const std::vector<edge>& edges, const std::string& file_name, std::chrono::milliseconds period)
+{
+  stop();
+
+  file_.open(file_name.c_str(), std::ios::out | std::ios::trunc);
+  if (!file_)
+    return false;
+  file_ << "elapsed_ms,source,signal,target,port,deliveries,depth,high_water,blocked_ns,starved_ns\n";
+
+  edges_ = edges;
+  period_ = period;
+  start_ = std::chrono::steady_clock::now();
+  stop_ = false;
+  thread_ = std::thread(&edge_metrics_sampler::run, this);
+  return true;
+}
+
+void edge_metrics_sampler::stop()
+{
+  if (!thread_.joinable())
+    return;
+
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stop_ = true;
+  }
+  cv_.notify_one();
+  thread_.join();
+  file_.close();
+}
+
+void edge_metrics_sampler::sample()
+{
+  const auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start_).count();
+  for (auto const& e : edges_) {
+    file_ << elapsed << "," << e.source << "," << e.signal << "," << e.target << "," << e.port << "," <<
+             e.stats->deliveries() << "," << e.stats->depth() << "," << e.stats->highWater() << "," <<
+             e.stats->blockedNs() << "," << e.stats->starvedNs() << "\n";
+  }
+  file_.flush();
+}
+
+void edge_metrics_sampler::run()
+{
+  std::unique_lock<std::mutex> lock(mutex_);
+  while (!stop_) {
+    cv_.wait_for(lock, period_, [this] { return stop_; });
+    sample();
+  }
+}
+
+} // namespace pl_proc
@@ -0,0 +1,162 @@
+/**
+ * @file   edge_metrics.h
+ *
+ * @author Armin Zare Zadeh ali.a.zarezadeh@gmail.com
+ *         Eric J. Mayo eric@pozicom.net
+ *
+ * @brief   edge_metrics.h includes the occupancy and back-pressure metrics of the pipeline connections
+ */
+
+#ifndef EDGE_METRICS_H
+#define EDGE_METRICS_H
+
+#include "noncopyable.h"
+#include "tracer.h"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+
+namespace pl_proc {
+
+/*!
+ * \brief Counters of a pipeline connection (edge) from a signal of a source node
+ *        to a port of a target node.
+ *
+ * \details
+ * The connections deliver their data synchronously: the emit of the producer
+ * returns once the consumer is done.  So the depth of an edge is the number of
+ * deliveries in flight on it, the producer is blocked for the duration of each
+ * delivery, and the consumer is starved between the end of a delivery and the
+ * start of the next one.  All counters are relaxed atomics, so a sampler thread
+ * can read them while the pipeline runs.
+ */
+class edge_stats : noncopyable
+{
+private:
+  static std::atomic<bool> enabled_;
+
+  std::atomic<uint64_t> deliveries_;
+  std::atomic<uint64_t> depth_;
+  std::atomic<uint64_t> highWater_;
+  std::atomic<uint64_t> blockedNs_;
+  std::atomic<uint64_t> starvedNs_;
+  std::atomic<uint64_t> lastLeaveNs_; //< end of the last delivery, 0 before the first one
+
+public:
+  edge_stats() : deliveries_(0), depth_(0), highWater_(0), blockedNs_(0), starvedNs_(0), lastLeaveNs_(0) {}
+
+  static bool enabled() { return enabled_.load(std::memory_order_relaxed); }
+  static void set_enabled(bool enabled) { enabled_.store(enabled, std::memory_order_relaxed); }
+
+  static uint64_t now_ns()
+  {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+  }
+
+  /*!
+   * \brief Account the start of a delivery and return its timestamp.
+   */
+  uint64_t enter();
+
+  /*!
+   * \brief Account the end of the delivery started at \p enterNs.
+   */
+  void leave(uint64_t enterNs);
+
+  uint64_t deliveries() const { return deliveries_.load(std::memory_order_relaxed); }
+  uint64_t depth() const { return depth_.load(std::memory_order_relaxed); }
+  uint64_t highWater() const { return highWater_.load(std::memory_order_relaxed); }
+  uint64_t blockedNs() const { return blockedNs_.load(std::memory_order_relaxed); }
+  uint64_t starvedNs() const { return starvedNs_.load(std::memory_order_relaxed); }
+};
+
+/*!
+ * \brief Scope of a delivery over an edge: records it in the execution trace and
+ *        in the counters of the edge, when these are enabled.
+ */
+class edge_delivery
+{
+private:
+  edge_stats* stats_;
+  uint64_t enterNs_;
+
+public:
+  edge_delivery(edge_stats& stats, uint32_t traceNameId)
+    : stats_(nullptr), enterNs_(0)
+  {
+    if (tracer::enabled())
+      tracer::instant(traceNameId, trace_category::EDGE);
+    if (edge_stats::enabled()) {
+      stats_ = &stats;
+      enterNs_ = stats.enter();
+    }
+  }
+
+  ~edge_delivery()
+  {
+    if (stats_)
+      stats_->leave(enterNs_);
+  }
+
+  edge_delivery(const edge_delivery&) = delete;
+  edge_delivery& operator=(const edge_delivery&) = delete;
+};
+
+/*!
+ * \brief Thread writing the counters of a set of edges to a CSV metrics file,
+ *        one row per edge every period, and a last sample when stopped.
+ */
+class edge_metrics_sampler : noncopyable
+{
+public:
+  struct edge
+  {
+    std::string source;
+    std::string signal;
+    std::string target;
+    std::string port;
+    std::shared_ptr<edge_stats> stats;
+  };
+
+private:
+  std::vector<edge> edges_;
+  std::ofstream file_;
+  std::chrono::milliseconds period_;
+  std::chrono::steady_clock::time_point start_;
+  std::thread thread_;
+  std::mutex mutex_;
+  std::condition_variable cv_;
+  bool stop_;
+
+  void sample();
+  void run();
+
+public:
+  edge_metrics_sampler() : period_(0), stop_(false) {}
+  ~edge_metrics_sampler() { stop(); }
+
+  /*!
+   * \brief Start sampling \p edges to \p file_name every \p period.
+   *        Returns false if the file can not be written.
+   */
+  bool start(const std::vector<edge>& edges, const std::string& file_name, std::chrono::milliseconds period);
+
+  /*!
+   * \brief Write a last sample and stop the thread.
+   */
+  void stop();
+};
+
+} // namespace pl_proc
+
+#endif /* EDGE_METRICS_H */
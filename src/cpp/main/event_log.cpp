@@ -0,0 +1,185 @@
+/**
+ * @file   event_log.cpp
+ *
+ * @author Armin Zare Zadeh ali.a.zarezadeh@gmail.com
+ *         Eric J. Mayo eric@pozicom.net
+ *
+ * @brief   event_log.cpp includes the asynchronous writer of the tag event log
+ */
+
+#include "event_log.h"
+#include "tags.h"
+
+#include <utility>
+
+
+namespace pl_proc {
+
+event_log::event_log()
+  : ring_(kRecords),
+    format_(EventLogFormat::CSV),
+    writerIdle_(false),
+    pushed_(0),
+    stop_(false),
+    flushWanted_(false),
+    written_(0),
+    flushedRecords_(0)
+{
+}
+
+event_log::~event_log()
+{
+  close();
+}
+
+bool event_log::open(const std::string& file_name, EventLogFormat format)
+{
+  if (is_open())
+    return true;
+
+  format_ = format;
+  if (format_ == EventLogFormat::CSV) {
+    file_.open(file_name.c_str(), std::ios::out | std::ios::app);
+    if (file_.fail())
+      return false;
+    write_csv_header(file_);
+  } else {
+    file_.open(file_name.c_str(), std::ios::out | std::ios::trunc | std::ios::binary);
+    if (file_.fail())
+      return false;
+    write_binary_header(batch_);
+  }
+
+  stop_ = false;
+  writer_ = std::thread(&event_log::run, this);
+  return true;
+}
+
+void event_log::snapshot(const tag_t& tag, event_record& rec)
+{
+  rec.stamp_ = std::chrono::system_clock::now();
+  rec.timetag_ = tag.timetag_;
+  rec.offset_ = tag.offset_;
+  rec.key_ = tag.key_;
+  rec.valueDataType_ = tag.valueDataType_;
+  if (tag.value_ && pmt::is_uniform_vector(tag.value_)) {
+    size_t len = 0;
+    const std::uint8_t* items = static_cast<const std::uint8_t*>(pmt::uniform_vector_elements(tag.value_, len));
+    rec.payload_.assign(items, items + len);
+  } else {
+    rec.payload_.clear();
+  }
+}
+
+void event_log::push(const tag_t& tag)
+{
+  const size_t pos = ring_.claim();
+  snapshot(tag, ring_.acquire(pos));
+  ring_.publish(pos);
+
+  pushed_.fetch_add(1, std::memory_order_release);
+  if (writerIdle_.load(std::memory_order_acquire))
+    wakeup_.notify_one();
+}
+
+void event_log::push(const tag_span& tags)
+{
+  if (tags.empty())
+    return;
+
+  // the records of the batch are claimed with a single fetch_add
+  const size_t pos = ring_.claim(tags.size());
+  for (size_t k = 0; k < tags.size(); k++) {
+    snapshot(tags[k], ring_.acquire(pos + k));
+    ring_.publish(pos + k);
+  }
+
+  pushed_.fetch_add(tags.size(), std::memory_order_release);
+  if (writerIdle_.load(std::memory_order_acquire))
+    wakeup_.notify_one();
+}
+
+void event_log::push(event_record&& rec)
+{
+  const size_t pos = ring_.claim();
+  std::swap(ring_.acquire(pos), rec);
+  ring_.publish(pos);
+
+  pushed_.fetch_add(1, std::memory_order_release);
+  if (writerIdle_.load(std::memory_order_acquire))
+    wakeup_.notify_one();
+}
+
+void event_log::flush()
+{
+  const uint64_t target = pushed_.load(std::memory_order_acquire);
+  std::unique_lock<std::mutex> lock(mutex_);
+  flushWanted_ = true;
+  wakeup_.notify_one();
+  flushed_.wait(lock, [&] { return flushedRecords_ >= target || !writer_.joinable(); });
+}
+
+void event_log::close()
+{
+  if (!is_open())
+    return;
+
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stop_ = true;
+  }
+  wakeup_.notify_one();
+  writer_.join();
+  file_.close();
+  flushed_.notify_all();
+}
+
+void event_log::run()
+{
+  for (;;) {
+    uint64_t n = 0;
+    while (const event_record* rec = ring_.front()) {
+      encode(*rec);
+      ring_.pop();
+      n++;
+      if (batch_.size() >= kBatchBytes) {
+        file_.write(batch_.data(), batch_.size());
+        batch_.clear();
+      }
+    }
+    if (!batch_.empty()) {
+      file_.write(batch_.data(), batch_.size()); // buffered by the file stream
+      batch_.clear();
+    }
+
+    std::unique_lock<std::mutex> lock(mutex_);
+    written_ += n;
+    if (flushWanted_ || stop_) {
+      file_.flush();
+      flushWanted_ = false;
+      flushedRecords_ = written_;
+      flushed_.notify_all();
+    }
+    if (ring_.empty()) {
+      if (stop_)
+        break;
+      // producers only notify while the writer is idle; the timeout covers a missed wakeup
+      writerIdle_.store(true, std::memory_order_release);
+      wakeup_.wait_for(lock, std::chrono::milliseconds(10), [&] { return stop_ || flushWanted_ || !ring_.empty(); });
+      writerIdle_.store(false, std::memory_order_relaxed);
+    }
+  }
+}
+
+void event_log::encode(const event_record& rec)
+{
+  if (format_ == EventLogFormat::CSV) {
+    os_.str("");
+    format_csv(os_, rec);
+    batch_ += os_.str();
+  } else {
+    encode_binary(batch_, rec, format_ == EventLogFormat::BINARY_RLE);
+  }
+}
+
+} // namespace pl_proc
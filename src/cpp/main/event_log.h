@@ -0,0 +1,125 @@
+/**
+ * @file   event_log.h
+ *
+ * @author Armin Zare Zadeh ali.a.zarezadeh@gmail.com
+ *         Eric J. Mayo eric@pozicom.net
+ *
+ * @brief   event_log.h includes the asynchronous writer of the tag event log
+ */
+
+#ifndef EVENT_LOG_H
+#define EVENT_LOG_H
+
+#include "noncopyable.h"
+#include "mpsc_ring.h"
+#include "event_log_format.h"
+#include "logging.h"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <fstream>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+
+namespace pl_proc {
+
+struct tag_t;
+struct tag_span;
+
+/*!
+ * \brief Asynchronous event log.
+ *
+ * \details
+ * push() is called on the processing threads: it copies the tag header and the
+ * raw bytes of its genVector (which the producer overwrites with the next packet)
+ * into an event_record of a lock-free ring, in place, reusing the payload capacity
+ * the record got on the previous laps; once the ring has gone round, logging a tag
+ * allocates nothing.  A dedicated writer thread encodes the records (CSV text or
+ * binary, see event_log_format.h) and writes them to the file stream in large
+ * batches, which is only flushed by flush() and close(), so the data path never
+ * formats nor touches the file.  When the writer falls kRecords records behind, the
+ * producers wait for it.  The writer thread does not use LOG, as the PL_Log file is
+ * not thread safe.
+ */
+class event_log : noncopyable
+{
+private:
+  static constexpr size_t kBatchBytes = 1 << 20;
+  static constexpr size_t kRecords = 1024;
+
+  mpsc_ring<event_record> ring_;
+  std::ofstream file_;
+  EventLogFormat format_;
+  std::thread writer_;
+
+  std::mutex mutex_;
+  std::condition_variable wakeup_;  //< writer waits here when the ring is empty
+  std::condition_variable flushed_; //< flush() waits here
+  std::atomic<bool> writerIdle_;
+  std::atomic<uint64_t> pushed_;
+  bool stop_;               //< under mutex_
+  bool flushWanted_;        //< flush() waits for the file to be flushed, under mutex_
+  uint64_t written_;        //< records written to the file stream, under mutex_
+  uint64_t flushedRecords_; //< records flushed to the file, under mutex_
+
+  std::string batch_;
+  std::ostringstream os_;
+
+  void run();
+  void encode(const event_record& rec);
+
+public:
+  event_log();
+  ~event_log();
+
+  /*!
+   * \brief Open \p file_name, write the header of the \p format log and start
+   *        the writer thread. Returns false if the file can not be opened.
+   */
+  bool open(const std::string& file_name, EventLogFormat format = EventLogFormat::CSV);
+
+  bool is_open() const { return writer_.joinable(); }
+
+  /*!
+   * \brief Snapshot \p tag and enqueue it; lock-free and safe from any thread.
+   */
+  void push(const tag_t& tag);
+
+  /*!
+   * \brief Snapshot the batch \p tags and enqueue it at once; lock-free and safe
+   *        from any thread.
+   */
+  void push(const tag_span& tags);
+
+  /*!
+   * \brief Enqueue a record snapshotted earlier, swapping it with the one of the ring
+   *        so that \p rec gets its capacity back; lock-free and safe from any thread.
+   */
+  void push(event_record&& rec);
+
+  /*!
+   * \brief Copy the header and the payload bytes of \p tag into \p rec, reusing
+   *        the capacity of its payload.
+   */
+  static void snapshot(const tag_t& tag, event_record& rec);
+
+  /*!
+   * \brief Block until every record pushed so far is written and flushed to the file.
+   */
+  void flush();
+
+  /*!
+   * \brief Write the remaining records, stop the writer thread and close the file.
+   */
+  void close();
+};
+
+} // namespace pl_proc
+
+#endif /* EVENT_LOG_H */
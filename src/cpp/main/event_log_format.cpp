@@ -0,0 +1,383 @@
+/**
+ * @file   event_log_format.cpp
+ *
+ * @author Armin Zare Zadeh ali.a.zarezadeh@gmail.com
+ *         Eric J. Mayo eric@pozicom.net
+ *
+ * @brief   event_log_format.cpp includes the CSV, JSON and binary layouts of the tag event log
+ */
+
+#include "event_log_format.h"
+#include "util.h"
+
+#include <cmath>
+#include <complex>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+
+
+namespace pl_proc {
+
+std::string moduleType2String(ObjectIDModuleType moduleType)
+{
+  switch (moduleType)
+  {
+  case static_cast<ObjectIDModuleType>(ModuleType::ADDER_MODULE):
+    return "ADDER";
+  case static_cast<ObjectIDModuleType>(ModuleType::SRC_NOISE_MODULE):
+    return "SRC_NOISE";
+  case static_cast<ObjectIDModuleType>(ModuleType::SRC_VEC_MODULE):
+    return "SRC_VEC";
+  case static_cast<ObjectIDModuleType>(ModuleType::SINK_VEC_MODULE):
+    return "SINK_VEC";
+  case static_cast<ObjectIDModuleType>(ModuleType::REORDER_MODULE):
+    return "REORDER";
+  default:
+    return "UNKNOWN";
+  }
+}
+
+std::string dataType2String(pmt::DataType dataType)
+{
+  switch (dataType)
+  {
+  case pmt::DataType::GVEC_UINT8:          return "GVEC_UINT8";
+  case pmt::DataType::GVEC_INT8:           return "GVEC_INT8";
+  case pmt::DataType::GVEC_UINT16:         return "GVEC_UINT16";
+  case pmt::DataType::GVEC_INT16:          return "GVEC_INT16";
+  case pmt::DataType::GVEC_INT32:          return "GVEC_INT32";
+  case pmt::DataType::GVEC_UINT32:         return "GVEC_UINT32";
+  case pmt::DataType::GVEC_INT64:          return "GVEC_INT64";
+  case pmt::DataType::GVEC_UINT64:         return "GVEC_UINT64";
+  case pmt::DataType::GVEC_FLOAT:          return "GVEC_FLOAT";
+  case pmt::DataType::GVEC_DOUBLE:         return "GVEC_DOUBLE";
+  case pmt::DataType::GVEC_COMPLEX_FLOAT:  return "GVEC_COMPLEX_FLOAT";
+  case pmt::DataType::GVEC_COMPLEX_DOUBLE: return "GVEC_COMPLEX_DOUBLE";
+  default:                                 return "UNKNOWN";
+  }
+}
+
+namespace {
+
+template <class T>
+T item_at(const std::vector<std::uint8_t>& payload, size_t k)
+{
+  T i;
+  std::memcpy(&i, payload.data() + k * sizeof(T), sizeof(T));
+  return i;
+}
+
+template <class T>
+void csv_items(std::ostream& os, const std::vector<std::uint8_t>& payload)
+{
+  const size_t n = payload.size() / sizeof(T);
+  for (size_t k = 0; k < n; k++) os << item_at<T>(payload, k) << ", ";
+}
+
+template <>
+void csv_items<uint8_t>(std::ostream& os, const std::vector<std::uint8_t>& payload)
+{
+  for (auto i : payload) os << unsigned(i) << ", ";
+}
+
+template <class T>
+void csv_complex_items(std::ostream& os, const std::vector<std::uint8_t>& payload)
+{
+  const size_t n = payload.size() / sizeof(std::complex<T>);
+  for (size_t k = 0; k < n; k++) {
+    std::complex<T> i = item_at<std::complex<T>>(payload, k);
+    os << "(" << i.real() << ":" << i.imag() << "), ";
+  }
+}
+
+template <class T>
+void json_number(std::ostream& os, T i)
+{
+  os << +i; // promote (u)int8_t so it prints as a number
+}
+
+template <class T>
+void json_real(std::ostream& os, T i)
+{
+  if (std::isfinite(i)) os << i;
+  else                  os << "null";
+}
+
+template <>
+void json_number<float>(std::ostream& os, float i) { json_real(os, i); }
+
+template <>
+void json_number<double>(std::ostream& os, double i) { json_real(os, i); }
+
+template <class T>
+void json_items(std::ostream& os, const std::vector<std::uint8_t>& payload)
+{
+  const size_t n = payload.size() / sizeof(T);
+  for (size_t k = 0; k < n; k++) {
+    if (k) os << ", ";
+    json_number(os, item_at<T>(payload, k));
+  }
+}
+
+template <class T>
+void json_complex_items(std::ostream& os, const std::vector<std::uint8_t>& payload)
+{
+  const size_t n = payload.size() / sizeof(std::complex<T>);
+  for (size_t k = 0; k < n; k++) {
+    std::complex<T> i = item_at<std::complex<T>>(payload, k);
+    if (k) os << ", ";
+    os << "[";
+    json_real(os, i.real());
+    os << ", ";
+    json_real(os, i.imag());
+    os << "]";
+  }
+}
+
+#pragma pack(push, 1)
+struct event_record_header_v1
+{
+  uint32_t size_;
+  int64_t stamp_;
+  int64_t timetag_;
+  uint8_t key_[ObjectID::kLength];
+  uint8_t dataType_;
+  uint8_t encoding_;
+  uint16_t reserved_;
+  uint32_t payloadSize_;
+};
+#pragma pack(pop)
+
+} // namespace
+
+void write_csv_header(std::ostream& os)
+{
+  os <<
+     "TimeStamp" <<
+     ", TimeTag" <<
+     ", RunID"  <<
+     ", ModuleTyp" <<
+     ", ModuleIdx" <<
+     ", PaketIdx" <<
+     ", Offset" <<
+     ", DataTyp" <<
+     ", Data" <<
+     "\n";
+}
+
+void format_csv(std::ostream& os, const event_record& rec)
+{
+  os <<
+     getTimestamp(rec.stamp_) <<
+     ", " << rec.timetag_ <<
+     ", "  << rec.key_.GetRunID() <<
+     ", " << moduleType2String(rec.key_.GetModuleType()) <<
+     ", " << unsigned(rec.key_.GetModuleIndex()) <<
+     ", " << static_cast<uint32_t>(rec.key_.GetPaketIndex()) <<
+     ", " << rec.offset_ <<
+     ", " << dataType2String(rec.valueDataType_) << ", ";
+
+  switch (rec.valueDataType_)
+  {
+  case pmt::DataType::GVEC_UINT8:          csv_items<uint8_t>(os, rec.payload_); break;
+  case pmt::DataType::GVEC_INT8:           csv_items<int8_t>(os, rec.payload_); break;
+  case pmt::DataType::GVEC_UINT16:         csv_items<uint16_t>(os, rec.payload_); break;
+  case pmt::DataType::GVEC_INT16:          csv_items<int16_t>(os, rec.payload_); break;
+  case pmt::DataType::GVEC_INT32:          csv_items<int32_t>(os, rec.payload_); break;
+  case pmt::DataType::GVEC_UINT32:         csv_items<uint32_t>(os, rec.payload_); break;
+  case pmt::DataType::GVEC_INT64:          csv_items<int64_t>(os, rec.payload_); break;
+  case pmt::DataType::GVEC_UINT64:         csv_items<uint64_t>(os, rec.payload_); break;
+  case pmt::DataType::GVEC_FLOAT:          csv_items<float>(os, rec.payload_); break;
+  case pmt::DataType::GVEC_DOUBLE:         csv_items<double>(os, rec.payload_); break;
+  case pmt::DataType::GVEC_COMPLEX_FLOAT:  csv_complex_items<float>(os, rec.payload_); break;
+  case pmt::DataType::GVEC_COMPLEX_DOUBLE: csv_complex_items<double>(os, rec.payload_); break;
+  default: break;
+  }
+
+  os << "\n";
+}
+
+void format_json(std::ostream& os, const event_record& rec)
+{
+  os << "{\"TimeStamp\": \"" << getTimestamp(rec.stamp_) << "\"" <<
+        ", \"TimeTag\": " << rec.timetag_ <<
+        ", \"RunID\": " << rec.key_.GetRunID() <<
+        ", \"ModuleTyp\": \"" << moduleType2String(rec.key_.GetModuleType()) << "\"" <<
+        ", \"ModuleIdx\": " << unsigned(rec.key_.GetModuleIndex()) <<
+        ", \"PaketIdx\": " << static_cast<uint32_t>(rec.key_.GetPaketIndex()) <<
+        ", \"Offset\": " << rec.offset_ <<
+        ", \"DataTyp\": \"" << dataType2String(rec.valueDataType_) << "\"" <<
+        ", \"Data\": [";
+
+  switch (rec.valueDataType_)
+  {
+  case pmt::DataType::GVEC_UINT8:          json_items<uint8_t>(os, rec.payload_); break;
+  case pmt::DataType::GVEC_INT8:           json_items<int8_t>(os, rec.payload_); break;
+  case pmt::DataType::GVEC_UINT16:         json_items<uint16_t>(os, rec.payload_); break;
+  case pmt::DataType::GVEC_INT16:          json_items<int16_t>(os, rec.payload_); break;
+  case pmt::DataType::GVEC_INT32:          json_items<int32_t>(os, rec.payload_); break;
+  case pmt::DataType::GVEC_UINT32:         json_items<uint32_t>(os, rec.payload_); break;
+  case pmt::DataType::GVEC_INT64:          json_items<int64_t>(os, rec.payload_); break;
+  case pmt::DataType::GVEC_UINT64:         json_items<uint64_t>(os, rec.payload_); break;
+  case pmt::DataType::GVEC_FLOAT:          json_items<float>(os, rec.payload_); break;
+  case pmt::DataType::GVEC_DOUBLE:         json_items<double>(os, rec.payload_); break;
+  case pmt::DataType::GVEC_COMPLEX_FLOAT:  json_complex_items<float>(os, rec.payload_); break;
+  case pmt::DataType::GVEC_COMPLEX_DOUBLE: json_complex_items<double>(os, rec.payload_); break;
+  default: break;
+  }
+
+  os << "]}";
+}
+
+void write_binary_header(std::string& out)
+{
+  out.append(kEventLogMagic, sizeof(kEventLogMagic));
+}
+
+void encode_binary(std::string& out, const event_record& rec, bool compress)
+{
+  const size_t start = out.size();
+  out.resize(start + sizeof(event_record_header));
+
+  event_record_header hdr;
+  hdr.stamp_ = std::chrono::duration_cast<std::chrono::nanoseconds>(rec.stamp_.time_since_epoch()).count();
+  hdr.timetag_ = rec.timetag_;
+  hdr.offset_ = rec.offset_;
+  std::memcpy(hdr.key_, rec.key_.Data(), ObjectID::kLength);
+  hdr.dataType_ = static_cast<uint8_t>(rec.valueDataType_);
+  hdr.encoding_ = static_cast<uint8_t>(event_encoding::RAW);
+  hdr.reserved_ = 0;
+  hdr.payloadSize_ = static_cast<uint32_t>(rec.payload_.size());
+
+  if (compress) {
+    packbits_encode(rec.payload_.data(), rec.payload_.size(), out);
+    if (out.size() - start - sizeof(hdr) < rec.payload_.size())
+      hdr.encoding_ = static_cast<uint8_t>(event_encoding::PACKBITS);
+    else
+      out.resize(start + sizeof(hdr)); // incompressible, store it raw
+  }
+  if (hdr.encoding_ == static_cast<uint8_t>(event_encoding::RAW))
+    out.append(reinterpret_cast<const char*>(rec.payload_.data()), rec.payload_.size());
+
+  hdr.size_ = static_cast<uint32_t>(out.size() - start - sizeof(hdr.size_));
+  std::memcpy(&out[start], &hdr, sizeof(hdr));
+}
+
+int read_binary_header(std::istream& is)
+{
+  char magic[sizeof(kEventLogMagic)];
+  is.read(magic, sizeof(magic));
+  // the magic ends with the format version digit
+  if (is.gcount() != sizeof(magic) || std::memcmp(magic, kEventLogMagic, sizeof(magic) - 1) != 0)
+    return 0;
+  const int version = magic[sizeof(magic) - 1] - '0';
+  return (version >= 1 && version <= kEventLogVersion) ? version : 0;
+}
+
+bool decode_binary(std::istream& is, event_record& rec, int version)
+{
+  event_record_header hdr;
+  if (version == 1) {
+    event_record_header_v1 v1;
+    is.read(reinterpret_cast<char*>(&v1), sizeof(v1));
+    if (is.gcount() == 0)
+      return false;
+    if (is.gcount() != sizeof(v1) || v1.size_ < sizeof(v1) - sizeof(v1.size_))
+      throw std::runtime_error("truncated event log record header");
+    hdr.size_ = v1.size_ + sizeof(hdr.offset_);
+    hdr.stamp_ = v1.stamp_;
+    hdr.timetag_ = v1.timetag_;
+    hdr.offset_ = 0;
+    std::memcpy(hdr.key_, v1.key_, ObjectID::kLength);
+    hdr.dataType_ = v1.dataType_;
+    hdr.encoding_ = v1.encoding_;
+    hdr.reserved_ = v1.reserved_;
+    hdr.payloadSize_ = v1.payloadSize_;
+  } else {
+    is.read(reinterpret_cast<char*>(&hdr), sizeof(hdr));
+    if (is.gcount() == 0)
+      return false;
+    if (is.gcount() != sizeof(hdr) || hdr.size_ < sizeof(hdr) - sizeof(hdr.size_))
+      throw std::runtime_error("truncated event log record header");
+  }
+
+  std::vector<uint8_t> body(hdr.size_ - (sizeof(hdr) - sizeof(hdr.size_)));
+  is.read(reinterpret_cast<char*>(body.data()), body.size());
+  if (static_cast<size_t>(is.gcount()) != body.size())
+    throw std::runtime_error("truncated event log record payload");
+
+  rec.stamp_ = std::chrono::system_clock::time_point(
+      std::chrono::duration_cast<std::chrono::system_clock::duration>(std::chrono::nanoseconds(hdr.stamp_)));
+  rec.timetag_ = hdr.timetag_;
+  rec.offset_ = hdr.offset_;
+  rec.key_ = ObjectID::FromBinary(std::string(reinterpret_cast<const char*>(hdr.key_), ObjectID::kLength));
+  rec.valueDataType_ = static_cast<pmt::DataType>(hdr.dataType_);
+
+  switch (static_cast<event_encoding>(hdr.encoding_))
+  {
+  case event_encoding::RAW:
+    if (body.size() != hdr.payloadSize_)
+      throw std::runtime_error("event log record payload size mismatch");
+    rec.payload_.swap(body);
+    break;
+  case event_encoding::PACKBITS:
+    if (!packbits_decode(body.data(), body.size(), hdr.payloadSize_, rec.payload_))
+      throw std::runtime_error("corrupt PackBits event log record payload");
+    break;
+  default:
+    throw std::runtime_error("unknown event log record encoding");
+  }
+  return true;
+}
+
+void packbits_encode(const uint8_t* in, size_t len, std::string& out)
+{
+  size_t k = 0;
+  while (k < len) {
+    // run of identical bytes: header 1 - n, n in [2, 128]
+    size_t run = 1;
+    while (k + run < len && run < 128 && in[k + run] == in[k])
+      run++;
+    if (run >= 2) {
+      out.push_back(static_cast<char>(1 - static_cast<int>(run)));
+      out.push_back(static_cast<char>(in[k]));
+      k += run;
+      continue;
+    }
+
+    // literals up to the next run: header n - 1, n in [1, 128]
+    size_t lit = 1;
+    while (k + lit < len && lit < 128 &&
+           !(k + lit + 1 < len && in[k + lit] == in[k + lit + 1]))
+      lit++;
+    out.push_back(static_cast<char>(lit - 1));
+    out.append(reinterpret_cast<const char*>(in + k), lit);
+    k += lit;
+  }
+}
+
+bool packbits_decode(const uint8_t* in, size_t len, size_t rawLen, std::vector<uint8_t>& out)
+{
+  out.clear();
+  out.reserve(rawLen);
+  size_t k = 0;
+  while (k < len) {
+    const int n = static_cast<int8_t>(in[k++]);
+    if (n >= 0) {
+      if (k + n + 1 > len)
+        return false;
+      out.insert(out.end(), in + k, in + k + n + 1);
+      k += n + 1;
+    } else if (n != -128) {
+      if (k >= len)
+        return false;
+      out.insert(out.end(), 1 - n, in[k++]);
+    }
+    if (out.size() > rawLen)
+      return false;
+  }
+  return out.size() == rawLen;
+}
+
+} // namespace pl_proc
@@ -0,0 +1,143 @@
+/**
+ * @file   event_log_format.h
+ *
+ * @author Armin Zare Zadeh ali.a.zarezadeh@gmail.com
+ *         Eric J. Mayo eric@pozicom.net
+ *
+ * @brief   event_log_format.h includes the CSV, JSON and binary layouts of the tag event log
+ */
+
+#ifndef EVENT_LOG_FORMAT_H
+#define EVENT_LOG_FORMAT_H
+
+#include "id.h"
+#include "pmt.h"
+
+#include <chrono>
+#include <cstdint>
+#include <iosfwd>
+#include <string>
+#include <vector>
+
+
+namespace pl_proc {
+
+/*!
+ * \brief Snapshot of a tag, taken when it is logged.
+ */
+struct event_record
+{
+  std::chrono::system_clock::time_point stamp_;
+  int64_t timetag_;
+  uint64_t offset_;
+  ObjectID key_;
+  pmt::DataType valueDataType_;
+  std::vector<std::uint8_t> payload_; //< raw items of the tag value
+};
+
+/*!
+ * \brief Return the name of \p moduleType as printed in the event log.
+ */
+std::string moduleType2String(ObjectIDModuleType moduleType);
+
+/*!
+ * \brief Return the name of \p dataType as printed in the event log.
+ */
+std::string dataType2String(pmt::DataType dataType);
+
+/*!
+ * \brief Write the header line of the CSV event log.
+ */
+void write_csv_header(std::ostream& os);
+
+/*!
+ * \brief Write \p rec as one line of the CSV event log.
+ */
+void format_csv(std::ostream& os, const event_record& rec);
+
+/*!
+ * \brief Write \p rec as a JSON object (without trailing separator).
+ */
+void format_json(std::ostream& os, const event_record& rec);
+
+/*!
+ * Binary event log layout, in host byte order:
+ *
+ * \code
+ *   file    := "PLEVLOG2" record*
+ *   record  := uint32 size                     // bytes following this field
+ *              int64  stamp                    // wall clock, ns since the epoch
+ *              int64  timetag                  // ns, timing::now_ns()
+ *              uint64 offset                   // item offset, absent in "PLEVLOG1" files
+ *              uint8  key[ObjectID::kLength]
+ *              uint8  data_type                // pmt::DataType
+ *              uint8  encoding                 // event_encoding
+ *              uint16 reserved
+ *              uint32 payload_size             // decoded payload bytes
+ *              uint8  payload[size - sizeof(event_record_header) + 4]
+ * \endcode
+ *
+ * Every record is length-prefixed, so a reader can skip records it does not want
+ * to decode.
+ */
+constexpr char kEventLogMagic[8] = {'P', 'L', 'E', 'V', 'L', 'O', 'G', '2'};
+constexpr int kEventLogVersion = 2;
+
+enum class event_encoding : uint8_t {
+  RAW      = 0x00,
+  PACKBITS = 0x01  //< byte oriented run-length encoding (PackBits)
+};
+
+#pragma pack(push, 1)
+struct event_record_header
+{
+  uint32_t size_;
+  int64_t stamp_;
+  int64_t timetag_;
+  uint64_t offset_;
+  uint8_t key_[ObjectID::kLength];
+  uint8_t dataType_;
+  uint8_t encoding_;
+  uint16_t reserved_;
+  uint32_t payloadSize_;
+};
+#pragma pack(pop)
+
+/*!
+ * \brief Append the magic of the binary event log to \p out.
+ */
+void write_binary_header(std::string& out);
+
+/*!
+ * \brief Append \p rec to \p out as a binary record. With \p compress the
+ *        payload is PackBits encoded, if that makes it smaller.
+ */
+void encode_binary(std::string& out, const event_record& rec, bool compress);
+
+/*!
+ * \brief Read and check the magic of the binary event log.
+ *        Returns its format version, 0 if it is not a binary event log.
+ */
+int read_binary_header(std::istream& is);
+
+/*!
+ * \brief Read the next binary record of a log of format \p version into \p rec.
+ *        Returns false at the end of the log; throws std::runtime_error on a
+ *        truncated or corrupt record.
+ */
+bool decode_binary(std::istream& is, event_record& rec, int version = kEventLogVersion);
+
+/*!
+ * \brief PackBits encode \p len bytes at \p in, appending to \p out.
+ */
+void packbits_encode(const uint8_t* in, size_t len, std::string& out);
+
+/*!
+ * \brief PackBits decode \p len bytes at \p in into \p out, which must end up
+ *        with exactly \p rawLen bytes. Returns false if the input is corrupt.
+ */
+bool packbits_decode(const uint8_t* in, size_t len, size_t rawLen, std::vector<uint8_t>& out);
+
+} // namespace pl_proc
+
+#endif /* EVENT_LOG_FORMAT_H */
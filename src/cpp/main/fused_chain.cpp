@@ -0,0 +1,165 @@
+/**
+ * @file   fused_chain.cpp
+ *
+ * @author Armin Zare Zadeh ali.a.zarezadeh@gmail.com
+ *         Eric J. Mayo eric@pozicom.net
+ *
+ * @brief   fused_chain.cpp includes the execution of a chain of elementwise
+ *          processor nodes as a single cache-blocked loop
+ */
+
+#include "fused_chain.h"
+
+#include <algorithm>
+#include <chrono>
+#include <stdexcept>
+
+
+namespace pl_proc {
+
+fused_chain::fused_chain(const std::vector<processor::sptr>& stages,
+                         const std::vector<bool>& materialize,
+                         size_t tileBytes)
+  : stages_(stages),
+    outputs_(stages.size(), nullptr),
+    outItemSizes_(stages.size(), 0),
+    maxItemSize_(0),
+    tileItems_(0),
+    in_(nullptr),
+    inItemSize_(0),
+    nitems_(0)
+{
+  if (stages_.size() < 2)
+    throw std::invalid_argument("a fused chain needs at least two stages");
+  if (materialize.size() != stages_.size())
+    throw std::invalid_argument("a fused chain needs a materialize flag per stage");
+
+  const size_t len = pmt::length(stages_.back()->getOutputItems());
+  for (size_t s = 0; s < stages_.size(); s++) {
+    if (!stages_[s]->isElementwise())
+      throw std::invalid_argument("only elementwise processors can be fused: " + stages_[s]->getModuleName());
+    if (!stages_[s]->isInput1Bound())
+      throw std::invalid_argument("the In1 input of a fused stage must be bound: " + stages_[s]->getModuleName());
+
+    const pmt::pmt_t& out = stages_[s]->getOutputItems();
+    if (pmt::length(out) != len)
+      throw std::invalid_argument("all stages of a fused chain must have the same output vector size");
+
+    outItemSizes_[s] = pmt::uniform_vector_itemsize(out);
+    maxItemSize_ = std::max(maxItemSize_, outItemSizes_[s]);
+    if (materialize[s] || s == stages_.size() - 1) {
+      size_t bytes = 0;
+      outputs_[s] = static_cast<std::uint8_t*>(pmt::uniform_vector_writable_elements(out, bytes));
+    }
+  }
+
+  setTileBytes(tileBytes);
+  traceNameId_ = tracer::name_id(getName());
+}
+
+void fused_chain::setTileBytes(size_t tileBytes)
+{
+  tileItems_ = std::max<size_t>(1, tileBytes / maxItemSize_);
+  scratch_[0].resize(tileItems_ * maxItemSize_);
+  scratch_[1].resize(tileItems_ * maxItemSize_);
+}
+
+void fused_chain::bindInput(const pmt::pmt_t& input_items)
+{
+  size_t len = 0;
+  in_ = static_cast<const std::uint8_t*>(pmt::uniform_vector_elements(input_items, len));
+  inItemSize_ = pmt::uniform_vector_itemsize(input_items);
+  nitems_ = len / inItemSize_;
+  input_items_ = input_items;
+
+  if (nitems_ != pmt::length(stages_.back()->getOutputItems()))
+    throw std::invalid_argument("fused chain input length must match its output vector size");
+}
+
+void fused_chain::runTiles()
+{
+  const size_t nstages = stages_.size();
+  for (size_t offset = 0; offset < nitems_; offset += tileItems_) {
+    const size_t n = std::min(tileItems_, nitems_ - offset);
+
+    const void* tileIn = in_ + offset * inItemSize_;
+    for (size_t s = 0; s < nstages; s++) {
+      void* tileOut = outputs_[s] ? static_cast<void*>(outputs_[s] + offset * outItemSizes_[s])
+                                  : static_cast<void*>(scratch_[s & 1].data());
+      stages_[s]->processTile(tileIn, tileOut, offset, n);
+      tileIn = tileOut;
+    }
+  }
+}
+
+void fused_chain::process(pmt::pmt_t& input_items)
+{
+  trace_scope trace(traceNameId_, trace_category::CHAIN);
+
+  // Like typed_buffer: the type is only checked when the producer hands over a new buffer
+  if (input_items.get() != input_items_.get())
+    bindInput(input_items);
+
+  runTiles();
+
+  // The links inside the chain are disconnected, so this only reaches the other observers;
+  // the stream tags are still passed along the links, stage by stage
+  for (size_t s = 0; s < stages_.size(); s++) {
+    if (s > 0)
+      stages_[s]->receiveTags(processor::TAG_PORT_PROC, *stages_[s - 1]);
+    stages_[s]->checkInputsAligned();
+    if (outputs_[s]) {
+      stages_[s]->emitNewTag(stages_[s]->getOutputDataType());
+      stages_[s]->emitNewData();
+    } else {
+      stages_[s]->passPaket();
+    }
+  }
+}
+
+size_t fused_chain::autoTune(const pmt::pmt_t& input_items, const std::vector<size_t>& tileBytes)
+{
+  if (input_items.get() != input_items_.get())
+    bindInput(input_items);
+
+  const size_t packetBytes = nitems_ * maxItemSize_;
+  size_t best = getTileBytes();
+  double bestTime = 0.0;
+  size_t prev = 0;
+  for (size_t tb : tileBytes) {
+    if (prev >= packetBytes)
+      break; // all larger tiles run the packet as a single tile too
+    prev = tb;
+    setTileBytes(tb);
+    runTiles(); // warm up
+
+    double t = 0.0;
+    for (int rep = 0; rep < 3; rep++) {
+      auto start = std::chrono::steady_clock::now();
+      runTiles();
+      double d = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+      t = (rep == 0) ? d : std::min(t, d);
+    }
+
+    if (bestTime == 0.0 || t < bestTime) {
+      bestTime = t;
+      best = tb;
+    }
+  }
+
+  setTileBytes(best);
+  return best;
+}
+
+std::string fused_chain::getName() const
+{
+  std::string name;
+  for (auto const& s : stages_) {
+    if (!name.empty())
+      name += "+";
+    name += s->getModuleName();
+  }
+  return name;
+}
+
+} // namespace pl_proc
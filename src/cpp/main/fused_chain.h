@@ -0,0 +1,112 @@
+/**
+ * @file   fused_chain.h
+ *
+ * @author Armin Zare Zadeh ali.a.zarezadeh@gmail.com
+ *         Eric J. Mayo eric@pozicom.net
+ *
+ * @brief   fused_chain.h includes the execution of a chain of elementwise
+ *          processor nodes as a single cache-blocked loop
+ */
+
+#ifndef FUSED_CHAIN_H
+#define FUSED_CHAIN_H
+
+#include "noncopyable.h"
+#include "processor.h"
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+
+namespace pl_proc {
+
+/*!
+ * \brief Default tile size in bytes: small enough that the tiles of all stages
+ *        of a chain stay cache resident while they are passed along.
+ */
+constexpr size_t kDefaultTileBytes = 16 * 1024;
+
+/*!
+ * \brief Chain of elementwise processor nodes, each one feeding the Proc port of
+ *        the next, executed as one fused loop.
+ *
+ * \details
+ * Instead of every stage streaming the whole packet through its output genVector,
+ * the packet is cut into tiles and each tile is pushed through all stages before
+ * the next one is started.  Intermediate results of an inner stage only live in
+ * two small scratch tiles, unless the stage is materialized: then its tiles are
+ * written to its output genVector, and once the packet is done it emits its TAG
+ * and DATA signals for its other observers (logger, other consumers).  The last
+ * stage is always materialized.  The stream tags go through every stage, with its
+ * propagation policy, as if the chain was not fused.
+ */
+class fused_chain : noncopyable
+{
+private:
+  std::vector<processor::sptr> stages_;
+  std::vector<std::uint8_t*> outputs_; //< output vector of each stage, null unless materialized
+  std::vector<size_t> outItemSizes_;
+  size_t maxItemSize_;
+  size_t tileItems_;
+  std::vector<std::uint8_t> scratch_[2];
+
+  pmt::pmt_t input_items_;
+  const std::uint8_t* in_;
+  size_t inItemSize_;
+  size_t nitems_;
+
+  uint32_t traceNameId_; //< name of the chain in the execution trace
+
+  void bindInput(const pmt::pmt_t& input_items);
+  void runTiles();
+
+public:
+  /*!
+   * \brief Fuse \p stages (in data flow order) using tiles of at most \p tileBytes bytes.
+   *        Inner stage s writes its output vector only if \p materialize[s] is set.
+   */
+  fused_chain(const std::vector<processor::sptr>& stages,
+              const std::vector<bool>& materialize,
+              size_t tileBytes = kDefaultTileBytes);
+
+  /*!
+   * \brief Process a packet delivered on the Proc port of the first stage, whose
+   *        stream tags were received by that stage.
+   */
+  void process(pmt::pmt_t& input_items);
+
+  /*!
+   * \brief Process a packet which \p src delivered on the Proc port of the first stage.
+   */
+  void process(const processor& src, pmt::pmt_t& input_items)
+  {
+    stages_.front()->receiveTags(processor::TAG_PORT_PROC, src);
+    process(input_items);
+  }
+
+  /*!
+   * \brief Time the chain on \p input_items for every tile size in \p tileBytes
+   *        (ascending), keep the fastest one and return it. Nothing is emitted.
+   */
+  size_t autoTune(const pmt::pmt_t& input_items, const std::vector<size_t>& tileBytes);
+
+  void setTileBytes(size_t tileBytes);
+  size_t getTileBytes() const { return tileItems_ * maxItemSize_; }
+  size_t getTileItems() const { return tileItems_; }
+
+  const std::vector<processor::sptr>& getStages() const { return stages_; }
+  bool isMaterialized(size_t stage) const { return outputs_[stage] != nullptr; }
+
+  /*!
+   * \brief Name of the chain made of its stage names, e.g. "adder1+adder2"
+   */
+  std::string getName() const;
+
+  typedef std::shared_ptr<fused_chain> sptr;
+};
+
+} // namespace pl_proc
+
+#endif /* FUSED_CHAIN_H */
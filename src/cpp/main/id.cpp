@@ -147,6 +147,14 @@ ObjectID ObjectID::ForModuleIndex(const JobRunID &run_id,
   return GenerateObjectId(run_id.Binary(), module_type, module_index, paket_index);
 }
 
+ObjectID ObjectID::WithPaketIndex(ObjectIDPaketIndexType paket_index) const {
+  ObjectID ret;
+  std::memcpy(ret.id_, id_, JobRunID::kLength + kModuleTypeBytesLength + kModuleIndexBytesLength);
+  std::memcpy(ret.id_ + JobRunID::kLength + kModuleTypeBytesLength + kModuleIndexBytesLength, &paket_index,
+              sizeof(paket_index));
+  return ret;
+}
+
 JobRunIDType ObjectID::GetRunID() const {
   JobRunIDType id;
   std::memcpy(&id, id_ , JobRunID::kLength);
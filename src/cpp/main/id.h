@@ -57,12 +57,16 @@ enum class ModuleType : uint8_t {
   SINK_VEC_MODULE             = 0x08,
   PACK_MODULE                 = 0x09,
   UNPACK_MODULE               = 0x0A,
+  REORDER_MODULE              = 0x0B,
 };
 
 using JobRunIDType = uint16_t;
 using ObjectIDModuleType = uint8_t;
 using ObjectIDModuleIndexType = uint8_t;
 using ObjectIDPaketIndexType = uint32_t;
+/// Packet sequence number: the 64-bit packet index of a module, which never wraps.
+/// An ObjectID only encodes its low kObjectIdPaketIndexSize bits.
+using ObjectIDPaketSeqType = uint64_t;
 
 
 /// Length of FEC full-length IDs in bytes.
@@ -234,6 +238,43 @@ class ObjectID : public BaseID<ObjectID> {
                                     ObjectIDModuleIndexType module_index,
                                     ObjectIDPaketIndexType paket_index);
 
+  /// Copy of this object id for another packet of the same module. It only
+  /// patches the packet index bytes, so an id computed once by ForModuleIndex
+  /// can be reused as a prefix for every packet of the module.
+  ///
+  /// \param paket_index The packet index of the returned object id.
+  /// \return The object id of packet \p paket_index.
+  ObjectID WithPaketIndex(ObjectIDPaketIndexType paket_index) const;
+
+  /// Copy of this object id for the packet of sequence number \p paket_seq. The
+  /// id keeps the 8 bytes encoding, with the low 32 bits of the sequence number
+  /// as packet index; seq_unwrap() (seq_tracker.h) recovers the sequence number
+  /// from it and a recent one of the same module.
+  ///
+  /// \param paket_seq The packet sequence number of the returned object id.
+  /// \return The object id of packet \p paket_seq.
+  ObjectID WithPaketSeq(ObjectIDPaketSeqType paket_seq) const {
+    return WithPaketIndex(static_cast<ObjectIDPaketIndexType>(paket_seq));
+  }
+
+  /// The object id packed into a single integer: the packet index in the low
+  /// 32 bits, then the module index, the module type and the run id. Distinct
+  /// ids give distinct keys, so it can be used directly as a hash or a map key
+  /// without the MurmurHash of Hash(); the Nil id packs to ~0.
+  ///
+  /// \return The packed object id.
+  uint64_t PackedKey() const {
+    ObjectIDPaketIndexType paket_index;
+    std::memcpy(&paket_index, id_ + JobRunID::kLength + kModuleTypeBytesLength + kModuleIndexBytesLength,
+                sizeof(paket_index));
+    JobRunIDType run_id;
+    std::memcpy(&run_id, id_, JobRunID::kLength);
+    return static_cast<uint64_t>(paket_index) |
+           static_cast<uint64_t>(id_[JobRunID::kLength + kModuleTypeBytesLength]) << kObjectIdPaketIndexSize |
+           static_cast<uint64_t>(id_[JobRunID::kLength]) << (kObjectIdPaketIndexSize + kObjectIdModuleIndexSize) |
+           static_cast<uint64_t>(run_id) << (kObjectIdPaketIndexSize + 2 * kObjectIdModuleIndexSize);
+  }
+
 
  private:
   /// A helper method to generate an ObjectID.
@@ -251,6 +292,8 @@ class ObjectID : public BaseID<ObjectID> {
 //              "JobRunID size is not as expected");
 static_assert(sizeof(ObjectID) == ObjectID::kLength + sizeof(size_t),
               "ObjectID size is not as expected");
+static_assert(ObjectID::kLength == sizeof(uint64_t),
+              "ObjectID::PackedKey() must cover every byte of the id");
 
 std::ostream &operator<<(std::ostream &os, const UniqueID &id);
 std::ostream &operator<<(std::ostream &os, const JobRunID &id);
@@ -0,0 +1,353 @@
+/**
+ * @file   input_aligner.cpp
+ *
+ * @author Armin Zare Zadeh ali.a.zarezadeh@gmail.com
+ *         Eric J. Mayo eric@pozicom.net
+ *
+ * @brief   input_aligner.cpp includes the lock-free fan-in which aligns the packets
+ *          delivered on the input ports of a processor node by sequence number
+ */
+
+#include "input_aligner.h"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include <thread>
+
+
+namespace pl_proc {
+
+input_aligner::input_aligner(const std::vector<input_port>& ports, const process_fn& process, size_t window)
+  : ports_(ports),
+    process_(process),
+    complete_((1ull << ports.size()) - 1),
+    mask_(0),
+    next_(0),
+    floor_(0),
+    busy_(false),
+    pakets_(0),
+    dropped_(0),
+    late_(0)
+{
+  if (ports_.empty() || ports_.size() > kMaxPorts || !process_)
+    throw std::invalid_argument("an input aligner needs a process function and 1 to 15 input ports");
+  for (size_t k = 0; k < ports_.size(); k++) {
+    if (!ports_[k].node_ || ports_[k].tagPort_ != (k == 0 ? processor::TAG_PORT_PROC : processor::TAG_PORT_IN1))
+      throw std::invalid_argument("an input aligner takes the Proc port first, then In1 ports");
+  }
+
+  size_t capacity = 2;
+  while (capacity < window)
+    capacity <<= 1;
+  mask_ = capacity - 1;
+
+  slots_.reset(new slot[capacity]);
+  for (size_t i = 0; i < capacity; i++) {
+    slots_[i].state_.store(state(i, 0), std::memory_order_relaxed); // free, for the first packets
+    slots_[i].in_.resize(ports_.size());
+  }
+
+  buffers_.reset(new port_buffers[ports_.size()]);
+  for (size_t k = 0; k < ports_.size(); k++) {
+    port_buffers& b = buffers_[k];
+    b.items_.resize(capacity);
+    b.data_.assign(capacity, nullptr);
+    b.of_.assign(capacity, nullptr);
+    b.free_.resize(capacity);
+  }
+}
+
+void input_aligner::raise(std::atomic<ObjectIDPaketSeqType>& value, ObjectIDPaketSeqType to)
+{
+  ObjectIDPaketSeqType current = value.load();
+  while (current < to && !value.compare_exchange_weak(current, to)) {
+  }
+}
+
+uint32_t input_aligner::takeBuffer(size_t port)
+{
+  port_buffers& b = buffers_[port];
+  if (b.hasSpare_) {
+    b.hasSpare_ = false;
+    return b.spare_;
+  }
+  const size_t head = b.freeHead_.load(std::memory_order_relaxed);
+  if (head != b.freeTail_.load(std::memory_order_acquire)) {
+    const uint32_t buffer = b.free_[head & mask_];
+    b.freeHead_.store(head + 1, std::memory_order_release);
+    return buffer;
+  }
+  // A port holds at most one buffer per slot, and the slot to fill holds none
+  if (b.allocated_ > mask_)
+    throw std::logic_error("input aligner out of buffers");
+  return b.allocated_++;
+}
+
+void input_aligner::returnBuffers(slot& s, uint64_t arrived)
+{
+  // Only the thread holding busy_ returns buffers, so the ring has one writer at a time
+  for (size_t k = 0; k < ports_.size(); k++) {
+    if (!(arrived & (1ull << k)))
+      continue;
+    port_buffers& b = buffers_[k];
+    const size_t tail = b.freeTail_.load(std::memory_order_relaxed);
+    b.free_[tail & mask_] = s.in_[k].buffer_;
+    b.freeTail_.store(tail + 1, std::memory_order_release);
+  }
+}
+
+void input_aligner::store(size_t port, input& in, const processor& src, const pmt::pmt_t& items)
+{
+  port_buffers& b = buffers_[port];
+  const uint32_t buffer = takeBuffer(port);
+
+  // Like typed_buffer, the vectors are only looked up when the producer hands over a new one
+  if (items.get() != b.from_.get()) {
+    b.from_ = items;
+    b.fromData_ = pmt::uniform_vector_elements(items, b.bytes_);
+    std::fill(b.of_.begin(), b.of_.end(), nullptr);
+  }
+  if (b.of_[buffer] == items.get()) {
+    std::memcpy(b.data_[buffer], b.fromData_, b.bytes_);
+  } else {
+    size_t len = 0;
+    b.items_[buffer] = pmt::genVector_copy(items);
+    b.data_[buffer] = pmt::uniform_vector_writable_elements(b.items_[buffer], len);
+    b.of_[buffer] = items.get();
+  }
+
+  in.buffer_ = buffer;
+  src.captureInput(in.paket_);
+}
+
+void input_aligner::fire(slot& s, ObjectIDPaketSeqType seq, uint64_t buffered, size_t direct, const processor* src, pmt::pmt_t* items)
+{
+  try {
+    // The In1 ports first, as the pipeline connections deliver them before the Proc port
+    for (size_t k = ports_.size(); k-- > 0;) {
+      const input_port& p = ports_[k];
+      pmt::pmt_t* in = items;
+      if (k == direct) {
+        p.node_->receiveTags(p.tagPort_, *src);
+      } else {
+        p.node_->receiveTags(p.tagPort_, s.in_[k].paket_);
+        in = &buffers_[k].items_[s.in_[k].buffer_];
+      }
+      if (k == 0)
+        process_(*in);
+      else
+        p.node_->setInput1(*in);
+    }
+  } catch (...) {
+    finish(s, seq, buffered);
+    throw;
+  }
+  pakets_.store(pakets_.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed); // only counted by busy_
+  finish(s, seq, buffered);
+}
+
+void input_aligner::retire(slot& s, ObjectIDPaketSeqType seq, uint64_t buffered)
+{
+  returnBuffers(s, buffered);
+  s.state_.store(state(seq, complete_ | kDone), std::memory_order_release);
+}
+
+void input_aligner::finish(slot& s, ObjectIDPaketSeqType seq, uint64_t buffered)
+{
+  retire(s, seq, buffered);
+  next_.store(seq + 1, std::memory_order_release);
+}
+
+ObjectIDPaketSeqType input_aligner::skipTo(ObjectIDPaketSeqType n)
+{
+  const ObjectIDPaketSeqType floor = floor_.load();
+  if (floor <= n + 1 + mask_)
+    return n + 1;
+
+  // A port jumped far ahead: move to the oldest packet delivered before the floor at once
+  ObjectIDPaketSeqType to = floor;
+  for (size_t i = 0; i <= mask_; i++) {
+    const uint64_t w = slots_[i].state_.load(std::memory_order_acquire);
+    const ObjectIDPaketSeqType ws = seqOf(w);
+    if (ws > n && ws < to && (w & kArrived) != 0 && !(w & kDone))
+      to = ws;
+  }
+  return to;
+}
+
+bool input_aligner::reclaim(slot& s)
+{
+  if (busy_.exchange(true))
+    return false;
+
+  // Only the thread holding busy_ moves next_: a packet behind it is no longer expected
+  uint64_t w = s.state_.load(std::memory_order_acquire);
+  while (seqOf(w) < next_.load(std::memory_order_relaxed) && (w & kArrived) != 0 && !(w & kDone)) {
+    if (s.state_.compare_exchange_weak(w, w | complete_)) {
+      dropped_.store(dropped_.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+      retire(s, seqOf(w), w & kArrived);
+      break;
+    }
+  }
+  if (release())
+    drain();
+  return true;
+}
+
+void input_aligner::processReady()
+{
+  for (;;) {
+    const ObjectIDPaketSeqType n = next_.load(std::memory_order_relaxed);
+    slot& s = slotOf(n);
+    uint64_t w = s.state_.load(std::memory_order_acquire);
+    const ObjectIDPaketSeqType ws = seqOf(w);
+
+    // never delivered, and a port is a window ahead or the aligner flushed
+    if (ws > n || ((ws < n || (w & kArrived) == 0) && n < floor_.load())) {
+      next_.store(skipTo(n), std::memory_order_release);
+      continue;
+    }
+    if (ws < n)
+      return;
+
+    if ((w & kArrived) == complete_) {
+      fire(s, n, complete_, ports_.size(), nullptr, nullptr);
+      continue;
+    }
+
+    if (n >= floor_.load())
+      return;
+
+    // Given up: marked arrived on all ports, so that its missing inputs are late
+    if (!s.state_.compare_exchange_strong(w, w | complete_))
+      continue;
+    dropped_.store(dropped_.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    finish(s, n, w & kArrived);
+  }
+}
+
+bool input_aligner::ready()
+{
+  const ObjectIDPaketSeqType n = next_.load(std::memory_order_acquire);
+  const uint64_t w = slotOf(n).state_.load();
+  const ObjectIDPaketSeqType ws = seqOf(w);
+  const bool givenUp = n < floor_.load();
+  if (ws != n)
+    return ws > n || givenUp;
+  return (w & kArrived) == complete_ || givenUp;
+}
+
+bool input_aligner::release()
+{
+  // Sequentially consistent with the publications of the producers: either this
+  // thread sees a packet completed meanwhile, or its producer sees busy_ released
+  busy_.store(false);
+  return ready();
+}
+
+void input_aligner::drain()
+{
+  while (!busy_.exchange(true)) {
+    try {
+      processReady();
+    } catch (...) {
+      busy_.store(false);
+      throw;
+    }
+    if (!release())
+      return;
+  }
+}
+
+void input_aligner::deliver(size_t port, const processor& src, pmt::pmt_t& items)
+{
+  const ObjectIDPaketSeqType seq = src.getPaketSeq();
+  const uint64_t bit = 1ull << port;
+  slot& s = slotOf(seq);
+  input& in = s.in_[port];
+  bool stored = false;
+
+  for (;;) {
+    uint64_t w = s.state_.load(std::memory_order_acquire);
+    const ObjectIDPaketSeqType ws = seqOf(w);
+
+    if (ws > seq || (ws == seq && (w & (bit | kDone)))) {
+      late_.fetch_add(1, std::memory_order_relaxed);
+      if (stored) {
+        buffers_[port].spare_ = in.buffer_;
+        buffers_[port].hasSpare_ = true;
+      }
+      break;
+    }
+
+    // The slot still holds a packet a window behind: give it up, or wait for its processing.
+    // One whose first input arrived after the processing had skipped it is given up here
+    if (ws < seq && (w & kArrived) != 0 && !(w & kDone)) {
+      if (ws < next_.load(std::memory_order_acquire) && reclaim(s))
+        continue;
+      if (seq > mask_)
+        raise(floor_, seq - mask_);
+      drain();
+      std::this_thread::yield();
+      continue;
+    }
+
+    // Completing the next packet: process it with this input in place. While busy_ is
+    // held nobody else writes the slot, as only this port is missing
+    if (!stored && ws == seq && ((w & kArrived) | bit) == complete_ &&
+        next_.load(std::memory_order_acquire) == seq && !busy_.exchange(true)) {
+      const bool next = next_.load(std::memory_order_relaxed) == seq && s.state_.load(std::memory_order_acquire) == w;
+      try {
+        if (next) {
+          fire(s, seq, w & kArrived, port, &src, &items);
+          processReady();
+        }
+      } catch (...) {
+        busy_.store(false);
+        throw;
+      }
+      if (release())
+        drain();
+      if (next)
+        break;
+      continue;
+    }
+
+    if (!stored) {
+      store(port, in, src, items);
+      stored = true;
+    }
+    const uint64_t arrived = (ws == seq ? w : state(seq, 0)) | bit;
+    if (!s.state_.compare_exchange_strong(w, arrived))
+      continue;
+
+    // complete, or the packet of the slot was never delivered and is given up
+    if ((arrived & kArrived) == complete_ || (ws != seq && !(w & kDone)))
+      drain();
+    break;
+  }
+
+  // an In1 port signals its input set on arrival, whether the packet is processed now or later
+  if (ports_[port].tagPort_ == processor::TAG_PORT_IN1)
+    ports_[port].node_->emitFirstInput();
+}
+
+void input_aligner::flush()
+{
+  // No producer delivers anymore: give up on every packet delivered so far
+  ObjectIDPaketSeqType end = 0;
+  for (size_t i = 0; i <= mask_; i++) {
+    const uint64_t w = slots_[i].state_.load();
+    if ((w & kArrived) != 0)
+      end = std::max(end, seqOf(w) + 1);
+  }
+  raise(floor_, end);
+  drain();
+
+  // and on the ones whose first input arrived after the processing had skipped them
+  for (size_t i = 0; i <= mask_; i++)
+    reclaim(slots_[i]);
+}
+
+} // namespace pl_proc
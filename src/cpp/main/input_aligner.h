@@ -0,0 +1,190 @@
+/**
+ * @file   input_aligner.h
+ *
+ * @author Armin Zare Zadeh ali.a.zarezadeh@gmail.com
+ *         Eric J. Mayo eric@pozicom.net
+ *
+ * @brief   input_aligner.h includes the lock-free fan-in which aligns the packets
+ *          delivered on the input ports of a processor node by sequence number
+ */
+
+#ifndef INPUT_ALIGNER_H
+#define INPUT_ALIGNER_H
+
+#include "noncopyable.h"
+#include "processor.h"
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <vector>
+
+
+namespace pl_proc {
+
+/*!
+ * \brief Fan-in of a processor node with several connected input ports (a merge
+ *        point like an adder, or a fused chain whose stages take In1 inputs), which
+ *        processes a packet only once the packets of the same sequence number have
+ *        arrived on all its ports, whatever their order and the threads delivering them.
+ *
+ * \details
+ * Port 0 is the Proc port of the node, the packet of which is processed; the other
+ * ports are In1 ports, of the node or of the stages of its chain, set before it.  The
+ * packets in progress live in a ring of slots indexed by sequence number modulo the
+ * window, each with one atomic word: the sequence number, the ports arrived and
+ * whether the packet is done.  A producer copies its packet, with its stream tags,
+ * into a buffer of its port and publishes it with a compare and swap, so the
+ * producers of different ports deliver concurrently without a lock.  The delivery
+ * which completes a packet processes it, and the ones after it which are complete,
+ * in sequence order; if another thread is processing, that one takes it over.  The
+ * input completing the next packet is processed in place, without a copy, so the
+ * common case of inputs arriving in turn on one thread copies all but one of them.
+ *
+ * Packets are numbered from 0 on, as processors do.  A packet still missing an input
+ * when a port gets a window ahead of it is given up and counted dropped; the inputs
+ * arriving for it afterwards are counted late.  A packet no input of which had arrived
+ * is skipped, and if an input of it arrives afterwards, it is given up once its slot
+ * is needed again or at flush().  A producer which gets a window ahead of a complete
+ * packet another thread is still processing waits for it.
+ */
+class input_aligner : noncopyable
+{
+public:
+  /*!
+   * \brief Input port: \p tagPort of \p node, Proc for port 0 and In1 for the others
+   */
+  struct input_port
+  {
+    processor::sptr node_;
+    processor::tag_port tagPort_;
+  };
+
+  /*!
+   * \brief Processes the packet of the Proc port, once the In1 ports are set
+   */
+  typedef std::function<void(pmt::pmt_t& items)> process_fn;
+
+  //! Default number of packets in progress
+  static constexpr size_t kDefaultWindow = 64;
+
+  //! Most input ports, one bit of the slot word each
+  static constexpr size_t kMaxPorts = 15;
+
+private:
+  static constexpr unsigned kSeqShift = 16;
+  static constexpr uint64_t kDone = 1ull << kMaxPorts;
+  static constexpr uint64_t kArrived = kDone - 1;
+
+  /*!
+   * \brief Copy of the packet delivered on a port, in a buffer of the port
+   */
+  struct input
+  {
+    uint32_t buffer_ = 0;
+    processor::input_paket paket_;
+  };
+
+  struct slot
+  {
+    std::atomic<uint64_t> state_;   //< sequence number << kSeqShift | kDone | ports arrived
+    std::vector<input> in_;         //< by port
+  };
+
+  /*!
+   * \brief Buffers of a port, taken by its producer and returned by the processing
+   *        thread once their packet is done, through a single producer single consumer
+   *        ring of their indices. A buffer is only allocated when none is free, so the
+   *        inputs arriving in turn keep reusing the same one, still in cache.
+   */
+  struct port_buffers
+  {
+    std::vector<pmt::pmt_t> items_;
+    std::vector<void*> data_;       //< items of each buffer
+    std::vector<const void*> of_;   //< vector each buffer was copied from, if it is from_
+    pmt::pmt_t from_;               //< vector the producer delivered last
+    const void* fromData_;
+    size_t bytes_;
+    std::vector<uint32_t> free_;
+    std::atomic<size_t> freeHead_;  //< taken by the producer of the port
+    std::atomic<size_t> freeTail_;  //< returned by the processing thread
+    uint32_t allocated_;            //< buffers in use so far
+    uint32_t spare_;                //< taken for an input which turned out late, used next
+    bool hasSpare_;
+
+    port_buffers() : fromData_(nullptr), bytes_(0), freeHead_(0), freeTail_(0), allocated_(0), spare_(0), hasSpare_(false) {}
+  };
+
+  std::vector<input_port> ports_;
+  process_fn process_;
+  uint64_t complete_;               //< all ports arrived
+  std::unique_ptr<slot[]> slots_;
+  size_t mask_;
+  std::unique_ptr<port_buffers[]> buffers_;
+
+  std::atomic<ObjectIDPaketSeqType> next_;   //< next packet to process
+  std::atomic<ObjectIDPaketSeqType> floor_;  //< packets before it are given up once incomplete
+  std::atomic<bool> busy_;                   //< a thread is processing
+
+  std::atomic<uint64_t> pakets_;
+  std::atomic<uint64_t> dropped_;
+  std::atomic<uint64_t> late_;
+
+  static uint64_t state(ObjectIDPaketSeqType seq, uint64_t bits) { return (seq << kSeqShift) | bits; }
+  static ObjectIDPaketSeqType seqOf(uint64_t state) { return state >> kSeqShift; }
+  static void raise(std::atomic<ObjectIDPaketSeqType>& value, ObjectIDPaketSeqType to);
+
+  slot& slotOf(ObjectIDPaketSeqType seq) { return slots_[seq & mask_]; }
+
+  uint32_t takeBuffer(size_t port);
+  void returnBuffers(slot& s, uint64_t arrived);
+  void store(size_t port, input& in, const processor& src, const pmt::pmt_t& items);
+
+  void fire(slot& s, ObjectIDPaketSeqType seq, uint64_t buffered, size_t direct, const processor* src, pmt::pmt_t* items);
+  void retire(slot& s, ObjectIDPaketSeqType seq, uint64_t buffered);
+  void finish(slot& s, ObjectIDPaketSeqType seq, uint64_t buffered);
+  ObjectIDPaketSeqType skipTo(ObjectIDPaketSeqType n);
+  bool reclaim(slot& s);
+  void processReady();
+  bool ready();
+  bool release();
+  void drain();
+
+public:
+  /*!
+   * \brief Align \p ports, processing the packets of port 0 with \p process, over a
+   *        window of \p window packets (rounded up to a power of two).
+   */
+  input_aligner(const std::vector<input_port>& ports, const process_fn& process, size_t window = kDefaultWindow);
+
+  /*!
+   * \brief Deliver the packet \p items which \p src has just emitted to input \p port,
+   *        and process the packets it completes. Thread safe, but the packets of a
+   *        port must be delivered by one thread at a time.
+   */
+  void deliver(size_t port, const processor& src, pmt::pmt_t& items);
+
+  /*!
+   * \brief Give up on the packets still missing an input. Called at the end of a run.
+   */
+  void flush();
+
+  const std::vector<input_port>& getPorts() const { return ports_; }
+  size_t getWindow() const { return mask_ + 1; }
+
+  //! Number of packets processed
+  uint64_t getPakets() const { return pakets_.load(std::memory_order_relaxed); }
+
+  //! Number of packets given up as they missed an input
+  uint64_t getDropped() const { return dropped_.load(std::memory_order_relaxed); }
+
+  //! Number of inputs which arrived after their packet was processed or given up
+  uint64_t getLate() const { return late_.load(std::memory_order_relaxed); }
+
+  typedef std::shared_ptr<input_aligner> sptr;
+};
+
+} // namespace pl_proc
+
+#endif /* INPUT_ALIGNER_H */
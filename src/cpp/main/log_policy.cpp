@@ -0,0 +1,165 @@
+/**
+ * @file   log_policy.cpp
+ *
+ * @author Armin Zare Zadeh ali.a.zarezadeh@gmail.com
+ *         Eric J. Mayo eric@pozicom.net
+ *
+ * @brief   log_policy.cpp includes the sampling and rate limiting policies of the tag event log
+ */
+
+#include "log_policy.h"
+#include "event_log.h"
+#include "logging.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+
+namespace pl_proc {
+
+log_policy::log_policy(mode m,
+                       uint64_t n,
+                       const std::vector<ObjectIDModuleType>& types,
+                       const std::vector<ObjectIDModuleIndexType>& indices,
+                       uint64_t seed)
+  : mode_(m),
+    n_(n),
+    types_(types),
+    indices_(indices),
+    seen_(0),
+    next_(0),
+    rng_(seed)
+{
+  if (mode_ != mode::ALL && n_ == 0)
+    throw std::invalid_argument("log policy needs __n__ > 0");
+  if (mode_ == mode::LAST_N || mode_ == mode::RESERVOIR)
+    retained_.reserve(n_);
+}
+
+log_policy::sptr log_policy::from_json(const json11::Json& cfg)
+{
+  if (!cfg.is_object())
+    throw std::invalid_argument("__log_policy__ must be a JSON object");
+
+  mode m;
+  const std::string name = cfg["__mode__"].is_null() ? "ALL" : cfg["__mode__"].string_value();
+  if      (name == "ALL")       m = mode::ALL;
+  else if (name == "EVERY_NTH") m = mode::EVERY_NTH;
+  else if (name == "FIRST_N")   m = mode::FIRST_N;
+  else if (name == "LAST_N")    m = mode::LAST_N;
+  else if (name == "RESERVOIR") m = mode::RESERVOIR;
+  else throw std::invalid_argument("unknown __log_policy__ __mode__: " + name);
+
+  std::vector<ObjectIDModuleType> types;
+  for (auto const& t : cfg["__module_types__"].array_items()) {
+    if (t.is_number()) {
+      types.push_back(static_cast<ObjectIDModuleType>(t.int_value()));
+      continue;
+    }
+    bool found = false;
+    for (unsigned k = 0; k <= static_cast<unsigned>(ModuleType::REORDER_MODULE); k++) {
+      if (moduleType2String(static_cast<ObjectIDModuleType>(k)) == t.string_value()) {
+        types.push_back(static_cast<ObjectIDModuleType>(k));
+        found = true;
+      }
+    }
+    if (!found)
+      throw std::invalid_argument("unknown __log_policy__ module type: " + t.string_value());
+  }
+
+  std::vector<ObjectIDModuleIndexType> indices;
+  for (auto const& i : cfg["__module_indices__"].array_items())
+    indices.push_back(static_cast<ObjectIDModuleIndexType>(i.int_value()));
+
+  return std::make_shared<log_policy>(m,
+                                      static_cast<uint64_t>(cfg["__n__"].int_value()),
+                                      types,
+                                      indices,
+                                      static_cast<uint64_t>(cfg["__seed__"].int_value()));
+}
+
+bool log_policy::matches(const tag_t& tag) const
+{
+  if (!types_.empty() && std::find(types_.begin(), types_.end(), tag.key_.GetModuleType()) == types_.end())
+    return false;
+  if (!indices_.empty() && std::find(indices_.begin(), indices_.end(), tag.key_.GetModuleIndex()) == indices_.end())
+    return false;
+  return true;
+}
+
+void log_policy::log(const tag_span& tags)
+{
+  for (const tag_t& tag : tags)
+    log(tag);
+}
+
+void log_policy::log(const tag_t& tag)
+{
+  if (!matches(tag))
+    return;
+
+  const uint64_t k = seen_.fetch_add(1, std::memory_order_relaxed);
+  switch (mode_)
+  {
+  case mode::ALL:
+    PL_Log::LogTag(tag);
+    break;
+  case mode::EVERY_NTH:
+    if (k % n_ == 0)
+      PL_Log::LogTag(tag);
+    break;
+  case mode::FIRST_N:
+    if (k < n_)
+      PL_Log::LogTag(tag);
+    break;
+  case mode::LAST_N:
+  {
+    // ring of the last n_ tags; the slots keep their payload capacity
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (retained_.size() < n_) {
+      retained_.emplace_back();
+      event_log::snapshot(tag, retained_.back());
+    } else {
+      event_log::snapshot(tag, retained_[next_]);
+      next_ = (next_ + 1) % n_;
+    }
+    break;
+  }
+  case mode::RESERVOIR:
+  {
+    // Algorithm R: tag k replaces a random slot with probability n_ / (k + 1)
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (retained_.size() < n_) {
+      retained_.emplace_back();
+      event_log::snapshot(tag, retained_.back());
+    } else {
+      const uint64_t j = std::uniform_int_distribution<uint64_t>(0, k)(rng_);
+      if (j < n_)
+        event_log::snapshot(tag, retained_[j]);
+    }
+    break;
+  }
+  }
+}
+
+void log_policy::finish()
+{
+  std::vector<event_record> retained;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    retained.swap(retained_);
+    std::rotate(retained.begin(), retained.begin() + std::min(next_, retained.size()), retained.end());
+    next_ = 0;
+    seen_ = 0;
+  }
+
+  if (mode_ == mode::RESERVOIR) {
+    std::stable_sort(retained.begin(), retained.end(), [](const event_record& x, const event_record& y) {
+      return x.stamp_ < y.stamp_;
+    });
+  }
+  for (auto& rec : retained)
+    PL_Log::LogRecord(std::move(rec));
+}
+
+} // namespace pl_proc
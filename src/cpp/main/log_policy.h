@@ -0,0 +1,114 @@
+/**
+ * @file   log_policy.h
+ *
+ * @author Armin Zare Zadeh ali.a.zarezadeh@gmail.com
+ *         Eric J. Mayo eric@pozicom.net
+ *
+ * @brief   log_policy.h includes the sampling and rate limiting policies of the tag event log
+ */
+
+#ifndef LOG_POLICY_H
+#define LOG_POLICY_H
+
+#include "noncopyable.h"
+#include "event_log_format.h"
+#include "json11.h"
+#include "tags.h"
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <vector>
+
+
+namespace pl_proc {
+
+/*!
+ * \brief Policy deciding which tags of a processor node connected to the logger
+ *        are written to the event log.
+ *
+ * \details
+ * The decision is taken on the tag header only, before the payload is copied or
+ * formatted, so the logging cost is bounded by the policy and not by the packet
+ * rate.  It is configured with a __log_policy__ object, either in __general__
+ * (default of all processor nodes) or in a processor node:
+ *
+ * \code
+ *   "__log_policy__": {"__mode__": "EVERY_NTH", "__n__": 100,
+ *                      "__module_types__": ["ADDER"], "__module_indices__": [3, 4]}
+ * \endcode
+ *
+ * - ALL:       every tag (default)
+ * - EVERY_NTH: every __n__-th tag, starting with the first one
+ * - FIRST_N:   the first __n__ tags
+ * - LAST_N:    the last __n__ tags, written by finish()
+ * - RESERVOIR: a uniform random sample of __n__ tags (seed __seed__), written by finish()
+ *
+ * Tags whose module type (name or number) or module index is not listed in the
+ * optional __module_types__ / __module_indices__ predicates are dropped first.
+ */
+class log_policy : noncopyable
+{
+public:
+  enum class mode { ALL, EVERY_NTH, FIRST_N, LAST_N, RESERVOIR };
+
+private:
+  mode mode_;
+  uint64_t n_;
+  std::vector<ObjectIDModuleType> types_;
+  std::vector<ObjectIDModuleIndexType> indices_;
+
+  std::atomic<uint64_t> seen_; //< tags matching the predicates so far
+
+  std::mutex mutex_;                  //< guards the retained records of LAST_N and RESERVOIR
+  std::vector<event_record> retained_;
+  size_t next_;                       //< oldest slot of the LAST_N ring
+  std::mt19937_64 rng_;
+
+public:
+  log_policy(mode m,
+             uint64_t n,
+             const std::vector<ObjectIDModuleType>& types = {},
+             const std::vector<ObjectIDModuleIndexType>& indices = {},
+             uint64_t seed = 0);
+
+  /*!
+   * \brief Create a policy out of a __log_policy__ JSON object.
+   *        Throws std::invalid_argument if it is malformed.
+   */
+  static std::shared_ptr<log_policy> from_json(const json11::Json& cfg);
+
+  /*!
+   * \brief True if the policy logs every tag, so the logger can be connected directly.
+   */
+  bool is_all() const { return mode_ == mode::ALL && types_.empty() && indices_.empty(); }
+
+  bool matches(const tag_t& tag) const;
+
+  /*!
+   * \brief Slot for the OnNewTag signal: log \p tag if the policy selects it.
+   */
+  void log(const tag_t& tag);
+
+  /*!
+   * \brief Slot for the OnNewTags signal: log the tags of the batch \p tags the policy selects.
+   */
+  void log(const tag_span& tags);
+
+  /*!
+   * \brief Write the tags retained by LAST_N and RESERVOIR, in time order, and
+   *        start over.
+   */
+  void finish();
+
+  mode getMode() const { return mode_; }
+  uint64_t getN() const { return n_; }
+
+  typedef std::shared_ptr<log_policy> sptr;
+};
+
+} // namespace pl_proc
+
+#endif /* LOG_POLICY_H */
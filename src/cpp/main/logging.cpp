@@ -23,6 +23,7 @@
  */
 
 #include "logging.h"
+#include "event_log.h"
 #include "id.h"
 #include "tags.h"
 #include "util.h"
@@ -89,14 +90,33 @@ LogLevel PL_Log::severity_threshold_ = LogLevel::INFO;
 std::string PL_Log::app_name_ = "";
 std::string PL_Log::log_dir_ = "";
 std::ofstream PL_Log::logfile_;
-std::ofstream PL_Log::eventLogfile_;
+event_log PL_Log::eventLog_;
 
 
 void PL_Log::StartLog(const std::string &app_name, LogLevel severity_threshold,
-                         const std::string &log_dir) {
+                         const std::string &log_dir, EventLogFormat event_log_format) {
   severity_threshold_ = severity_threshold;
   app_name_ = app_name;
   log_dir_ = log_dir;
+
+  JobRunID *jobRunId = jobRunId->getInstance();
+  std::string logFilename = log_dir_+ "pl_event_" + static_cast<std::stringstream>(*jobRunId).str() +
+                            (event_log_format == EventLogFormat::CSV ? ".log" : ".bin");
+  if (!eventLog_.open(logFilename, event_log_format)) {
+    LOG(FATAL, false) << "Open event logfile failure: " << logFilename;
+  } else {
+    LOG(INFO, false) << "Logging events into:" << logFilename;
+  }
+}
+
+void PL_Log::FlushLog() {
+  eventLog_.flush();
+}
+
+void PL_Log::StopLog() {
+  eventLog_.close();
+  if (logfile_.is_open())
+    logfile_.close();
 }
 
 bool PL_Log::IsLevelEnabled(LogLevel log_level) {
@@ -106,17 +126,19 @@ bool PL_Log::IsLevelEnabled(LogLevel log_level) {
 PL_Log::PL_Log(const char *file_name, int line_number, LogLevel severity, bool IsLogFile)
     // glog does not have DEBUG level, we can handle it using is_enabled_.
     : logging_provider_(nullptr), is_enabled_(severity >= severity_threshold_), is_fenabled_(IsLogFile) {
-  auto logging_provider = new CerrLog(severity);
-  if (is_enabled_){
-    if (severity == LogLevel::WARNING || severity == LogLevel::ERROR){
-      *logging_provider << get_date_string() << " " << file_name << ":" << line_number << ": ";
-    } else {
-      *logging_provider << getTimestamp() << " ";
+  // The provider is only needed to print to the console, or to abort on FATAL
+  if (is_enabled_ || severity == LogLevel::FATAL) {
+    auto logging_provider = new CerrLog(severity);
+    if (is_enabled_){
+      if (severity == LogLevel::WARNING || severity == LogLevel::ERROR){
+        *logging_provider << get_date_string() << " " << file_name << ":" << line_number << ": ";
+      } else {
+        *logging_provider << getTimestamp() << " ";
+      }
     }
+    logging_provider_ = logging_provider;
   }
 
-  logging_provider_ = logging_provider;
-
   if (!logfile_.is_open())
   {
     JobRunID *jobRunId = jobRunId->getInstance();
@@ -129,29 +151,6 @@ PL_Log::PL_Log(const char *file_name, int line_number, LogLevel severity, bool I
     }
   }
 
-  if (!eventLogfile_.is_open())
-  {
-    JobRunID *jobRunId = jobRunId->getInstance();
-    std::string logFilename = log_dir_+ "pl_event_" + static_cast<std::stringstream>(*jobRunId).str() + ".log";
-    eventLogfile_.open(logFilename.c_str(), std::ios::out | std::ios::app);
-    if (eventLogfile_.fail()) {
-      LOG(FATAL, false) << "Open event logfile failure: " << logFilename;
-    } else {
-      LOG(INFO, false) << "Logging events into:" << logFilename;
-    }
-
-    eventLogfile_ <<
-  	        "TimeStamp" <<
-  	        ", TimeTag" <<
-  	        ", RunID"  <<
-  	        ", ModuleTyp" <<
-  	        ", ModuleIdx" <<
-  	        ", PaketIdx" <<
-  	        ", DataTyp" <<
-  	        ", Data" <<
-  	        "\n";
-  }
-
   if (is_fenabled_) {
     if (severity == LogLevel::WARNING || severity == LogLevel::ERROR){
       logfile_ << get_date_string() << file_name << ":" << line_number << ": ";
@@ -161,150 +160,20 @@ PL_Log::PL_Log(const char *file_name, int line_number, LogLevel severity, bool I
   }
 }
 
-std::string moduleType2String(ObjectIDModuleType moduleType)
-{
-  std::stringstream os;
-
-  switch (moduleType)
-  {
-  case static_cast<ObjectIDModuleType>(ModuleType::ADDER_MODULE):
-  {
-    os << "ADDER";
-    break;
-  }
-  case static_cast<ObjectIDModuleType>(ModuleType::SRC_NOISE_MODULE):
-  {
-    os << "SRC_NOISE";
-    break;
-  }
-  case static_cast<ObjectIDModuleType>(ModuleType::SRC_VEC_MODULE):
-  {
-    os << "SRC_VEC";
-    break;
-  }
-  case static_cast<ObjectIDModuleType>(ModuleType::SINK_VEC_MODULE):
-  {
-    os << "SINK_VEC";
-    break;
-  }
-  default:
-    LOG(ERROR, true) << "ModuleType is unknown";
-    os << "UNKNOWN";
-  }
-
- return os.str();
+void PL_Log::LogTag(const tag_t& tag) {
+  eventLog_.push(tag);
 }
 
-void PL_Log::LogTag(tag_t tag) {
-
-  eventLogfile_ <<
-		  getTimestamp() <<
-		  ", " << tag.timetag_ <<
-		  ", "  << tag.key_.GetRunID() <<
-		  ", " << moduleType2String(tag.key_.GetModuleType()) <<
-		  ", " << unsigned(tag.key_.GetModuleIndex()) <<
-		  ", " << static_cast<uint32_t>(tag.key_.GetPaketIndex()) <<
-		  ", ";
-
-  std::stringstream os;
-
-  switch (tag.valueDataType_)
-  {
-  case pmt::DataType::GVEC_UINT8:
-  {
-    os << "GVEC_UINT8, ";
-    const std::vector<uint8_t> data = pmt::genVector_elements<uint8_t>(tag.value_);
-    for (auto i: data) os << unsigned(i) << ", ";
-    break;
-  }
-  case (pmt::DataType::GVEC_INT8):
-  {
-    os << "GVEC_INT8, ";
-    const std::vector<int8_t> data = pmt::genVector_elements<int8_t>(tag.value_);
-    for (auto i: data) os << i << ", ";
-    break;
-  }
-  case pmt::DataType::GVEC_UINT16:
-  {
-    os << "GVEC_UINT16, ";
-    const std::vector<uint16_t> data = pmt::genVector_elements<uint16_t>(tag.value_);
-    for (auto i: data) os << i << ", ";
-    break;
-  }
-  case pmt::DataType::GVEC_INT16:
-  {
-    os << "GVEC_INT16, ";
-    const std::vector<int16_t> data = pmt::genVector_elements<int16_t>(tag.value_);
-    for (auto i: data) os << i << ", ";
-    break;
-  }
-  case pmt::DataType::GVEC_INT32:
-  {
-    os << "GVEC_INT32, ";
-    const std::vector<int32_t> data = pmt::genVector_elements<int32_t>(tag.value_);
-    for (auto i: data) os << i << ", ";
-    break;
-  }
-  case pmt::DataType::GVEC_UINT32:
-  {
-    os << "GVEC_UINT32, ";
-    const std::vector<uint32_t> data = pmt::genVector_elements<uint32_t>(tag.value_);
-    for (auto i: data) os << i << ", ";
-    break;
-  }
-  case pmt::DataType::GVEC_INT64:
-  {
-    os << "GVEC_INT64, ";
-    const std::vector<int64_t> data = pmt::genVector_elements<int64_t>(tag.value_);
-    for (auto i: data) os << i << ", ";
-    break;
-  }
-  case pmt::DataType::GVEC_UINT64:
-  {
-    os << "GVEC_UINT64, ";
-    const std::vector<uint64_t> data = pmt::genVector_elements<uint64_t>(tag.value_);
-    for (auto i: data) os << i << ", ";
-    break;
-  }
-  case pmt::DataType::GVEC_FLOAT:
-  {
-    os << "GVEC_FLOAT, ";
-    const std::vector<float> data = pmt::genVector_elements<float>(tag.value_);
-    for (auto i: data) os << i << ", ";
-    break;
-  }
-  case pmt::DataType::GVEC_DOUBLE:
-  {
-    os << "GVEC_DOUBLE, ";
-    const std::vector<float> data = pmt::genVector_elements<float>(tag.value_);
-    for (auto i: data) os << i << ", ";
-    break;
-  }
-  case pmt::DataType::GVEC_COMPLEX_FLOAT:
-  {
-    os << "GVEC_COMPLEX_FLOAT, ";
-    const std::vector<std::complex<float>> data = pmt::genVector_elements<std::complex<float>>(tag.value_);
-    for (auto i: data) os << "(" << i.real() << ":" << i.imag() << "), ";
-    break;
-  }
-  case pmt::DataType::GVEC_COMPLEX_DOUBLE:
-  {
-    os << "GVEC_COMPLEX_DOUBLE, ";
-    const std::vector<std::complex<double>> data = pmt::genVector_elements<std::complex<double>>(tag.value_);
-    for (auto i: data) os << "(" << i.real() << ":" << i.imag() << "), ";
-    break;
-  }
-  default:
-    os << "UNKNOWN, ";
-    LOG(ERROR, true) << "pmt::DataType is unknown";
-  }
-
-  eventLogfile_ << os.str();
+void PL_Log::LogTags(const tag_span& tags) {
+  eventLog_.push(tags);
+}
 
-  eventLogfile_ << "\n";
+void PL_Log::LogRecord(event_record&& rec) {
+  eventLog_.push(std::move(rec));
 }
 
 std::ostream &PL_Log::Stream() {
+  // only called when is_enabled_, so the provider exists
   auto logging_provider = reinterpret_cast<LoggingProvider *>(logging_provider_);
   return logging_provider->Stream();
 }
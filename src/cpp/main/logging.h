@@ -47,15 +47,39 @@ enum { ERROR = 0 };
 namespace pl_proc {
 
 struct tag_t;
+struct tag_span;
+struct event_record;
+class event_log;
 
 enum class LogLevel { DEBUG = -1, INFO = 0, WARNING = 1, ERROR = 2, FATAL = 3 };
 
+/// Layout of the tag event log file: CSV text (.log), or length-prefixed binary
+/// records (.bin) optionally with PackBits compressed payloads, see event_log_format.h.
+enum class EventLogFormat { CSV = 0, BINARY = 1, BINARY_RLE = 2 };
+
+// Minimum log level compiled in, as the int value of a LogLevel: LOG calls below
+// it are removed at compile time, whatever the threshold given to StartLog.
+// Release builds keep WARNING and above, unless built with -DPL_LOG_MIN_LEVEL=<n>.
+#ifndef PL_LOG_MIN_LEVEL
+#ifdef NDEBUG
+#define PL_LOG_MIN_LEVEL 1
+#else
+#define PL_LOG_MIN_LEVEL -1
+#endif
+#endif
+
+constexpr bool IsLevelCompiled(LogLevel log_level) {
+  return static_cast<int>(log_level) >= PL_LOG_MIN_LEVEL || log_level == LogLevel::FATAL;
+}
+
 #define LOG_INTERNAL(level, log2file) ::pl_proc::PL_Log(__FILE__, __LINE__, level, log2file)
 
-#define LOG_ENABLED(level) pl_proc::PL_Log::IsLevelEnabled(pl_proc::LogLevel::level)
+#define LOG_ENABLED(level)                                       \
+  (pl_proc::IsLevelCompiled(pl_proc::LogLevel::level) &&         \
+   pl_proc::PL_Log::IsLevelEnabled(pl_proc::LogLevel::level))
 
 #define LOG(level, log2file)                                      \
-  if (pl_proc::PL_Log::IsLevelEnabled(pl_proc::LogLevel::level)) \
+  if (LOG_ENABLED(level))                                         \
   LOG_INTERNAL(pl_proc::LogLevel::level, log2file)
 
 #define IGNORE_EXPR(expr) ((void)(expr))
@@ -113,7 +137,9 @@ class LogBase {
 class PL_Log : public LogBase {
  public:
   PL_Log(const char *file_name, int line_number, LogLevel severity, bool IsLogFile);
-  static void LogTag(tag_t tag);
+  static void LogTag(const tag_t& tag);
+  static void LogTags(const tag_span& tags);
+  static void LogRecord(event_record&& rec);
 
   virtual ~PL_Log();
 
@@ -128,9 +154,17 @@ class PL_Log : public LogBase {
   /// \parem appName The app name which starts the log.
   /// \param severity_threshold Logging threshold for the program.
   /// \param logDir Logging output file name. If empty, the log won't output to file.
+  /// \param eventLogFormat Layout of the tag event log file.
   static void StartLog(const std::string &appName,
                        LogLevel severity_threshold = LogLevel::INFO,
-                       const std::string &logDir = "");
+                       const std::string &logDir = "",
+                       EventLogFormat eventLogFormat = EventLogFormat::CSV);
+
+  /// Block until all the tags logged so far are written to the event log file.
+  static void FlushLog();
+
+  /// Write the pending tags, stop the event log writer thread and close the log files.
+  static void StopLog();
 
   /// Return whether or not the log level is enabled in current setting.
   ///
@@ -154,7 +188,7 @@ class PL_Log : public LogBase {
   static std::string log_dir_;
 
   static std::ofstream logfile_;
-  static std::ofstream eventLogfile_;
+  static event_log eventLog_;
 
  protected:
   virtual std::ostream &Stream();
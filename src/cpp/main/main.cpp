@@ -52,6 +52,7 @@ int main()
   }
 
   LOG(INFO, true) << ", main, Pipeline Processing Framework Ends." << "\n";
+  pl_proc::PL_Log::StopLog();
 
   return 0;
 }
@@ -0,0 +1,106 @@
+/**
+ * @file   mpsc_queue.h
+ *
+ * @author Armin Zare Zadeh ali.a.zarezadeh@gmail.com
+ *         Eric J. Mayo eric@pozicom.net
+ *
+ * @brief   mpsc_queue.h includes a lock-free multi producer single consumer queue
+ */
+
+#ifndef MPSC_QUEUE_H
+#define MPSC_QUEUE_H
+
+#include "noncopyable.h"
+
+#include <atomic>
+#include <utility>
+
+
+namespace pl_proc {
+
+/*!
+ * \brief Unbounded lock-free multi producer single consumer FIFO queue.
+ *
+ * \details
+ * Node based queue after Dmitry Vyukov's intrusive MPSC queue: a producer links
+ * its node with a single atomic exchange on the head, so push() never waits on
+ * other producers nor on the consumer.  Only one thread may call pop() / empty().
+ * A pushed item may become visible to the consumer slightly after push() returns,
+ * when a concurrent producer is preempted between its exchange and its link.
+ */
+template <class T>
+class mpsc_queue : noncopyable
+{
+private:
+  struct node
+  {
+    std::atomic<node*> next_;
+    T value_;
+
+    node() : next_(nullptr) {}
+    explicit node(T&& value) : next_(nullptr), value_(std::move(value)) {}
+  };
+
+  std::atomic<node*> head_; //< last pushed node, shared by the producers
+  node* tail_;              //< consumed stub node, owned by the consumer
+
+public:
+  mpsc_queue() : head_(new node()), tail_(head_.load(std::memory_order_relaxed)) {}
+
+  ~mpsc_queue()
+  {
+    T value;
+    while (pop(value)) {}
+    delete tail_;
+  }
+
+  void push(T value)
+  {
+    node* n = new node(std::move(value));
+    node* prev = head_.exchange(n, std::memory_order_acq_rel);
+    prev->next_.store(n, std::memory_order_release);
+  }
+
+  /*!
+   * \brief Move the items [\p first, \p last) to the queue, in order; they are linked
+   *        together first, then to the queue with a single exchange.
+   */
+  template <class It>
+  void push(It first, It last)
+  {
+    if (first == last)
+      return;
+
+    node* head = new node(std::move(*first));
+    node* tail = head;
+    for (++first; first != last; ++first) {
+      node* n = new node(std::move(*first));
+      tail->next_.store(n, std::memory_order_relaxed);
+      tail = n;
+    }
+    node* prev = head_.exchange(tail, std::memory_order_acq_rel);
+    prev->next_.store(head, std::memory_order_release);
+  }
+
+  /*!
+   * \brief Move the oldest item into \p value; returns false if there is none.
+   */
+  bool pop(T& value)
+  {
+    node* tail = tail_;
+    node* next = tail->next_.load(std::memory_order_acquire);
+    if (next == nullptr)
+      return false;
+
+    value = std::move(next->value_);
+    tail_ = next;
+    delete tail;
+    return true;
+  }
+
+  bool empty() const { return tail_->next_.load(std::memory_order_acquire) == nullptr; }
+};
+
+} // namespace pl_proc
+
+#endif /* MPSC_QUEUE_H */
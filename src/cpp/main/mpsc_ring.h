@@ -0,0 +1,117 @@
+/**
+ * @file   mpsc_ring.h
+ *
+ * @author Armin Zare Zadeh ali.a.zarezadeh@gmail.com
+ *         Eric J. Mayo eric@pozicom.net
+ *
+ * @brief   mpsc_ring.h includes a bounded multi producer single consumer ring
+ *          whose items are filled and consumed in place
+ */
+
+#ifndef MPSC_RING_H
+#define MPSC_RING_H
+
+#include "noncopyable.h"
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <thread>
+
+
+namespace pl_proc {
+
+/*!
+ * \brief Bounded multi producer single consumer FIFO ring of items which stay in
+ *        place, so the capacity they hold (e.g. a vector) is reused lap after lap.
+ *
+ * \details
+ * After Dmitry Vyukov's bounded queue: every cell carries the position it expects
+ * next.  A producer claims positions with a single fetch_add on the head, waits
+ * until the cell of each one is free (the ring is full otherwise), fills the item
+ * in place and publishes it; the consumer reads the item at the tail in place and
+ * frees its cell for the next lap.  Nothing is allocated after construction.  A
+ * producer preempted between its claim and its publication holds the consumer back
+ * at its position, as the items are consumed in order.  Only one thread may call
+ * front() / pop() / empty().
+ */
+template <class T>
+class mpsc_ring : noncopyable
+{
+private:
+  struct cell
+  {
+    std::atomic<size_t> seq_; //< position the cell is free for, or that position + 1 once published
+    T value_;
+  };
+
+  std::unique_ptr<cell[]> cells_;
+  size_t mask_;
+  std::atomic<size_t> head_; //< next position to claim, shared by the producers
+  size_t tail_;              //< next position to consume, owned by the consumer
+
+public:
+  /*!
+   * \brief Ring of \p capacity items, rounded up to a power of two.
+   */
+  explicit mpsc_ring(size_t capacity) : mask_(0), head_(0), tail_(0)
+  {
+    size_t n = 2;
+    while (n < capacity)
+      n <<= 1;
+    cells_.reset(new cell[n]);
+    mask_ = n - 1;
+    for (size_t i = 0; i < n; i++)
+      cells_[i].seq_.store(i, std::memory_order_relaxed);
+  }
+
+  size_t capacity() const { return mask_ + 1; }
+
+  /*!
+   * \brief Claim \p n consecutive positions, returning the first one; each one
+   *        must then be filled with acquire() and published with publish(), in order.
+   */
+  size_t claim(size_t n = 1) { return head_.fetch_add(n, std::memory_order_relaxed); }
+
+  /*!
+   * \brief Item of the claimed position \p pos, once the consumer has freed its cell.
+   */
+  T& acquire(size_t pos)
+  {
+    cell& c = cells_[pos & mask_];
+    while (c.seq_.load(std::memory_order_acquire) != pos)
+      std::this_thread::yield(); // full: wait for the consumer
+    return c.value_;
+  }
+
+  /*!
+   * \brief Hand the item of position \p pos over to the consumer.
+   */
+  void publish(size_t pos) { cells_[pos & mask_].seq_.store(pos + 1, std::memory_order_release); }
+
+  /*!
+   * \brief Oldest published item, or null if there is none.
+   */
+  T* front()
+  {
+    cell& c = cells_[tail_ & mask_];
+    if (c.seq_.load(std::memory_order_acquire) != tail_ + 1)
+      return nullptr;
+    return &c.value_;
+  }
+
+  /*!
+   * \brief Free the cell of the item front() returned, for the next lap.
+   */
+  void pop()
+  {
+    cells_[tail_ & mask_].seq_.store(tail_ + mask_ + 1, std::memory_order_release);
+    tail_++;
+  }
+
+  bool empty() const { return cells_[tail_ & mask_].seq_.load(std::memory_order_acquire) != tail_ + 1; }
+};
+
+} // namespace pl_proc
+
+#endif /* MPSC_RING_H */
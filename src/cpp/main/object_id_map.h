@@ -0,0 +1,253 @@
+/**
+ * @file   object_id_map.h
+ *
+ * @author Armin Zare Zadeh ali.a.zarezadeh@gmail.com
+ *         Eric J. Mayo eric@pozicom.net
+ *
+ * @brief   object_id_map.h includes a lock-free hash map keyed by ObjectID
+ */
+
+#ifndef OBJECT_ID_MAP_H
+#define OBJECT_ID_MAP_H
+
+#include "id.h"
+#include "noncopyable.h"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <type_traits>
+
+
+namespace pl_proc {
+
+/*!
+ * \brief Lock-free open addressing hash map from ObjectID to V, of fixed capacity,
+ *        to index in-flight packets, retransmissions or tags by object id.
+ *
+ * \details
+ * The map is keyed by ObjectID::PackedKey(), so an id is not hashed with the
+ * MurmurHash of BaseID::Hash() nor compared byte by byte: the slot of a key is the
+ * top bits of a single multiply of its packed bits (Fibonacci hashing), which
+ * scatters the consecutive packets of the modules over the table.  Collisions are
+ * resolved by linear probing.
+ *
+ * Every slot holds its key and its value in two atomics.  An insert claims a free
+ * slot with a compare-and-swap of its key to a busy mark, stores the value and
+ * then publishes the key, so find() never sees a key without its value.  An erased
+ * slot is left as a tombstone, reused by the next insert probing through it.  The
+ * map tracks the longest probe any insert needed, so a lookup stops after that
+ * many slots instead of searching for an empty slot past the tombstones, which a
+ * sliding window of packet indices leaves all around the table.
+ *
+ * Any thread may insert, find and erase concurrently, except that one key must not
+ * be inserted by two threads at the same time.  A find() concurrent with an erase()
+ * and a new insert() of the same key may return either value.  clear() is not
+ * thread safe.  V must be trivially copyable and lock-free as a std::atomic (a
+ * pointer, an index, ...).  The three largest keys are reserved: ids with the
+ * all-ones run id, module type and module index, and one of the packet indices
+ * 0xfffffffd to 0xffffffff (e.g. Nil), are never stored.
+ */
+template <class V>
+class object_id_map : noncopyable
+{
+  static_assert(std::is_trivially_copyable<V>::value, "object_id_map values must be trivially copyable");
+  static_assert(std::atomic<V>::is_always_lock_free, "object_id_map values must be lock-free atomics");
+
+public:
+  using key_type = uint64_t;
+
+  //! Key of the never used slots, the packed Nil id
+  static constexpr key_type kEmpty = ~key_type(0);
+  //! Key of the erased slots
+  static constexpr key_type kTombstone = kEmpty - 1;
+  //! Key of the slots being written by an insert
+  static constexpr key_type kBusy = kEmpty - 2;
+
+private:
+  struct slot
+  {
+    std::atomic<key_type> key_;
+    std::atomic<V> value_;
+
+    slot() : key_(kEmpty), value_(V()) {}
+  };
+
+  std::unique_ptr<slot[]> slots_;
+  size_t capacity_;
+  size_t mask_;
+  unsigned shift_;
+  std::atomic<size_t> size_;
+  std::atomic<size_t> maxProbe_; //< every key is at most that many slots after its own
+
+  size_t index_of(key_type key) const
+  {
+    return static_cast<size_t>((key * 0x9e3779b97f4a7c15ull) >> shift_);
+  }
+
+  /*!
+   * \brief Slot holding \p key, or capacity_ if there is none.
+   */
+  size_t lookup(key_type key) const
+  {
+    const size_t probe = maxProbe_.load(std::memory_order_acquire);
+    size_t i = index_of(key);
+    for (size_t n = 0; n <= probe; n++, i = (i + 1) & mask_) {
+      const key_type k = slots_[i].key_.load(std::memory_order_acquire);
+      if (k == key)
+        return i;
+      if (k == kEmpty)
+        break;
+    }
+    return capacity_;
+  }
+
+  /*!
+   * \brief Claim a slot for \p key, which is not in the map, and store \p value in it.
+   *        Returns false if \p key was found after all or the map is full.
+   */
+  bool claim(key_type key, V value)
+  {
+    for (;;) {
+      const size_t probe = maxProbe_.load(std::memory_order_acquire);
+      size_t i = index_of(key);
+      size_t free = capacity_, dist = 0;
+      key_type expected = kEmpty;
+      for (size_t n = 0; n < capacity_; n++, i = (i + 1) & mask_) {
+        const key_type k = slots_[i].key_.load(std::memory_order_acquire);
+        if (k == key)
+          return false;
+        if ((k == kTombstone || k == kEmpty) && free == capacity_) {
+          free = i;
+          dist = n;
+          expected = k;
+        }
+        // past the longest probe, only a free slot is still looked for
+        if (k == kEmpty || (n >= probe && free != capacity_))
+          break;
+      }
+      if (free == capacity_)
+        return false; // Full!
+
+      // lost the slot to a concurrent insert: probe again
+      if (!slots_[free].key_.compare_exchange_strong(expected, kBusy, std::memory_order_acquire))
+        continue;
+
+      size_t longest = probe;
+      while (longest < dist && !maxProbe_.compare_exchange_weak(longest, dist, std::memory_order_release)) {}
+
+      slots_[free].value_.store(value, std::memory_order_relaxed);
+      slots_[free].key_.store(key, std::memory_order_release);
+      size_.fetch_add(1, std::memory_order_relaxed);
+      return true;
+    }
+  }
+
+public:
+  //! Default number of slots of a map
+  static constexpr size_t kDefaultCapacity = 1024;
+
+  explicit object_id_map(size_t capacity = kDefaultCapacity)
+    : capacity_(2), mask_(0), shift_(63), size_(0), maxProbe_(0)
+  {
+    while (capacity_ < capacity) {
+      capacity_ <<= 1;
+      shift_--;
+    }
+    mask_ = capacity_ - 1;
+    slots_.reset(new slot[capacity_]);
+  }
+
+  size_t capacity() const { return capacity_; }
+
+  //! Number of keys in the map, exact when no update is in progress
+  size_t size() const { return size_.load(std::memory_order_relaxed); }
+  bool empty() const { return size() == 0; }
+
+  /*!
+   * \brief Map \p key to \p value unless \p key is already in the map.
+   *        Returns false if it is, or the map is full, or \p key is reserved.
+   */
+  bool insert(key_type key, V value)
+  {
+    if (key >= kBusy)
+      return false;
+    return claim(key, value);
+  }
+
+  bool insert(const ObjectID& id, V value) { return insert(id.PackedKey(), value); }
+
+  /*!
+   * \brief Map \p key to \p value, replacing the value of \p key if it is in the map.
+   *        Returns false if the map is full or \p key is reserved.
+   */
+  bool insert_or_assign(key_type key, V value)
+  {
+    if (key >= kBusy)
+      return false;
+    for (;;) {
+      const size_t i = lookup(key);
+      if (i != capacity_) {
+        slots_[i].value_.store(value, std::memory_order_release);
+        return true;
+      }
+      if (claim(key, value))
+        return true;
+      // claim() fails on a full map or on a key inserted meanwhile
+      if (lookup(key) == capacity_)
+        return false;
+    }
+  }
+
+  bool insert_or_assign(const ObjectID& id, V value) { return insert_or_assign(id.PackedKey(), value); }
+
+  /*!
+   * \brief Copy the value of \p key to \p value. Returns false if \p key is not in the map.
+   */
+  bool find(key_type key, V& value) const
+  {
+    const size_t i = lookup(key);
+    if (i == capacity_)
+      return false;
+    value = slots_[i].value_.load(std::memory_order_acquire);
+    return true;
+  }
+
+  bool find(const ObjectID& id, V& value) const { return find(id.PackedKey(), value); }
+
+  bool contains(key_type key) const { return lookup(key) != capacity_; }
+  bool contains(const ObjectID& id) const { return contains(id.PackedKey()); }
+
+  /*!
+   * \brief Remove \p key from the map. Returns false if it is not in the map.
+   */
+  bool erase(key_type key)
+  {
+    const size_t i = lookup(key);
+    if (i == capacity_)
+      return false;
+    key_type expected = key;
+    if (!slots_[i].key_.compare_exchange_strong(expected, kTombstone, std::memory_order_acq_rel))
+      return false; // erased by a concurrent erase
+    size_.fetch_sub(1, std::memory_order_relaxed);
+    return true;
+  }
+
+  bool erase(const ObjectID& id) { return erase(id.PackedKey()); }
+
+  /*!
+   * \brief Remove all the keys and tombstones. Not thread safe.
+   */
+  void clear()
+  {
+    for (size_t i = 0; i < capacity_; i++)
+      slots_[i].key_.store(kEmpty, std::memory_order_relaxed);
+    size_.store(0, std::memory_order_relaxed);
+    maxProbe_.store(0, std::memory_order_relaxed);
+  }
+};
+
+} // namespace pl_proc
+
+#endif /* OBJECT_ID_MAP_H */
@@ -19,7 +19,8 @@
 #include <stdio.h>
 #include <string.h>
 #include <vector>
-#include <mutex>
+#include <atomic>
+#include <memory>
 
 
 namespace pl_proc {
@@ -137,65 +138,183 @@ bool to_bool(pmt_t val)
 //                             Symbols
 ////////////////////////////////////////////////////////////////////////////
 
-static const unsigned int get_symbol_hash_table_size()
+/*
+ * The symbol table is a lock-free, resizable hash table.
+ *
+ * Symbols are never destroyed, so the table only ever grows.  Each bucket is a
+ * singly linked list of immutable entries and a new entry is published by a CAS
+ * on the bucket head, so lookups never block and concurrent inserts only retry.
+ *
+ * When the load factor gets too high one thread allocates a table of twice the
+ * size and migrates the buckets one at a time.  A bucket is sealed with the
+ * MOVED marker only after all of its entries have been copied into the new
+ * table, and a thread that hits a sealed bucket continues in the successor
+ * table.  Since a new bucket only receives entries from a single old bucket,
+ * every name lives in exactly one reachable chain and can never be interned
+ * twice.  Retired tables are kept alive because readers may still walk them;
+ * as the size doubles, they never cost more than the live table.
+ */
+namespace {
+
+struct symbol_entry {
+  pmt_t sym;                // owns the symbol
+  const pmt_symbol* raw;    // same object, saves a dynamic_cast on lookup
+  const symbol_entry* next;
+};
+
+struct symbol_table {
+  explicit symbol_table(size_t size)
+    : d_size(size), d_buckets(new std::atomic<const symbol_entry*>[size]), d_next(nullptr)
+  {
+    for (size_t i = 0; i < d_size; i++)
+      d_buckets[i].store(nullptr, std::memory_order_relaxed);
+  }
+
+  std::atomic<const symbol_entry*>& bucket(unsigned int hash) { return d_buckets[hash & (d_size - 1)]; }
+
+  const size_t d_size; // always a power of two
+  std::unique_ptr<std::atomic<const symbol_entry*>[]> d_buckets;
+  std::atomic<symbol_table*> d_next; // successor table, set when a resize starts
+};
+
+const size_t SYMBOL_TABLE_INITIAL_SIZE = 1024;
+const size_t SYMBOL_TABLE_MAX_LOAD = 2;
+
+const symbol_entry* moved_marker()
 {
-  static const unsigned int SYMBOL_HASH_TABLE_SIZE = 701;
-  return SYMBOL_HASH_TABLE_SIZE;
+  static const symbol_entry s_moved{ pmt_t(), nullptr, nullptr };
+  return &s_moved;
 }
 
-static std::vector<pmt_t>* get_symbol_hash_table()
+// oldest table that may still hold unsealed buckets; lookups start here
+std::atomic<symbol_table*>& symbol_table_root()
 {
-  static std::vector<pmt_t> s_symbol_hash_table(get_symbol_hash_table_size());
-  return &s_symbol_hash_table;
+  static std::atomic<symbol_table*> s_root(new symbol_table(SYMBOL_TABLE_INITIAL_SIZE));
+  return s_root;
 }
 
-pmt_symbol::pmt_symbol(const std::string& name) : d_name(name) {}
+std::atomic<size_t> s_symbol_count(0);
+std::atomic<bool> s_symbol_table_resizing(false);
 
+const symbol_entry* find_in_chain(const symbol_entry* e, const std::string& name, unsigned int hash)
+{
+  for (; e; e = e->next) {
+    if (e->raw->hash() == hash && e->raw->name() == name)
+      return e;
+  }
+  return nullptr;
+}
+
+// Copy an entry of a table being migrated into its successor (idempotent).
+void copy_symbol_entry(symbol_table* to, const symbol_entry* from)
+{
+  std::atomic<const symbol_entry*>& bucket = to->bucket(from->raw->hash());
+  const symbol_entry* head = bucket.load(std::memory_order_acquire);
+  for (;;) {
+    for (const symbol_entry* e = head; e; e = e->next) {
+      if (e->raw == from->raw)
+        return;
+    }
+    const symbol_entry* entry = new symbol_entry{ from->sym, from->raw, head };
+    if (bucket.compare_exchange_weak(head, entry, std::memory_order_release, std::memory_order_acquire))
+      return;
+    delete entry;
+  }
+}
+
+// Double the size of the newest table \p from; called by a single thread only.
+void grow_symbol_table(symbol_table* from)
+{
+  symbol_table* to = new symbol_table(from->d_size * 2);
+  from->d_next.store(to, std::memory_order_release);
+
+  for (size_t i = 0; i < from->d_size; i++) {
+    std::atomic<const symbol_entry*>& bucket = from->d_buckets[i];
+    const symbol_entry* head = bucket.load(std::memory_order_acquire);
+    for (;;) {
+      for (const symbol_entry* e = head; e; e = e->next)
+        copy_symbol_entry(to, e);
+      // fails if a new symbol was pushed meanwhile; copy again and retry
+      if (bucket.compare_exchange_weak(head, moved_marker(), std::memory_order_acq_rel, std::memory_order_acquire))
+        break;
+    }
+  }
+
+  symbol_table_root().store(to, std::memory_order_release);
+}
 
+void maybe_grow_symbol_table(symbol_table* table, size_t count)
+{
+  if (count <= table->d_size * SYMBOL_TABLE_MAX_LOAD || table->d_next.load(std::memory_order_acquire))
+    return;
+
+  bool expected = false;
+  if (!s_symbol_table_resizing.compare_exchange_strong(expected, true, std::memory_order_acq_rel))
+    return; // somebody else is already at it
+
+  // re-check now that we own the resize: \p table must still be the newest one
+  if (symbol_table_root().load(std::memory_order_acquire) == table &&
+      !table->d_next.load(std::memory_order_acquire))
+    grow_symbol_table(table);
+
+  s_symbol_table_resizing.store(false, std::memory_order_release);
+}
+
+} // namespace
+
+// FNV-1a; unlike the classic ELF hash its low bits are well mixed, which
+// matters because the table is indexed by masking.
 static unsigned int hash_string(const std::string& s)
 {
-  unsigned int h = 0;
-  unsigned int g = 0;
+  unsigned int h = 2166136261u;
 
   for (std::string::const_iterator p = s.begin(); p != s.end(); ++p) {
-      h = (h << 4) + (*p & 0xff);
-      g = h & 0xf0000000;
-      if (g) {
-          h = h ^ (g >> 24);
-          h = h ^ g;
-        }
+      h ^= static_cast<unsigned char>(*p);
+      h *= 16777619u;
     }
   return h;
 }
 
+pmt_symbol::pmt_symbol(const std::string& name, unsigned int hash) : d_name(name), d_hash(hash) {}
+
 bool is_symbol(const pmt_t& obj) { return obj->is_symbol(); }
 
 pmt_t string_to_symbol(const std::string& name)
 {
-  unsigned hash = hash_string(name) % get_symbol_hash_table_size();
+  const unsigned int hash = hash_string(name);
+  symbol_table* table = symbol_table_root().load(std::memory_order_acquire);
+  pmt_t sym;
+  pmt_symbol* raw = nullptr;
 
-  // Does a symbol with this name already exist?
-  for (pmt_t sym = (*get_symbol_hash_table())[hash]; sym; sym = _symbol(sym)->next()) {
-      if (name == _symbol(sym)->name())
-        return sym; // Yes.  Return it
+  for (;;) {
+    std::atomic<const symbol_entry*>& bucket = table->bucket(hash);
+    const symbol_entry* head = bucket.load(std::memory_order_acquire);
+
+    // Sealed by a resize?  Then the bucket's content lives in the successor.
+    if (head == moved_marker()) {
+      table = table->d_next.load(std::memory_order_acquire);
+      continue;
     }
 
-  // Lock the table on insert for thread safety:
-  static std::mutex thread_safety;
+    // Does a symbol with this name already exist?
+    if (const symbol_entry* e = find_in_chain(head, name, hash))
+      return e->sym; // Yes.  Return it
+
+    // Nope.  Make a new one (only once, even if we have to retry).
+    if (!raw) {
+      raw = new pmt_symbol(name, hash);
+      sym = pmt_t(raw);
+    }
 
-  std::lock_guard<std::mutex> locker(thread_safety);
-  // Re-do the search in case another thread inserted this symbol into the table
-  // before we got the lock
-  for (pmt_t sym = (*get_symbol_hash_table())[hash]; sym; sym = _symbol(sym)->next()) {
-      if (name == _symbol(sym)->name())
-        return sym; // Yes.  Return it
+    const symbol_entry* entry = new symbol_entry{ sym, raw, head };
+    if (bucket.compare_exchange_strong(head, entry, std::memory_order_release, std::memory_order_acquire)) {
+      maybe_grow_symbol_table(table, s_symbol_count.fetch_add(1, std::memory_order_relaxed) + 1);
+      return sym;
     }
 
-  // Nope.  Make a new one.
-  pmt_t sym = pmt_t(new pmt_symbol(name));
-  _symbol(sym)->set_next((*get_symbol_hash_table())[hash]);
-  (*get_symbol_hash_table())[hash] = sym;
-  return sym;
+    // Lost the race against another insert or a resize; look again.
+    delete entry;
+  }
 }
 
 // alias...
@@ -209,6 +328,14 @@ const std::string symbol_to_string(const pmt_t& sym)
   return _symbol(sym)->name();
 }
 
+unsigned int symbol_hash(const pmt_t& sym)
+{
+  if (!sym->is_symbol())
+    throw wrong_type("pmt_symbol_hash", sym);
+
+  return _symbol(sym)->hash();
+}
+
 
 ////////////////////////////////////////////////////////////////////////////
 //                             Number
@@ -111,6 +111,24 @@ inline DataType TypeFromString(const std::string& s)
 }
 
 
+/*!
+ * \brief Compile-time mapping from the item type of a genVector to its DataType.
+ */
+template <class T> struct genVector_traits { static constexpr DataType type = DataType::UNKNOWN; };
+template <> struct genVector_traits<uint8_t> { static constexpr DataType type = DataType::GVEC_UINT8; };
+template <> struct genVector_traits<int8_t> { static constexpr DataType type = DataType::GVEC_INT8; };
+template <> struct genVector_traits<uint16_t> { static constexpr DataType type = DataType::GVEC_UINT16; };
+template <> struct genVector_traits<int16_t> { static constexpr DataType type = DataType::GVEC_INT16; };
+template <> struct genVector_traits<uint32_t> { static constexpr DataType type = DataType::GVEC_UINT32; };
+template <> struct genVector_traits<int32_t> { static constexpr DataType type = DataType::GVEC_INT32; };
+template <> struct genVector_traits<uint64_t> { static constexpr DataType type = DataType::GVEC_UINT64; };
+template <> struct genVector_traits<int64_t> { static constexpr DataType type = DataType::GVEC_INT64; };
+template <> struct genVector_traits<float> { static constexpr DataType type = DataType::GVEC_FLOAT; };
+template <> struct genVector_traits<double> { static constexpr DataType type = DataType::GVEC_DOUBLE; };
+template <> struct genVector_traits<std::complex<float>> { static constexpr DataType type = DataType::GVEC_COMPLEX_FLOAT; };
+template <> struct genVector_traits<std::complex<double>> { static constexpr DataType type = DataType::GVEC_COMPLEX_DOUBLE; };
+
+
 /*!
  * \brief base class of all pmt types
  */
@@ -238,6 +256,14 @@ pmt_t intern(const std::string& s);
  */
 const std::string symbol_to_string(const pmt_t& sym);
 
+/*!
+ * If \p is a symbol, return the hash of its name that was computed once when
+ * the symbol was interned.  Symbols are unique, so two symbols are equal iff
+ * they are the same object; the hash is meant for hashed containers.
+ * Otherwise, raise the wrong_type exception.
+ */
+unsigned int symbol_hash(const pmt_t& sym);
+
 /*
  * ------------------------------------------------------------------------
  *           Numbers: we support integer, real and complex
@@ -560,6 +586,8 @@ template <class T> pmt_t init_genVector(size_t k, const std::vector<T>& data);
 template <class T> T genVector_ref(pmt_t v, size_t k);
 template <class T> void genVector_set(pmt_t v, size_t k, T x);
 template <class T> void genVector_fill(pmt_t v, T x);
+//! new genVector holding a copy of the items of the genVector \p v, of any item type
+pmt_t genVector_copy(pmt_t v);
 // Return const pointers to the elements
 
 const void*
@@ -34,18 +34,16 @@ public:
 
 class pmt_symbol : public pmt_base
 {
-    std::string d_name;
-    pmt_t d_next;
+    const std::string d_name;
+    const unsigned int d_hash; // cached hash of d_name, computed once at intern time
 
 public:
-    pmt_symbol(const std::string& name);
+    pmt_symbol(const std::string& name, unsigned int hash);
     //~pmt_symbol(){}
 
     bool is_symbol() const { return true; }
-    const std::string name() { return d_name; }
-
-    pmt_t next() { return d_next; } // symbol table link
-    void set_next(pmt_t next) { d_next = next; }
+    const std::string& name() const { return d_name; }
+    unsigned int hash() const { return d_hash; }
 };
 
 class pmt_integer : public pmt_base
@@ -137,25 +137,16 @@ const std::string pmt_genVector<T>::string_ref(size_t k) const
 template <class T>
 DataType pmt_genVector<T>::check_type() const
 {
-  if (std::is_same<T, uint8_t>::value) { return DataType::GVEC_UINT8; }
-  if (std::is_same<T, int8_t>::value) { return DataType::GVEC_INT8; }
-  if (std::is_same<T, uint16_t>::value) { return DataType::GVEC_UINT16; }
-  if (std::is_same<T, int16_t>::value) { return DataType::GVEC_INT16; }
-  if (std::is_same<T, uint32_t>::value) { return DataType::GVEC_INT32; }
-  if (std::is_same<T, int32_t>::value) { return DataType::GVEC_UINT32; }
-  if (std::is_same<T, uint64_t>::value) { return DataType::GVEC_INT64; }
-  if (std::is_same<T, int64_t>::value) { return DataType::GVEC_UINT64; }
-  if (std::is_same<T, float>::value) { return DataType::GVEC_FLOAT; }
-  if (std::is_same<T, double>::value) { return DataType::GVEC_DOUBLE; }
-  if (std::is_same<T, std::complex<float>>::value) { return DataType::GVEC_COMPLEX_FLOAT; }
-  if (std::is_same<T, std::complex<double>>::value) { return DataType::GVEC_COMPLEX_DOUBLE; }
-
-  return DataType::UNKNOWN;
+  return genVector_traits<T>::type;
 }
 
 
 template <class T>
-bool is_genVector(pmt_t obj) { return _genVector<T>(obj)->is_genVector(); }
+bool is_genVector(pmt_t obj)
+{
+  pmt_genVector<T>* v = _genVector<T>(obj);
+  return v && v->is_genVector();
+}
 
 template bool is_genVector<uint8_t>(pmt_t obj);
 template bool is_genVector<int8_t>(pmt_t obj);
@@ -541,6 +532,32 @@ template double* genVector_writable_raw<double>(pmt_t vector);
 template std::complex<float>* genVector_writable_raw<std::complex<float>>(pmt_t vector);
 template std::complex<double>* genVector_writable_raw<std::complex<double>>(pmt_t vector);
 
+
+template <class T>
+static pmt_t copy_genVector(pmt_genVector<T>* v)
+{
+  size_t len;
+  const T* data = v->elements(len);
+  return pmt_t(new pmt_genVector<T>(len, data));
+}
+
+pmt_t genVector_copy(pmt_t vector)
+{
+  if (auto v = _genVector<uint8_t>(vector))              return copy_genVector(v);
+  if (auto v = _genVector<int8_t>(vector))               return copy_genVector(v);
+  if (auto v = _genVector<uint16_t>(vector))             return copy_genVector(v);
+  if (auto v = _genVector<int16_t>(vector))              return copy_genVector(v);
+  if (auto v = _genVector<uint32_t>(vector))             return copy_genVector(v);
+  if (auto v = _genVector<int32_t>(vector))              return copy_genVector(v);
+  if (auto v = _genVector<uint64_t>(vector))             return copy_genVector(v);
+  if (auto v = _genVector<int64_t>(vector))              return copy_genVector(v);
+  if (auto v = _genVector<float>(vector))                return copy_genVector(v);
+  if (auto v = _genVector<double>(vector))               return copy_genVector(v);
+  if (auto v = _genVector<std::complex<float>>(vector))  return copy_genVector(v);
+  if (auto v = _genVector<std::complex<double>>(vector)) return copy_genVector(v);
+  throw wrong_type("pmt_genVector_copy", vector);
+}
+
 } /* namespace pmt */
 
 } // namespace pl_proc
@@ -0,0 +1,142 @@
+/**
+ * @file   proc_stats.cpp
+ *
+ * @author Armin Zare Zadeh ali.a.zarezadeh@gmail.com
+ *         Eric J. Mayo eric@pozicom.net
+ *
+ * @brief   proc_stats.cpp includes the latency and throughput instrumentation of processor nodes
+ */
+
+#include "proc_stats.h"
+
+#include <algorithm>
+#include <iomanip>
+#include <limits>
+#include <ostream>
+
+
+namespace pl_proc {
+
+std::atomic<bool> proc_stats::enabled_(false);
+
+namespace {
+
+// Time spent in the instrumented calls nested into the current one, on this thread
+thread_local uint64_t t_childNs = 0;
+
+inline unsigned log2_floor(uint64_t v)
+{
+#if defined(__GNUC__) || defined(__clang__)
+  return 63 - __builtin_clzll(v);
+#else
+  unsigned e = 0;
+  while (v >>= 1) e++;
+  return e;
+#endif
+}
+
+} // namespace
+
+size_t latency_histogram::bucket_of(uint64_t v)
+{
+  if (v < kSubBuckets)
+    return static_cast<size_t>(v);
+  const unsigned e = log2_floor(v);
+  const uint64_t sub = (v >> (e - kSubBits)) & (kSubBuckets - 1);
+  return static_cast<size_t>((e - kSubBits + 1) * kSubBuckets + sub);
+}
+
+uint64_t latency_histogram::bucket_value(size_t idx)
+{
+  if (idx < kSubBuckets)
+    return idx;
+  const unsigned e = static_cast<unsigned>(idx / kSubBuckets) + kSubBits - 1;
+  const uint64_t sub = idx % kSubBuckets;
+  const uint64_t low = (kSubBuckets + sub) << (e - kSubBits);
+  const uint64_t width = uint64_t(1) << (e - kSubBits);
+  return low + (width - 1) / 2; // middle of the bucket
+}
+
+void latency_histogram::record(uint64_t v)
+{
+  counts_[bucket_of(v)].fetch_add(1, std::memory_order_relaxed);
+  count_.fetch_add(1, std::memory_order_relaxed);
+  sum_.fetch_add(v, std::memory_order_relaxed);
+
+  uint64_t m = min_.load(std::memory_order_relaxed);
+  while (v < m && !min_.compare_exchange_weak(m, v, std::memory_order_relaxed)) {}
+  m = max_.load(std::memory_order_relaxed);
+  while (v > m && !max_.compare_exchange_weak(m, v, std::memory_order_relaxed)) {}
+}
+
+void latency_histogram::reset()
+{
+  for (auto& c : counts_)
+    c.store(0, std::memory_order_relaxed);
+  count_ = 0;
+  sum_ = 0;
+  min_ = std::numeric_limits<uint64_t>::max();
+  max_ = 0;
+}
+
+uint64_t latency_histogram::percentile(double q) const
+{
+  const uint64_t total = count();
+  if (total == 0)
+    return 0;
+
+  uint64_t rank = static_cast<uint64_t>(q / 100.0 * total + 0.5);
+  if (rank == 0) rank = 1;
+  if (rank > total) rank = total;
+
+  uint64_t seen = 0;
+  for (size_t idx = 0; idx < kBuckets; idx++) {
+    seen += counts_[idx].load(std::memory_order_relaxed);
+    if (seen >= rank)
+      return std::min(std::max(bucket_value(idx), min()), max());
+  }
+  return max();
+}
+
+uint64_t proc_stats::enter()
+{
+  const uint64_t saved = t_childNs;
+  t_childNs = 0;
+  return saved;
+}
+
+uint64_t proc_stats::leave(uint64_t saved, uint64_t ns)
+{
+  const uint64_t self = ns > t_childNs ? ns - t_childNs : 0;
+  t_childNs = saved + ns;
+  return self;
+}
+
+void proc_stats::print(std::ostream& os, const std::string& name) const
+{
+  const struct { const char* kind; const call_stats* s; } calls[] = {{"process", &process_}, {"start", &start_}};
+  const std::ios_base::fmtflags flags = os.flags();
+  const std::streamsize precision = os.precision();
+  for (auto const& c : calls) {
+    if (c.s->calls() == 0)
+      continue;
+    const latency_histogram& l = c.s->latency();
+    os << name << ", " << c.kind <<
+          ", calls: " << c.s->calls() <<
+          ", items: " << c.s->items() <<
+          ", bytes: " << c.s->bytes() <<
+          ", items/s: " << std::fixed << std::setprecision(0) << c.s->items_per_sec() <<
+          ", bytes/s: " << c.s->bytes_per_sec() <<
+          ", ns min: " << l.min() <<
+          ", mean: " << l.mean() <<
+          ", p50: " << l.percentile(50) <<
+          ", p90: " << l.percentile(90) <<
+          ", p99: " << l.percentile(99) <<
+          ", p99.9: " << l.percentile(99.9) <<
+          ", max: " << l.max() << "\n";
+    os.flags(flags);
+    os.precision(precision);
+  }
+}
+
+} // namespace pl_proc
@@ -0,0 +1,140 @@
+/**
+ * @file   proc_stats.h
+ *
+ * @author Armin Zare Zadeh ali.a.zarezadeh@gmail.com
+ *         Eric J. Mayo eric@pozicom.net
+ *
+ * @brief   proc_stats.h includes the latency and throughput instrumentation of processor nodes
+ */
+
+#ifndef PROC_STATS_H
+#define PROC_STATS_H
+
+#include "noncopyable.h"
+
+#include <atomic>
+#include <cstdint>
+#include <iosfwd>
+#include <string>
+
+
+namespace pl_proc {
+
+/*!
+ * \brief Log-linear latency histogram, in the spirit of HdrHistogram.
+ *
+ * \details
+ * Values below 2^kSubBits are counted exactly; above, every power of two range
+ * is split into 2^kSubBits linear sub-buckets, so any recorded value is known
+ * within 1/2^kSubBits (~3%) over the whole 64 bit range.  Buckets are relaxed
+ * atomics: one thread records while others may read percentiles.
+ */
+class latency_histogram : noncopyable
+{
+public:
+  static constexpr unsigned kSubBits = 5;
+  static constexpr uint64_t kSubBuckets = uint64_t(1) << kSubBits;
+  static constexpr size_t kBuckets = (64 - kSubBits + 1) * kSubBuckets;
+
+private:
+  std::atomic<uint64_t> counts_[kBuckets];
+  std::atomic<uint64_t> count_;
+  std::atomic<uint64_t> sum_;
+  std::atomic<uint64_t> min_;
+  std::atomic<uint64_t> max_;
+
+  static size_t bucket_of(uint64_t v);
+  static uint64_t bucket_value(size_t idx);
+
+public:
+  latency_histogram() { reset(); }
+
+  void record(uint64_t v);
+  void reset();
+
+  uint64_t count() const { return count_.load(std::memory_order_relaxed); }
+  uint64_t sum() const { return sum_.load(std::memory_order_relaxed); }
+  uint64_t min() const { return count() ? min_.load(std::memory_order_relaxed) : 0; }
+  uint64_t max() const { return max_.load(std::memory_order_relaxed); }
+  double mean() const { return count() ? double(sum()) / count() : 0.0; }
+
+  /*!
+   * \brief Value below which \p q percent (0..100) of the recorded values are.
+   */
+  uint64_t percentile(double q) const;
+};
+
+/*!
+ * \brief Latency and throughput of the calls of one kind (process or start) of a processor node.
+ *
+ * \details
+ * Latencies are self times in nanoseconds: since the signals run the downstream
+ * processor nodes synchronously, the time spent in the nodes called from the
+ * emits of a call is subtracted from it.
+ */
+class call_stats : noncopyable
+{
+private:
+  latency_histogram latency_;
+  std::atomic<uint64_t> items_;
+  std::atomic<uint64_t> bytes_;
+
+public:
+  call_stats() : items_(0), bytes_(0) {}
+
+  void record(uint64_t ns, uint64_t items, uint64_t bytes)
+  {
+    latency_.record(ns);
+    items_.fetch_add(items, std::memory_order_relaxed);
+    bytes_.fetch_add(bytes, std::memory_order_relaxed);
+  }
+
+  void reset() { latency_.reset(); items_ = 0; bytes_ = 0; }
+
+  const latency_histogram& latency() const { return latency_; }
+  uint64_t calls() const { return latency_.count(); }
+  uint64_t items() const { return items_.load(std::memory_order_relaxed); }
+  uint64_t bytes() const { return bytes_.load(std::memory_order_relaxed); }
+
+  /*!
+   * \brief Items and bytes per second of busy (self) time.
+   */
+  double items_per_sec() const { return latency_.sum() ? items() * 1e9 / latency_.sum() : 0.0; }
+  double bytes_per_sec() const { return latency_.sum() ? bytes() * 1e9 / latency_.sum() : 0.0; }
+};
+
+/*!
+ * \brief Instrumentation of a processor node, filled by processor::runProcess and
+ *        processor::runStart while proc_stats::enabled() is set.
+ */
+class proc_stats : noncopyable
+{
+private:
+  static std::atomic<bool> enabled_;
+
+public:
+  call_stats process_;
+  call_stats start_;
+
+  static bool enabled() { return enabled_.load(std::memory_order_relaxed); }
+  static void set_enabled(bool enabled) { enabled_.store(enabled, std::memory_order_relaxed); }
+
+  void reset() { process_.reset(); start_.reset(); }
+
+  /*!
+   * \brief Print one line per kind of call that happened, prefixed by \p name.
+   */
+  void print(std::ostream& os, const std::string& name) const;
+
+  /*!
+   * \brief Self time accounting of nested instrumented calls on this thread:
+   *        enter() returns the state to hand back to leave(), which returns the
+   *        self time of the call that took \p ns nanoseconds in total.
+   */
+  static uint64_t enter();
+  static uint64_t leave(uint64_t saved, uint64_t ns);
+};
+
+} // namespace pl_proc
+
+#endif /* PROC_STATS_H */
@@ -11,8 +11,17 @@
 #define PROCESSOR_H
 
 #include "tags.h"
+#include "stream_tags.h"
+#include "seq_tracker.h"
+#include "reorder_buffer.h"
 #include "signal_slot.h"
+#include "proc_stats.h"
+#include "tracer.h"
+#include "timing.h"
 
+#include <algorithm>
+#include <chrono>
+#include <cstring>
 #include <cstdint>
 #include <memory>
 #include <complex>
@@ -28,6 +37,25 @@ namespace pl_proc {
  */
 class processor
 {
+public:
+  /*!
+   * \brief Input ports which receive stream tags
+   */
+  enum tag_port { TAG_PORT_PROC = 0, TAG_PORT_IN1 = 1, NUM_TAG_PORTS = 2 };
+
+  /*!
+   * \brief Packet a processor has started, as an input port receives it: its sequence
+   *        number, its items [start_, end_) and their stream tags. Captured by
+   *        captureInput() for the inputs which are delivered later, e.g. once aligned.
+   */
+  struct input_paket
+  {
+    ObjectIDPaketSeqType seq_ = 0;
+    uint64_t start_ = 0;
+    uint64_t end_ = 0;
+    std::vector<stream_tag> tags_;
+  };
+
 protected:
   /*!
    * \brief Number of output items on processor node
@@ -47,7 +75,7 @@ protected:
   /*!
    * \brief Mutex 
    */
-  std::mutex mutex_;
+  mutable std::mutex mutex_;
 
 private:
   /*!
@@ -76,15 +104,59 @@ private:
   bool trigStart_;
 
   /*!
-   * \brief Packet Index
+   * \brief Packet Index: the sequence number of the next output packet
+   */
+  ObjectIDPaketSeqType paketIndex_;
+
+  /*!
+   * \brief Sequence number of the current output packet
+   */
+  ObjectIDPaketSeqType paketSeq_;
+
+  /*!
+   * \brief Number of processed packets whose inputs carried different sequence numbers
+   */
+  uint64_t misalignedPakets_;
+
+  /*!
+   * \brief Number of items produced so far, the offset of the next TAG
+   */
+  uint64_t nitemsWritten_;
+
+  /*!
+   * \brief Offset of the first item of the current output packet
+   */
+  uint64_t paketOffset_;
+
+  /*!
+   * \brief Stream tags received on an input port, with the items [start_, end_)
+   *        of the packet delivered last on it and the sequence numbers of the packets
+   */
+  struct tag_window
+  {
+    tag_ring tags_;
+    uint64_t start_ = 0;
+    uint64_t end_ = 0;
+    seq_tracker seq_;
+  };
+
+  /*!
+   * \brief Stream tags of the input ports, of the output and their propagation policy
    */
-  ObjectIDPaketIndexType paketIndex_;
+  tag_window inTags_[NUM_TAG_PORTS];
+  tag_ring outTags_;
+  tag_propagation_policy tagPropagation_;
 
   /*!
    * \brief Signals and slots Observer Pattern which notifies the generation of a new TAG
    */
   std::shared_ptr<signal_slot<tag_t&>> onNewTag_;
 
+  /*!
+   * \brief Signals and slots Observer Pattern which notifies the generation of a batch of TAGs
+   */
+  std::shared_ptr<signal_slot<const tag_span&>> onNewTags_;
+
   /*!
    * \brief Signals and slots Observer Pattern which notifies the generation of a new OUTPUT DATA
    */
@@ -95,6 +167,137 @@ private:
    */
   std::shared_ptr<signal_slot<>> onFirstInputSet_;
 
+  /*!
+   * \brief Latency and throughput instrumentation of process() and start()
+   */
+  proc_stats stats_;
+
+  /*!
+   * \brief Name of this processor in the execution trace
+   */
+  uint32_t traceNameId_;
+
+  /*!
+   * \brief Object ID of packet 0 of this processor, the constant prefix of the tag keys
+   */
+  ObjectID tagKey_;
+
+  /*!
+   * \brief TAG emitted by emitNewTag, updated in place for every packet
+   */
+  tag_t tag_;
+
+  /*!
+   * \brief Number of TAGs emitNewTag gathers before emitting them as one batch, 1 if it does not
+   */
+  size_t tagBatchSize_;
+
+  /*!
+   * \brief TAGs gathered so far, each one referring to a snapshot of its packet from the pool
+   */
+  std::vector<tag_t> tagBatch_;
+
+  /*!
+   * \brief Copy of an output packet, with its items cached to refresh it by a plain memcpy
+   */
+  struct tag_snapshot
+  {
+    pmt::pmt_t items_;
+    void* data_;
+  };
+
+  /*!
+   * \brief Snapshots of the output packets of a batch, reused batch after batch as long
+   *        as the output vector is tagPoolOf_, whose items are tagPoolSrc_
+   */
+  std::vector<tag_snapshot> tagPool_;
+  pmt::pmt_t tagPoolOf_;
+  const void* tagPoolSrc_;
+  size_t tagPoolBytes_;
+
+  /*!
+   * \brief Number of items and bytes of the genVector \p items, 0 if it is none
+   */
+  static void vectorSize(const pmt::pmt_t& items, uint64_t& nitems, uint64_t& nbytes)
+  {
+    nitems = 0;
+    nbytes = 0;
+    if (items && pmt::is_uniform_vector(items)) {
+      size_t len = 0;
+      pmt::uniform_vector_elements(items, len);
+      nbytes = len;
+      nitems = len / pmt::uniform_vector_itemsize(items);
+    }
+  }
+
+  bool hasStreamTags() const
+  {
+    return !outTags_.empty() || !inTags_[TAG_PORT_PROC].tags_.empty() || !inTags_[TAG_PORT_IN1].tags_.empty();
+  }
+
+  /*!
+   * \brief Start the next output packet: advance the packet and item counters and
+   *        forward the stream tags of the input windows to it, following the
+   *        propagation policy. Returns the offset of the packet.
+   */
+  uint64_t beginOutputPaket()
+  {
+    paketSeq_ = paketIndex_++;
+    paketOffset_ = nitemsWritten_;
+    nitemsWritten_ += noutput_items_;
+    if (hasStreamTags())
+      propagateTags();
+    return paketOffset_;
+  }
+
+  void propagateTags()
+  {
+    outTags_.prune(paketOffset_);
+    if (tagPropagation_ == tag_propagation_policy::DONT)
+      return;
+
+    for (int port = 0; port < NUM_TAG_PORTS; port++) {
+      if (tagPropagation_ == tag_propagation_policy::ONE_TO_ONE && port != TAG_PORT_PROC)
+        continue;
+      const tag_window& w = inTags_[port];
+      if (!w.tags_.empty())
+        w.tags_.copy_range(outTags_, w.start_, w.end_, static_cast<int64_t>(paketOffset_ - w.start_));
+    }
+  }
+
+  /*!
+   * \brief Add tag_ to the batch, with a snapshot of the output packet it refers to,
+   *        since the next packet overwrites it; the snapshots are reused batch after batch.
+   */
+  void batchTag()
+  {
+    if (output_items_.get() != tagPoolOf_.get()) {
+      flushTags(); // the pending TAGs keep their snapshots
+      tagPool_.clear();
+      tagPoolOf_ = output_items_;
+      tagPoolSrc_ = nullptr;
+      tagPoolBytes_ = 0;
+      if (output_items_ && pmt::is_uniform_vector(output_items_))
+        tagPoolSrc_ = pmt::uniform_vector_elements(output_items_, tagPoolBytes_);
+    }
+
+    const size_t k = tagBatch_.size();
+    tagBatch_.push_back(tag_);
+    if (tagPoolSrc_) {
+      if (k == tagPool_.size()) {
+        size_t len = 0;
+        pmt::pmt_t items = pmt::genVector_copy(output_items_);
+        tagPool_.push_back(tag_snapshot{items, pmt::uniform_vector_writable_elements(items, len)});
+      } else {
+        std::memcpy(tagPool_[k].data_, tagPoolSrc_, tagPoolBytes_);
+      }
+      tagBatch_.back().value_ = tagPool_[k].items_;
+    }
+
+    if (tagBatch_.size() >= tagBatchSize_)
+      flushTags();
+  }
+
 public:
   processor(ObjectIDModuleType moduleType,
             ObjectIDModuleIndexType moduleIndex,
@@ -108,37 +311,253 @@ public:
       adjacencyConnection_(adjacencyConnection),
       trigStart_(trigStart),
       noutput_items_(noutput_items),
-      paketIndex_(0)
+      paketIndex_(0),
+      paketSeq_(0),
+      misalignedPakets_(0),
+      nitemsWritten_(0),
+      paketOffset_(0),
+      tagPropagation_(tag_propagation_policy::ALL_TO_ALL),
+      traceNameId_(tracer::name_id(moduleName)),
+      tagKey_(ObjectID::ForModuleIndex(*JobRunID::getInstance(), moduleType, moduleIndex, 0)),
+      tag_(0, tagKey_, pmt::DataType::UNKNOWN, nullptr),
+      tagBatchSize_(1),
+      tagPoolSrc_(nullptr),
+      tagPoolBytes_(0)
   {
     std::lock_guard<std::mutex> locker(mutex_);
     onNewTag_ = std::make_shared<signal_slot<tag_t&>>();
+    onNewTags_ = std::make_shared<signal_slot<const tag_span&>>();
     onNewData_ = std::make_shared<signal_slot<pmt::pmt_t&>>();
     onFirstInputSet_ = std::make_shared<signal_slot<>>();     
   }
 
   virtual ~processor() {
     onNewTag_ = nullptr;
+    onNewTags_ = nullptr;
     onNewData_ = nullptr;
     onFirstInputSet_ = nullptr;
   };
 
   /*!
    * \brief Signals and slots Observer Pattern which emits a new TAG which wraps up the 
-   *        generated new output data with timetag and packet index
+   *        generated new output data with timetag, packet index and item offset.
+   *        Only the packet index and offset are counted while nobody observes the TAG signal,
+   *        told by the slot counts of the signals, which are safe to read outside an emit.
+   *        It also starts the output packet, which receives the propagated stream tags.
+   *        With a TAG batch size above 1 the TAG is gathered, with a snapshot of the
+   *        packet, and emitted later with its batch.
    */
   void emitNewTag(pmt::DataType pmtValDataType)
   {
-    int64_t timetag = current_time_ms();
-    JobRunID *jobRunId = jobRunId->getInstance();
-    const ObjectID objId = ObjectID::ForModuleIndex(*jobRunId,
-                                                    moduleType_,
-                                                    moduleIndex_,
-                                                    paketIndex_);
-    tag_t tag = tag_t(timetag, objId, pmtValDataType, output_items_);
-    paketIndex_++;
-    onNewTag_->emit(tag);
+    const uint64_t offset = beginOutputPaket();
+    if (onNewTag_->empty() && onNewTags_->empty())
+      return;
+
+    tag_.timetag_ = timing::now_ns();
+    tag_.offset_ = offset;
+    tag_.key_ = tagKey_.WithPaketSeq(paketSeq_);
+    tag_.valueDataType_ = pmtValDataType;
+    if (tag_.value_.get() != output_items_.get())
+      tag_.value_ = output_items_;
+    if (tagBatchSize_ > 1) {
+      batchTag();
+      return;
+    }
+
+    if (!onNewTag_->empty())
+      onNewTag_->emit(tag_);
+    if (!onNewTags_->empty())
+      onNewTags_->emit(tag_span{&tag_, 1});
+  }
+
+  /*!
+   * \brief Emit the batch \p tags with a single emission of the TAG batch signal, and
+   *        to the observers of the TAG signal one by one.
+   */
+  void emitNewTags(const tag_span& tags)
+  {
+    if (tags.empty())
+      return;
+    if (!onNewTags_->empty())
+      onNewTags_->emit(tags);
+    if (!onNewTag_->empty()) {
+      for (tag_t& tag : tags)
+        onNewTag_->emit(tag);
+    }
+  }
+
+  /*!
+   * \brief Emit the TAGs gathered by emitNewTag so far, as one batch.
+   */
+  void flushTags()
+  {
+    if (tagBatch_.empty())
+      return;
+    emitNewTags(tag_span{tagBatch_.data(), tagBatch_.size()});
+    tagBatch_.clear();
+  }
+
+  /*!
+   * \brief Let emitNewTag gather \p n TAGs (1: none) before emitting them as one batch,
+   *        which amortizes the signal dispatch and logging cost of tiny packets.
+   *        The pending ones are emitted first.
+   */
+  void setTagBatchSize(size_t n)
+  {
+    flushTags();
+    tagBatchSize_ = std::max<size_t>(1, n);
+    tagBatch_.reserve(tagBatchSize_);
+  }
+
+  size_t getTagBatchSize() const { return tagBatchSize_; }
+
+  /*!
+   * \brief Start the output packet of a stage inside a fused chain, which computes it
+   *        without emitting it, so that its stream tags still reach the next stage.
+   */
+  void passPaket()
+  {
+    beginOutputPaket();
+  }
+
+  /*!
+   * \brief Receive on input \p port the stream tags of the packet \p src has just
+   *        started, which becomes the input window of the port, and account its
+   *        sequence number. Called by the pipeline connections before they deliver
+   *        the packet.
+   */
+  void receiveTags(tag_port port, const processor& src)
+  {
+    tag_window& w = inTags_[port];
+    w.seq_.observe(src.paketSeq_);
+    w.start_ = src.paketOffset_;
+    w.end_ = src.nitemsWritten_;
+    if (!w.tags_.empty())
+      w.tags_.prune(w.start_);
+    if (!src.outTags_.empty())
+      src.outTags_.copy_range(w.tags_, w.start_, w.end_);
+  }
+
+  /*!
+   * \brief Capture in \p paket the packet this processor has just started, for an
+   *        input which receives it later with receiveTags(port, paket).
+   */
+  void captureInput(input_paket& paket) const
+  {
+    paket.seq_ = paketSeq_;
+    paket.start_ = paketOffset_;
+    paket.end_ = nitemsWritten_;
+    paket.tags_.clear();
+    if (!outTags_.empty())
+      outTags_.get_in_range(paket.tags_, paket.start_, paket.end_);
+  }
+
+  /*!
+   * \brief Receive on input \p port the packet \p paket captured by captureInput(),
+   *        like receiveTags(port, src) when it was started.
+   */
+  void receiveTags(tag_port port, const input_paket& paket)
+  {
+    tag_window& w = inTags_[port];
+    w.seq_.observe(paket.seq_);
+    w.start_ = paket.start_;
+    w.end_ = paket.end_;
+    if (!w.tags_.empty())
+      w.tags_.prune(w.start_);
+    for (auto const& t : paket.tags_)
+      w.tags_.push(t);
+  }
+
+  /*!
+   * \brief Add a stream tag to the output item at absolute index \p offset; items from
+   *        getNitemsWritten() on belong to the packet the processor emits next.
+   */
+  void add_item_tag(uint64_t offset, const pmt::pmt_t& key, const pmt::pmt_t& value)
+  {
+    outTags_.push(stream_tag{offset, key, value, moduleIndex_});
+  }
+
+  /*!
+   * \brief Forward the stream tag \p tag, which keeps its source, to the output item
+   *        at absolute index \p offset, like the nodes which emit their input packets
+   *        later (reorder, replicas) and forward their tags themselves.
+   */
+  void add_item_tag(uint64_t offset, const stream_tag& tag)
+  {
+    outTags_.push(stream_tag{offset, tag.key_, tag.value_, tag.srcid_});
+  }
+
+  /*!
+   * \brief Store in \p tags the stream tags received on input \p port for the items
+   *        [\p start, \p end) in absolute offsets, only the ones with \p key if not null.
+   */
+  void get_tags_in_range(std::vector<stream_tag>& tags, tag_port port, uint64_t start, uint64_t end, const pmt::pmt_t& key = nullptr) const
+  {
+    tags.clear();
+    inTags_[port].tags_.get_in_range(tags, start, end, key);
+  }
+
+  /*!
+   * \brief Store in \p tags the stream tags received on input \p port for the items
+   *        [\p start, \p end) relative to the packet delivered last on the port.
+   */
+  void get_tags_in_window(std::vector<stream_tag>& tags, tag_port port, uint64_t start, uint64_t end, const pmt::pmt_t& key = nullptr) const
+  {
+    const uint64_t base = inTags_[port].start_;
+    get_tags_in_range(tags, port, base + start, base + end, key);
+  }
+
+  /*!
+   * \brief Absolute offset of the first item of the packet delivered last on input \p port
+   */
+  uint64_t nitems_read(tag_port port) const { return inTags_[port].start_; }
+
+  /*!
+   * \brief Sequence numbers of the packets delivered on input \p port so far
+   */
+  const seq_tracker& getInputSeq(tag_port port) const { return inTags_[port].seq_; }
+
+  /*!
+   * \brief Whether the packets delivered last on the input ports which received any
+   *        carry the same sequence number, as the inputs of one output packet of a
+   *        merge point should; the packet is counted misaligned otherwise. Called by
+   *        the merge points before they process a packet.
+   */
+  bool checkInputsAligned()
+  {
+    const seq_tracker* first = nullptr;
+    for (const tag_window& w : inTags_) {
+      if (!w.seq_.started())
+        continue;
+      if (first && w.seq_.last() != first->last()) {
+        misalignedPakets_++;
+        return false;
+      }
+      first = &w.seq_;
+    }
+    return true;
   }
 
+  uint64_t getMisalignedPakets() const { return misalignedPakets_; }
+
+  /*!
+   * \brief Sequence number of the current output packet
+   */
+  ObjectIDPaketSeqType getPaketSeq() const { return paketSeq_; }
+
+  /*!
+   * \brief Port index of the input \p port (Proc or In1), or -1 if it receives no stream tags
+   */
+  static int tagPortIndex(const std::string& port)
+  {
+    if (port == "Proc") return TAG_PORT_PROC;
+    if (port == "In1")  return TAG_PORT_IN1;
+    return -1;
+  }
+
+  void setTagPropagationPolicy(tag_propagation_policy policy) { tagPropagation_ = policy; }
+  tag_propagation_policy getTagPropagationPolicy() const { return tagPropagation_; }
+
   /*!
    * \brief Signals and slots Observer Pattern which emits a new output data
    */
@@ -148,13 +567,74 @@ public:
   }
 
   /*!
-   * \brief Signals and slots Observer Pattern which emits on reception of the first input data
+   * \brief Signals and slots Observer Pattern which emits on reception of the first input data,
+   *        called by the pipeline connections as a packet arrives on the In1 port
    */
   void emitFirstInput()
   {
     onFirstInputSet_->emit();
   }
 
+  /*!
+   * \brief Instrumented entry point of process(), used by the pipeline connections.
+   *        It costs two flag tests while neither proc_stats nor tracer is enabled.
+   */
+  void runProcess(pmt::pmt_t& input_items)
+  {
+    if (!proc_stats::enabled() && !tracer::enabled()) {
+      process(input_items);
+      return;
+    }
+
+    trace_scope trace(traceNameId_, trace_category::PROCESS);
+    if (!proc_stats::enabled()) {
+      process(input_items);
+      return;
+    }
+
+    const uint64_t saved = proc_stats::enter();
+    const auto t0 = std::chrono::steady_clock::now();
+    process(input_items);
+    const uint64_t ns = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - t0).count();
+
+    uint64_t nitems, nbytes;
+    vectorSize(input_items, nitems, nbytes);
+    stats_.process_.record(proc_stats::leave(saved, ns), nitems, nbytes);
+  }
+
+  /*!
+   * \brief Instrumented entry point of start(), used by the pipeline connections.
+   *        It costs two flag tests while neither proc_stats nor tracer is enabled.
+   */
+  void runStart()
+  {
+    if (!proc_stats::enabled() && !tracer::enabled()) {
+      start();
+      return;
+    }
+
+    trace_scope trace(traceNameId_, trace_category::START);
+    if (!proc_stats::enabled()) {
+      start();
+      return;
+    }
+
+    const uint64_t saved = proc_stats::enter();
+    const auto t0 = std::chrono::steady_clock::now();
+    start();
+    const uint64_t ns = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - t0).count();
+
+    uint64_t nitems, nbytes;
+    vectorSize(output_items_, nitems, nbytes);
+    stats_.start_.record(proc_stats::leave(saved, ns), nitems, nbytes);
+  }
+
+  /*!
+   * \brief Getter interface for the instrumentation of Processor Module Node
+   */
+  proc_stats& getStats() { return stats_; }
+  const proc_stats& getStats() const { return stats_; }
+
   /*!
    * \brief New type definition for a smart shared pointer of processor node
    */
@@ -175,6 +655,11 @@ public:
    */
   virtual const std::list<std::tuple<std::string, std::string, std::string>> getAdjacencyConnection() const { return adjacencyConnection_; };
 
+  /*!
+   * \brief Getter interface for the number of items produced so far by Processor Module
+   */
+  uint64_t getNitemsWritten() const { return nitemsWritten_; };
+
   /*!
    * \brief Main Process Method for Processor Module (Receives Input and Generates Output)
    */
@@ -191,15 +676,85 @@ public:
   virtual bool getDone() = 0;
 
   /*!
-   * \brief Getter interface for Processor Module to indicate it's done
+   * \brief Set the packet of the In1 port, which process() combines with the Proc packet
+   *        of the same sequence number
    */
   virtual void setInput1(pmt::pmt_t& input_items1) = 0;
 
+  /*!
+   * \brief Elementwise processors compute output item k out of input item k only,
+   *        so that chains of them can be fused by sys_builder into a single tiled loop.
+   */
+  virtual bool isElementwise() const { return false; };
+
+  /*!
+   * \brief Whether the In1 vector the elementwise kernel reads is bound, always true for
+   *        processors not reading In1. A node is only fused once its In1 is connected.
+   */
+  virtual bool isInput1Bound() const { return true; };
+
+  /*!
+   * \brief Stateless processors compute an output packet out of the input packets of
+   *        the same sequence number only, so that sys_builder can run replicas of them
+   *        on several threads (__replicas__), each one processing a share of the packets.
+   */
+  virtual bool isStateless() const { return false; };
+
+  /*!
+   * \brief Elementwise kernel: compute the \p n output items starting at item \p offset
+   *        of the current packet out of the \p n items of the Proc input at \p in, and
+   *        store them at \p out. It neither touches output_items_ nor emits anything.
+   */
+  virtual void processTile(const void* /*in*/, void* /*out*/, size_t /*offset*/, size_t /*n*/) { return; };
+
+  /*!
+   * \brief Getter interface for the item data type of the Output items vector
+   */
+  virtual pmt::DataType getOutputDataType() const { return pmt::DataType::UNKNOWN; };
+
+  /*!
+   * \brief Getter interface for the Output items vector of Processor Module Node
+   */
+  virtual const pmt::pmt_t& getOutputItems() const { return output_items_; };
+
+  /*!
+   * \brief Connect time hook to bind the genVector which will be delivered on
+   *        input \p port to a statically typed handle, so that process() does
+   *        not need any runtime type test.
+   *        Returns false if the processor does not use typed inputs on \p port,
+   *        throws std::invalid_argument if \p items has the wrong type or length.
+   */
+  virtual bool bindInput(const std::string& /*port*/, const pmt::pmt_t& /*items*/) { return false; };
+
+  /*!
+   * \brief Configuration hook of source processors to tag their source data with
+   *        \p tags, whose offsets are item indices of that data.
+   *        Returns false if the processor is no source.
+   */
+  virtual bool setSourceTags(const std::vector<stream_tag>& /*tags*/) { return false; };
+
+  /*!
+   * \brief End of run hook to emit the packets the processor still holds, like the
+   *        ones a reorder node buffers while it waits for missing packets.
+   */
+  virtual void drain() { return; };
+
+  /*!
+   * \brief Getter interface for the counters of the reorder buffer of the processor,
+   *        null if it has none.
+   */
+  virtual const reorder_stats* getReorderStats() const { return nullptr; };
+
   /*!
    * \brief Getter interface for the new TAG Signal/Slot of Processor Module Node
    */
   virtual std::shared_ptr<signal_slot<tag_t&>> getOnNewTag() { return onNewTag_; };
 
+  /*!
+   * \brief Getter interface for the TAG batch Signal/Slot of Processor Module Node
+   */
+  virtual std::shared_ptr<signal_slot<const tag_span&>> getOnNewTags() { return onNewTags_; };
+
   /*!
    * \brief Getter interface for the new DATA Signal/Slot of Processor Module Node
    */
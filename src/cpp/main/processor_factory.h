@@ -16,8 +16,11 @@
 #include "vec_src_blk.h"
 #include "adder_blk.h"
 #include "vec_sink_blk.h"
+#include "reorder_blk.h"
 
 #include <cstdint>
+#include <functional>
+#include <map>
 #include <memory>
 #include <complex>
 #include <vector>
@@ -52,6 +55,12 @@ public:
    */
   template <typename... Args>
   static processor::sptr createSINK(const std::string& inTypeStr, Args&&... arg);
+
+  /*!
+   * \brief Reorder processor node creator
+   */
+  template <typename... Args>
+  static processor::sptr createREORDER(const std::string& typeStr, Args&&... arg);
 };
 
 
@@ -118,6 +127,26 @@ typename processor::sptr proc_factory::createSINK(const std::string& inTypeStr,
   return factory.at(inType)(std::forward<Args>(arg)...);
 }
 
+template <typename... Args>
+typename processor::sptr proc_factory::createREORDER(const std::string& typeStr, Args&&... arg)
+{
+  pmt::DataType type = pmt::TypeFromString(typeStr);
+  const std::map<pmt::DataType, std::function<std::shared_ptr<processor>(Args&&...)>> factory{
+    {pmt::DataType::INT8,          [=](Args&&... args) { return std::make_shared<reorder_blk<std::int8_t>>(args...); } },
+    {pmt::DataType::UINT8,         [=](Args&&... args) { return std::make_shared<reorder_blk<std::uint8_t>>(args...); } },
+    {pmt::DataType::INT16,         [=](Args&&... args) { return std::make_shared<reorder_blk<std::int16_t>>(args...); } },
+    {pmt::DataType::UINT16,        [=](Args&&... args) { return std::make_shared<reorder_blk<std::uint16_t>>(args...); } },
+    {pmt::DataType::INT32,         [=](Args&&... args) { return std::make_shared<reorder_blk<std::int32_t>>(args...); } },
+    {pmt::DataType::UINT32,        [=](Args&&... args) { return std::make_shared<reorder_blk<std::uint32_t>>(args...); } },
+    {pmt::DataType::INT64,         [=](Args&&... args) { return std::make_shared<reorder_blk<std::int64_t>>(args...); } },
+    {pmt::DataType::UINT64,        [=](Args&&... args) { return std::make_shared<reorder_blk<std::uint64_t>>(args...); } },
+    {pmt::DataType::FLOAT,         [=](Args&&... args) { return std::make_shared<reorder_blk<float>>(args...); } },
+    {pmt::DataType::COMPLEX_FLOAT, [=](Args&&... args) { return std::make_shared<reorder_blk<std::complex<float>>>(args...); } },
+    {pmt::DataType::UNKNOWN,       [=](Args&&... args) { return nullptr; } }
+  };
+  return factory.at(type)(std::forward<Args>(arg)...);
+}
+
 } // namespace pl_proc
 
 #endif /* PROCESSOR_FACTORY_H */
@@ -0,0 +1,110 @@
+/**
+ * @file   reorder_blk.cpp
+ *
+ * @author Armin Zare Zadeh ali.a.zarezadeh@gmail.com
+ *         Eric J. Mayo eric@pozicom.net
+ *
+ * @brief   reorder_blk.cpp includes the implementation for the reorder class
+ */
+
+#include "reorder_blk.h"
+#include <algorithm>
+#include <stdexcept>
+
+
+namespace pl_proc {
+
+template <class T>
+reorder_blk<T>::reorder_blk(ObjectIDModuleIndexType moduleIndex,
+                            const std::string& moduleName,
+                            const std::list<std::tuple<std::string, std::string, std::string>>& adjacencyConnection,
+                            uint32_t noutput_items,
+                            bool trigStart,
+                            size_t window)
+  : processor(static_cast<ObjectIDModuleType>(ModuleType::REORDER_MODULE),
+              moduleIndex,
+              moduleName,
+              adjacencyConnection,
+              noutput_items,
+              trigStart),
+    buffer_(window ? window : reorder_buffer<paket>::kDefaultWindow)
+{
+  output_items_ = pmt::make_genVector<T>(noutput_items_, 0);
+  out_.bind(output_items_);
+  setTagPropagationPolicy(tag_propagation_policy::DONT);
+}
+
+template <class T>
+bool reorder_blk<T>::bindInput(const std::string& port, const pmt::pmt_t& items)
+{
+  if (port != "Proc")
+    return false;
+
+  std::lock_guard<std::mutex> locker(mutex_);
+  in_.bind(items);
+  if (in_.size() != noutput_items_)
+    throw std::invalid_argument("reorder input length must match the output vector size");
+  return true;
+}
+
+template <class T>
+void reorder_blk<T>::emitPaket(const T* items, const std::vector<stream_tag>& tags, uint64_t base)
+{
+  std::copy(items, items + out_.size(), out_.begin());
+
+  // the tags of the packet land on the output packet emitNewTag starts
+  const uint64_t offset = getNitemsWritten();
+  for (auto const& t : tags)
+    add_item_tag(offset + t.offset_ - base, t);
+
+  emitNewTag(out_.data_type());
+  emitNewData();
+}
+
+template <class T>
+void reorder_blk<T>::process(pmt::pmt_t& input_items)
+{
+  in_.rebind(input_items);
+  if (in_.size() != noutput_items_)
+    throw std::invalid_argument("reorder input length must match the output vector size");
+
+  auto release = [this](ObjectIDPaketSeqType, const paket& p) { emitPaket(p.items_.data(), p.tags_, 0); };
+
+  get_tags_in_window(windowTags_, TAG_PORT_PROC, 0, noutput_items_);
+  const ObjectIDPaketSeqType seq = getInputSeq(TAG_PORT_PROC).last();
+  switch (buffer_.arrive(seq, release)) {
+  case reorder_event::IN_ORDER:
+    emitPaket(in_.data(), windowTags_, nitems_read(TAG_PORT_PROC));
+    buffer_.advance(release);
+    break;
+  case reorder_event::BUFFERED: {
+    paket& p = buffer_.item(seq);
+    p.items_.assign(in_.begin(), in_.end());
+    p.tags_ = windowTags_;
+    for (auto& t : p.tags_)
+      t.offset_ -= nitems_read(TAG_PORT_PROC);
+    break;
+  }
+  case reorder_event::LATE:
+    break; // dropped, counted by the buffer
+  }
+}
+
+template <class T>
+void reorder_blk<T>::drain()
+{
+  buffer_.flush([this](ObjectIDPaketSeqType, const paket& p) { emitPaket(p.items_.data(), p.tags_, 0); });
+}
+
+template class reorder_blk<std::int8_t>;
+template class reorder_blk<std::uint8_t>;
+template class reorder_blk<std::int16_t>;
+template class reorder_blk<std::uint16_t>;
+template class reorder_blk<std::int32_t>;
+template class reorder_blk<std::uint32_t>;
+template class reorder_blk<std::int64_t>;
+template class reorder_blk<std::uint64_t>;
+template class reorder_blk<float>;
+template class reorder_blk<std::complex<float>>;
+
+} // namespace pl_proc
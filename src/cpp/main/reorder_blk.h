@@ -0,0 +1,71 @@
+/**
+ * @file   reorder_blk.h
+ *
+ * @author Armin Zare Zadeh ali.a.zarezadeh@gmail.com
+ *         Eric J. Mayo eric@pozicom.net
+ *
+ * @brief   reorder_blk.h includes the implementation for the reorder class
+ */
+
+#ifndef REORDER_BLK_H
+#define REORDER_BLK_H
+
+#include "processor.h"
+#include "reorder_buffer.h"
+#include "typed_buffer.h"
+
+#include <vector>
+
+
+namespace pl_proc {
+
+/*!
+ * \brief Reorder stage which restores the order of the packets it receives by their
+ *        sequence numbers, ahead of stateful consumers (sinks, decoders) of stages
+ *        which complete out of order, like replicated ones.
+ *
+ * \details
+ * A packet in order is copied to the output and emitted right away; a packet ahead
+ * of it waits in a reorder_buffer of __reorder_window__ packets, with its stream
+ * tags, until the packets before it are emitted.  The node forwards the stream tags
+ * of every packet with it, so it ignores __tag_propagation__.  At the end of a run
+ * the packets still waiting are emitted, giving up on the missing ones.
+ */
+template <class T>
+class reorder_blk : public processor
+{
+private:
+  struct paket
+  {
+    std::vector<T> items_;
+    std::vector<stream_tag> tags_; //< with offsets relative to the packet
+  };
+
+  typed_buffer<T> in_;
+  typed_buffer<T> out_;
+  reorder_buffer<paket> buffer_;
+  std::vector<stream_tag> windowTags_; //< the ones of the last packet, kept for their capacity
+
+  void emitPaket(const T* items, const std::vector<stream_tag>& tags, uint64_t base);
+
+public:
+  reorder_blk(ObjectIDModuleIndexType moduleIndex,
+              const std::string& moduleName,
+              const std::list<std::tuple<std::string, std::string, std::string>>& adjacencyConnection,
+              uint32_t noutput_items,
+              bool trigStart,
+              size_t window);
+  virtual ~reorder_blk() { };
+  void setInput1(pmt::pmt_t& /*input_items1*/) override { return; };
+  void start() override { return; };
+  bool getDone() override { return true; };
+  bool bindInput(const std::string& port, const pmt::pmt_t& items) override;
+  void process(pmt::pmt_t& input_items) override;
+  void drain() override;
+  const reorder_stats* getReorderStats() const override { return &buffer_.stats(); };
+  pmt::DataType getOutputDataType() const override { return out_.data_type(); };
+};
+
+} // namespace pl_proc
+
+#endif /* REORDER_BLK_H */
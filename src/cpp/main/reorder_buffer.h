@@ -0,0 +1,220 @@
+/**
+ * @file   reorder_buffer.h
+ *
+ * @author Armin Zare Zadeh ali.a.zarezadeh@gmail.com
+ *         Eric J. Mayo eric@pozicom.net
+ *
+ * @brief   reorder_buffer.h includes the buffer which restores the order of the
+ *          packets of a stream by their sequence numbers
+ */
+
+#ifndef REORDER_BUFFER_H
+#define REORDER_BUFFER_H
+
+#include "id.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <vector>
+
+
+namespace pl_proc {
+
+/*!
+ * \brief How a packet arriving at a reorder_buffer is handled
+ */
+enum class reorder_event {
+  IN_ORDER, //< the next packet in order: deliver it, then advance()
+  BUFFERED, //< ahead of the next packet: store it in item(seq) until its turn
+  LATE      //< behind the next packet, or already buffered: dropped
+};
+
+/*!
+ * \brief Counters of a reorder_buffer
+ */
+struct reorder_stats {
+  uint64_t pakets_ = 0;    //< packets arrived
+  uint64_t buffered_ = 0;  //< packets which arrived out of order and waited for their turn
+  uint64_t late_ = 0;      //< packets dropped, behind the next packet or duplicated
+  uint64_t lost_ = 0;      //< sequence numbers given up on, to make room or at a flush
+  uint64_t depthSum_ = 0;  //< sum of the depths at the arrival of the buffered packets
+  uint64_t maxDepth_ = 0;  //< most packets buffered at once
+
+  //! Mean number of packets buffered when an out of order one arrives
+  double meanDepth() const { return buffered_ ? static_cast<double>(depthSum_) / buffered_ : 0.0; }
+
+  void print(std::ostream& os) const
+  {
+    os << "pakets " << pakets_ << ", buffered " << buffered_ << ", late " << late_ << ", lost " << lost_
+       << ", max depth " << maxDepth_ << ", mean depth " << meanDepth();
+  }
+};
+
+/*!
+ * \brief Buffer which restores the order of a stream of packets by their sequence
+ *        numbers, over a window of fixed size.
+ *
+ * \details
+ * The packet expected next is delivered by the caller as is; a packet ahead of it
+ * is stored in the slot of its sequence number, modulo the window, and released
+ * once all packets before it are delivered, so an in-order stream costs a compare
+ * per packet and nothing is allocated once every slot has held an item.  A packet
+ * beyond the window makes room by giving up on the oldest missing sequence
+ * numbers: the packets buffered in the meantime are released and the missing ones
+ * counted lost, and once none is buffered the window jumps to it in one step.
+ * Not thread safe: it is owned by the thread which merges the stream.
+ */
+template <class Item>
+class reorder_buffer
+{
+private:
+  struct slot
+  {
+    bool full_ = false;
+    Item item_;
+  };
+
+  std::vector<slot> slots_;
+  size_t mask_;
+  ObjectIDPaketSeqType next_; //< sequence number of the packet expected next
+  bool started_;
+  size_t depth_;              //< number of buffered packets
+  reorder_stats stats_;
+
+  slot& slot_of(ObjectIDPaketSeqType seq) { return slots_[seq & mask_]; }
+
+  /*!
+   * \brief Release the buffered packets from next_ on, until a missing one.
+   */
+  template <class Release>
+  void release_ready(Release&& release)
+  {
+    while (depth_ != 0) {
+      slot& s = slot_of(next_);
+      if (!s.full_)
+        return;
+      s.full_ = false;
+      depth_--;
+      release(next_, static_cast<const Item&>(s.item_));
+      next_++;
+    }
+  }
+
+  /*!
+   * \brief Give up on next_, lost unless buffered, and release the packets after it.
+   */
+  template <class Release>
+  void skip(Release&& release)
+  {
+    slot& s = slot_of(next_);
+    if (s.full_) {
+      release_ready(release);
+      return;
+    }
+    stats_.lost_++;
+    next_++;
+    release_ready(release);
+  }
+
+public:
+  //! Default number of packets a buffer holds
+  static constexpr size_t kDefaultWindow = 64;
+
+  explicit reorder_buffer(size_t window = kDefaultWindow)
+    : mask_(0), next_(0), started_(false), depth_(0)
+  {
+    size_t capacity = 1;
+    while (capacity < window)
+      capacity <<= 1;
+    slots_.resize(capacity);
+    mask_ = capacity - 1;
+  }
+
+  size_t window() const { return slots_.size(); }
+  size_t depth() const { return depth_; }
+  ObjectIDPaketSeqType next() const { return next_; }
+  const reorder_stats& stats() const { return stats_; }
+
+  /*!
+   * \brief Expect the packet \p seq next, when the merging thread knows where the
+   *        stream starts, rather than let the first packet to arrive set the order.
+   */
+  void expect(ObjectIDPaketSeqType seq)
+  {
+    started_ = true;
+    next_ = seq;
+  }
+
+  /*!
+   * \brief Account the arrival of the packet of sequence number \p seq; the first
+   *        packet sets the order.  A packet beyond the window first releases, with
+   *        \p release(seq, item), the packets buffered before the window moved to it.
+   */
+  template <class Release>
+  reorder_event arrive(ObjectIDPaketSeqType seq, Release&& release)
+  {
+    stats_.pakets_++;
+    if (!started_) {
+      started_ = true;
+      next_ = seq;
+    }
+
+    if (seq == next_)
+      return reorder_event::IN_ORDER;
+    if (seq < next_ || (seq - next_ < slots_.size() && slot_of(seq).full_)) {
+      stats_.late_++;
+      return reorder_event::LATE;
+    }
+
+    while (seq - next_ >= slots_.size()) {
+      if (depth_ == 0) {
+        // nothing buffered: move the window to seq at once, however far it jumped
+        const ObjectIDPaketSeqType to = seq - slots_.size() + 1;
+        stats_.lost_ += to - next_;
+        next_ = to;
+        break;
+      }
+      skip(release);
+    }
+    if (seq == next_)
+      return reorder_event::IN_ORDER;
+
+    stats_.buffered_++;
+    stats_.depthSum_ += depth_;
+    slot_of(seq).full_ = true;
+    if (++depth_ > stats_.maxDepth_)
+      stats_.maxDepth_ = depth_;
+    return reorder_event::BUFFERED;
+  }
+
+  /*!
+   * \brief Slot of the packet \p seq, which arrive() has just reported BUFFERED.
+   */
+  Item& item(ObjectIDPaketSeqType seq) { return slot_of(seq).item_; }
+
+  /*!
+   * \brief Move past the packet arrive() has just reported IN_ORDER, which the caller
+   *        delivered, and release the buffered packets which follow it.
+   */
+  template <class Release>
+  void advance(Release&& release)
+  {
+    next_++;
+    release_ready(release);
+  }
+
+  /*!
+   * \brief Release all the buffered packets, in order, giving up on the missing ones.
+   */
+  template <class Release>
+  void flush(Release&& release)
+  {
+    while (depth_ != 0)
+      skip(release);
+  }
+};
+
+} // namespace pl_proc
+
+#endif /* REORDER_BUFFER_H */
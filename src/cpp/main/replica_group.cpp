@@ -0,0 +1,335 @@
+/**
+ * @file   replica_group.cpp
+ *
+ * @author Armin Zare Zadeh ali.a.zarezadeh@gmail.com
+ *         Eric J. Mayo eric@pozicom.net
+ *
+ * @brief   replica_group.cpp includes the data-parallel execution of a stateless
+ *          processor node by replicas of it on worker threads
+ */
+
+#include "replica_group.h"
+
+#include <cstring>
+#include <stdexcept>
+
+
+namespace pl_proc {
+
+replica_dispatch ReplicaDispatchFromString(const std::string& s)
+{
+  if      (s == "ROUND_ROBIN")  return replica_dispatch::ROUND_ROBIN;
+  else if (s == "LEAST_LOADED") return replica_dispatch::LEAST_LOADED;
+  throw std::invalid_argument("unknown __replica_dispatch__ policy: " + s);
+}
+
+const char* ReplicaDispatchToString(replica_dispatch d)
+{
+  return d == replica_dispatch::LEAST_LOADED ? "LEAST_LOADED" : "ROUND_ROBIN";
+}
+
+replica_group::replica_group(const processor::sptr& primary,
+                             const std::vector<processor::sptr>& replicas,
+                             replica_dispatch dispatch,
+                             tag_propagation_policy tagPropagation,
+                             size_t window)
+  : primary_(primary),
+    dispatch_(dispatch),
+    tagPropagation_(tagPropagation),
+    nextWorker_(0),
+    inputs_(0),
+    pendingFrom_(0),
+    pendingTo_(0),
+    pendingStarted_(false),
+    dropped_(0),
+    nextSeq_(0),
+    inFlight_(0),
+    merge_(window ? window : 4 * replicas.size())
+{
+  if (!primary_ || replicas.empty())
+    throw std::invalid_argument("a replica group needs a primary node and at least one replica");
+  for (auto const& r : replicas) {
+    if (!r || !r->isStateless())
+      throw std::invalid_argument("only stateless processors can be replicated: " + primary_->getModuleName());
+  }
+
+  // jobs complete in any order: the merge starts at the first one dispatched
+  merge_.expect(nextSeq_);
+  pending_.assign(merge_.window(), nullptr);
+
+  // the stream tags of a packet are captured at dispatch and added back when it is emitted
+  primary_->setTagPropagationPolicy(tag_propagation_policy::DONT);
+
+  for (auto const& r : replicas) {
+    workers_.emplace_back(new worker());
+    workers_.back()->replica_ = r;
+  }
+  for (auto& w : workers_)
+    w->thread_ = std::thread(&replica_group::run, this, std::ref(*w));
+}
+
+replica_group::~replica_group()
+{
+  for (auto& w : workers_) {
+    {
+      std::lock_guard<std::mutex> lock(w->mutex_);
+      w->stop_ = true;
+    }
+    w->cv_.notify_one();
+  }
+  for (auto& w : workers_)
+    w->thread_.join();
+}
+
+void replica_group::copyItems(pmt::pmt_t& dst, const void*& dstOf, const pmt::pmt_t& src)
+{
+  size_t len = 0;
+  const void* items = pmt::uniform_vector_elements(src, len);
+
+  // Like the TAG snapshots: a buffer copied from the same vector before is refreshed by a memcpy
+  if (dst && dstOf == src.get()) {
+    size_t dstLen = 0;
+    std::memcpy(pmt::uniform_vector_writable_elements(dst, dstLen), items, len);
+    return;
+  }
+  dst = pmt::genVector_copy(src);
+  dstOf = src.get();
+}
+
+void replica_group::setPendingWindow(size_t window)
+{
+  size_t capacity = merge_.window();
+  while (capacity < window)
+    capacity <<= 1;
+  pending_.assign(capacity, nullptr);
+}
+
+replica_group::job* replica_group::acquire()
+{
+  // bounded by the window of pending jobs and the one of the merge
+  if (free_.empty()) {
+    pool_.emplace_back(new job());
+    job* j = pool_.back().get();
+    j->inOf_[processor::TAG_PORT_PROC] = nullptr;
+    j->inOf_[processor::TAG_PORT_IN1] = nullptr;
+    j->outOf_ = nullptr;
+    return j;
+  }
+  job* j = free_.back();
+  free_.pop_back();
+  return j;
+}
+
+void replica_group::dispatchPending()
+{
+  while (pendingFrom_ != pendingTo_) {
+    job*& slot = pending_[pendingFrom_ & (pending_.size() - 1)];
+    if (!slot || slot->arrived_ != inputs_)
+      return;
+    job* j = slot;
+    slot = nullptr;
+    pendingFrom_++;
+    dispatch(j);
+  }
+}
+
+void replica_group::skipPending()
+{
+  job*& slot = pending_[pendingFrom_ & (pending_.size() - 1)];
+  if (slot) {
+    dropped_++;
+    free_.push_back(slot);
+    slot = nullptr;
+  }
+  pendingFrom_++;
+  dispatchPending();
+}
+
+void replica_group::dispatch(job* j)
+{
+  size_t r = nextWorker_;
+  if (dispatch_ == replica_dispatch::LEAST_LOADED) {
+    size_t least = workers_[r]->load_.load(std::memory_order_relaxed);
+    for (size_t k = 1; k < workers_.size() && least != 0; k++) {
+      const size_t i = (nextWorker_ + k) % workers_.size();
+      const size_t load = workers_[i]->load_.load(std::memory_order_relaxed);
+      if (load < least) {
+        least = load;
+        r = i;
+      }
+    }
+  }
+  nextWorker_ = (r + 1) % workers_.size();
+
+  // the window is full: wait for the oldest packets
+  while (inFlight_ != 0 && inFlight_ + merge_.depth() >= merge_.window())
+    merge(true);
+
+  j->seq_ = nextSeq_++;
+  worker& w = *workers_[r];
+  w.load_.fetch_add(1, std::memory_order_relaxed);
+  {
+    std::lock_guard<std::mutex> lock(w.mutex_);
+    w.jobs_.push_back(j);
+  }
+  w.cv_.notify_one();
+  inFlight_++;
+}
+
+void replica_group::run(worker& w)
+{
+  for (;;) {
+    job* j;
+    {
+      std::unique_lock<std::mutex> lock(w.mutex_);
+      w.cv_.wait(lock, [&w] { return w.stop_ || !w.jobs_.empty(); });
+      if (w.jobs_.empty())
+        return;
+      j = w.jobs_.front();
+      w.jobs_.pop_front();
+    }
+
+    try {
+      if (j->in_[processor::TAG_PORT_IN1])
+        w.replica_->setInput1(j->in_[processor::TAG_PORT_IN1]);
+      w.replica_->runProcess(j->in_[processor::TAG_PORT_PROC]);
+      copyItems(j->out_, j->outOf_, w.replica_->getOutputItems());
+    } catch (...) {
+      j->error_ = std::current_exception();
+    }
+    w.pakets_.fetch_add(1, std::memory_order_relaxed);
+    w.load_.fetch_sub(1, std::memory_order_relaxed);
+
+    done_.push(j);
+    {
+      std::lock_guard<std::mutex> lock(doneMutex_); // no lost wake up of a waiting merge
+    }
+    doneCv_.notify_one();
+  }
+}
+
+void replica_group::emit(job* j)
+{
+  if (j->error_) {
+    std::exception_ptr error = j->error_;
+    j->error_ = nullptr;
+    free_.push_back(j);
+    std::rethrow_exception(error);
+  }
+
+  size_t len = 0, outLen = 0;
+  const void* items = pmt::uniform_vector_elements(j->out_, len);
+  void* out = pmt::uniform_vector_writable_elements(primary_->getOutputItems(), outLen);
+  if (len != outLen) {
+    free_.push_back(j);
+    throw std::invalid_argument("replica output must match the output vector of " + primary_->getModuleName());
+  }
+  std::memcpy(out, items, len);
+
+  // in the order of the ports, as propagateTags() forwards them
+  const uint64_t offset = primary_->getNitemsWritten();
+  for (auto const& tags : j->tags_) {
+    for (auto const& t : tags)
+      primary_->add_item_tag(offset + t.offset_, t);
+  }
+
+  primary_->emitNewTag(primary_->getOutputDataType());
+  primary_->emitNewData();
+  free_.push_back(j);
+}
+
+void replica_group::merge(bool wait)
+{
+  auto release = [this](ObjectIDPaketSeqType, job* const& j) { emit(j); };
+  for (;;) {
+    job* j;
+    if (!done_.pop(j)) {
+      if (!wait || inFlight_ == 0)
+        return;
+      std::unique_lock<std::mutex> lock(doneMutex_);
+      doneCv_.wait(lock, [this] { return !done_.empty(); });
+      continue;
+    }
+    wait = false; // a completed packet is enough, the others are merged as they come
+    inFlight_--;
+
+    switch (merge_.arrive(j->seq_, release)) {
+    case reorder_event::IN_ORDER:
+      emit(j);
+      merge_.advance(release);
+      break;
+    case reorder_event::BUFFERED:
+      merge_.item(j->seq_) = j;
+      break;
+    case reorder_event::LATE:
+      free_.push_back(j); // the window bounds the jobs in flight, so never
+      break;
+    }
+  }
+}
+
+void replica_group::deliver(processor::tag_port port, const processor& src, pmt::pmt_t& items)
+{
+  primary_->receiveTags(port, src);
+  if (port == processor::TAG_PORT_IN1)
+    primary_->emitFirstInput();
+
+  const ObjectIDPaketSeqType seq = primary_->getInputSeq(port).last();
+  if (!pendingStarted_) {
+    pendingStarted_ = true;
+    pendingFrom_ = seq;
+    pendingTo_ = seq;
+  }
+  if (seq < pendingFrom_)
+    return; // its job is gone, the sequence tracker of the port counts it late
+
+  while (seq - pendingFrom_ >= pending_.size()) {
+    if (pendingFrom_ == pendingTo_) {
+      // nothing pending: move the window to seq at once, however far it jumped
+      pendingFrom_ = seq - pending_.size() + 1;
+      pendingTo_ = pendingFrom_;
+      break;
+    }
+    skipPending();
+  }
+  if (seq >= pendingTo_)
+    pendingTo_ = seq + 1;
+
+  job*& slot = pending_[seq & (pending_.size() - 1)];
+  if (!slot) {
+    slot = acquire();
+    slot->arrived_ = 0;
+    slot->tags_[processor::TAG_PORT_PROC].clear();
+    slot->tags_[processor::TAG_PORT_IN1].clear();
+  }
+  job* j = slot;
+  const unsigned bit = 1u << port;
+  if (j->arrived_ & bit)
+    return; // duplicate
+  copyItems(j->in_[port], j->inOf_[port], items);
+  j->arrived_ |= bit;
+
+  // the tags the output packet inherits from this input, as propagateTags() does
+  if (tagPropagation_ == tag_propagation_policy::ALL_TO_ALL ||
+      (tagPropagation_ == tag_propagation_policy::ONE_TO_ONE && port == processor::TAG_PORT_PROC)) {
+    primary_->get_tags_in_window(windowTags_, port, 0, pmt::length(items));
+    for (auto const& t : windowTags_) {
+      j->tags_[port].push_back(t);
+      j->tags_[port].back().offset_ -= primary_->nitems_read(port);
+    }
+  }
+
+  dispatchPending();
+  merge(false);
+}
+
+void replica_group::drain()
+{
+  while (pendingFrom_ != pendingTo_)
+    skipPending();
+  while (inFlight_ != 0)
+    merge(true);
+  merge_.flush([this](ObjectIDPaketSeqType, job* const& j) { emit(j); });
+}
+
+} // namespace pl_proc
@@ -0,0 +1,193 @@
+/**
+ * @file   replica_group.h
+ *
+ * @author Armin Zare Zadeh ali.a.zarezadeh@gmail.com
+ *         Eric J. Mayo eric@pozicom.net
+ *
+ * @brief   replica_group.h includes the data-parallel execution of a stateless
+ *          processor node by replicas of it on worker threads
+ */
+
+#ifndef REPLICA_GROUP_H
+#define REPLICA_GROUP_H
+
+#include "noncopyable.h"
+#include "processor.h"
+#include "mpsc_queue.h"
+#include "reorder_buffer.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+
+namespace pl_proc {
+
+/*!
+ * \brief How a replica_group chooses the replica of a packet
+ */
+enum class replica_dispatch {
+  ROUND_ROBIN,  //< the replicas in turn
+  LEAST_LOADED  //< the replica with the fewest packets queued or running
+};
+
+replica_dispatch ReplicaDispatchFromString(const std::string& s);
+const char* ReplicaDispatchToString(replica_dispatch d);
+
+/*!
+ * \brief Stateless processor node run by replicas of it, each on its own worker
+ *        thread, to scale a hot stage over cores (__replicas__ in the configuration).
+ *
+ * \details
+ * The primary node keeps its place in the pipeline: the connections to its input
+ * ports deliver to the group instead, and it emits the output packets of the
+ * replicas as its own, so its observers (consumers, logger) do not know about the
+ * replicas.  The packets delivered on the connected input ports are copied, with
+ * the stream tags the output inherits from them, into the job of their sequence
+ * number, which is dispatched to a replica once it holds all its inputs, in the
+ * order of the sequence numbers; so the replicas never mix the packets of two
+ * sources as the upstream stages deliver them late, e.g. when they are replicated
+ * too.  A job still missing an input when the window of pending jobs moves past it
+ * is dropped: that window must cover the lag of the inputs (setPendingWindow()).  The replicas process the jobs concurrently and the pipeline thread
+ * merges their outputs in order through a reorder_buffer, on the next deliveries
+ * or at drain().  The number of jobs pending or in flight is bounded by the window,
+ * the pipeline thread waits for the oldest ones beyond.
+ *
+ * The replicas must be stateless (processor::isStateless()): a packet must not
+ * depend on the ones a replica processed before.  The output packets of the
+ * primary follow its input packets with a latency of up to the window, and the
+ * primary must not propagate stream tags itself: the group captures them with the
+ * policy it is given.  Only the pipeline thread calls deliver() and drain().
+ */
+class replica_group : noncopyable
+{
+private:
+  /*!
+   * \brief Packet dispatched to a replica: copies of its inputs, then of its output
+   */
+  struct job
+  {
+    ObjectIDPaketSeqType seq_;                        //< dispatch order
+    unsigned arrived_;                                //< bit p: in_[p] holds the packet
+    pmt::pmt_t in_[processor::NUM_TAG_PORTS];
+    const void* inOf_[processor::NUM_TAG_PORTS];      //< buffer in_ was copied from
+    pmt::pmt_t out_;
+    const void* outOf_;
+    std::vector<stream_tag> tags_[processor::NUM_TAG_PORTS]; //< of each input, relative to the packet
+    std::exception_ptr error_;
+  };
+
+  struct worker
+  {
+    processor::sptr replica_;
+    std::thread thread_;
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    std::deque<job*> jobs_;
+    std::atomic<size_t> load_;      //< jobs queued or running
+    std::atomic<uint64_t> pakets_;  //< jobs processed
+    bool stop_;
+
+    worker() : load_(0), pakets_(0), stop_(false) {}
+  };
+
+  processor::sptr primary_;
+  std::vector<std::unique_ptr<worker>> workers_;
+  replica_dispatch dispatch_;
+  tag_propagation_policy tagPropagation_;
+  size_t nextWorker_;
+
+  std::vector<std::unique_ptr<job>> pool_;  //< all the jobs, at most twice the window
+  std::vector<job*> free_;
+
+  unsigned inputs_;                         //< bit p: input port p is connected
+  std::vector<job*> pending_;               //< by input sequence number modulo the window
+  ObjectIDPaketSeqType pendingFrom_;        //< oldest input sequence number not dispatched
+  ObjectIDPaketSeqType pendingTo_;          //< after the newest one delivered
+  bool pendingStarted_;
+  uint64_t dropped_;
+
+  ObjectIDPaketSeqType nextSeq_;
+  size_t inFlight_;
+  reorder_buffer<job*> merge_;
+  mpsc_queue<job*> done_;
+  std::mutex doneMutex_;
+  std::condition_variable doneCv_;
+
+  std::vector<stream_tag> windowTags_;
+
+  static void copyItems(pmt::pmt_t& dst, const void*& dstOf, const pmt::pmt_t& src);
+
+  job* acquire();
+  void dispatchPending();
+  void skipPending();
+  void dispatch(job* j);
+  void run(worker& w);
+  void emit(job* j);
+  void merge(bool wait);
+
+public:
+  /*!
+   * \brief Run \p primary by its \p replicas, dispatched by \p dispatch, with at most
+   *        \p window packets pending and as many in flight (0: four per replica). The stream tags of the
+   *        inputs are forwarded to the outputs with \p tagPropagation.
+   */
+  replica_group(const processor::sptr& primary,
+                const std::vector<processor::sptr>& replicas,
+                replica_dispatch dispatch,
+                tag_propagation_policy tagPropagation,
+                size_t window = 0);
+  ~replica_group();
+
+  /*!
+   * \brief Declare input \p port of the primary connected: the jobs wait for its packets.
+   */
+  void addInput(processor::tag_port port) { inputs_ |= 1u << port; }
+
+  /*!
+   * \brief Let up to \p window jobs wait for their inputs, at least the window of the
+   *        merge, to cover the packets an input lags behind the others, e.g. behind
+   *        upstream replica groups. Called before the first delivery.
+   */
+  void setPendingWindow(size_t window);
+
+  /*!
+   * \brief Deliver the packet \p items which \p src has just emitted to input \p port
+   *        of the primary, to the job of its sequence number.
+   */
+  void deliver(processor::tag_port port, const processor& src, pmt::pmt_t& items);
+
+  /*!
+   * \brief Wait for the packets in flight and emit them, dropping the jobs which
+   *        still miss an input. Called at the end of a run.
+   */
+  void drain();
+
+  const processor::sptr& getPrimary() const { return primary_; }
+  size_t getReplicas() const { return workers_.size(); }
+  size_t getWindow() const { return merge_.window(); }
+  size_t getPendingWindow() const { return pending_.size(); }
+  replica_dispatch getDispatch() const { return dispatch_; }
+
+  //! Number of packets replica \p r processed so far
+  uint64_t getPakets(size_t r) const { return workers_[r]->pakets_.load(std::memory_order_relaxed); }
+
+  //! Number of jobs dropped as they missed an input
+  uint64_t getDropped() const { return dropped_; }
+
+  //! Counters of the merge of the outputs, whose buffered ones completed out of order
+  const reorder_stats& getMergeStats() const { return merge_.stats(); }
+
+  typedef std::shared_ptr<replica_group> sptr;
+};
+
+} // namespace pl_proc
+
+#endif /* REPLICA_GROUP_H */
@@ -0,0 +1,170 @@
+/**
+ * @file   seq_tracker.h
+ *
+ * @author Armin Zare Zadeh ali.a.zarezadeh@gmail.com
+ *         Eric J. Mayo eric@pozicom.net
+ *
+ * @brief   seq_tracker.h includes the packet sequence number arithmetic and the
+ *          tracker which detects the gaps and reorderings of a packet stream
+ */
+
+#ifndef SEQ_TRACKER_H
+#define SEQ_TRACKER_H
+
+#include "id.h"
+
+#include <cstdint>
+#include <ostream>
+
+
+namespace pl_proc {
+
+/*!
+ * \brief Whether packet index \p a comes before \p b, in the serial number arithmetic
+ *        of RFC 1982: the indices wrap and \p b is after \p a if it is less than half
+ *        the index space ahead.
+ */
+inline bool seq_before(ObjectIDPaketIndexType a, ObjectIDPaketIndexType b)
+{
+  return static_cast<int32_t>(b - a) > 0;
+}
+
+/*!
+ * \brief Sequence number of the packet of index \p index (the low bits of its
+ *        sequence number, as encoded in an ObjectID) which is the closest to the
+ *        sequence number \p ref of a packet of the same module.
+ *        Exact as long as the two packets are less than 2^31 packets apart.
+ */
+inline ObjectIDPaketSeqType seq_unwrap(ObjectIDPaketIndexType index, ObjectIDPaketSeqType ref)
+{
+  const int32_t delta = static_cast<int32_t>(index - static_cast<ObjectIDPaketIndexType>(ref));
+  if (delta < 0 && ref < static_cast<ObjectIDPaketSeqType>(-static_cast<int64_t>(delta)))
+    return ref + static_cast<uint32_t>(delta); // before the start of the stream: the index is ahead
+  return ref + delta;
+}
+
+/*!
+ * \brief Arrival state of one packet in a seq_tracker
+ */
+enum class seq_event {
+  IN_ORDER,  //< the next expected packet
+  GAP,       //< ahead of the next expected packet, the ones in between are missing
+  LATE,      //< a missing packet, arrived after later ones
+  DUPLICATE  //< a packet arrived already
+};
+
+/*!
+ * \brief Tracker of the packet sequence numbers arriving at a port, like the
+ *        receive side of RTP: counts the gaps, the late (reordered) packets and the
+ *        duplicates.
+ *
+ * \details
+ * The tracker expects the sequence number after the highest one seen and keeps a
+ * bitmap of the last kWindow ones, so a packet behind it is told late or duplicate
+ * at the cost of a shift; packets more than kWindow behind are counted late.
+ * Packets which arrive once, in order, only compare and increment.  It is not
+ * thread safe, a port is observed by the thread delivering to it.
+ */
+class seq_tracker
+{
+private:
+  ObjectIDPaketSeqType next_;   //< sequence number after the highest one seen
+  uint64_t window_;             //< bit k: next_ - 1 - k has arrived
+  ObjectIDPaketSeqType last_;   //< sequence number of the packet seen last
+  uint64_t received_;
+  uint64_t gaps_;
+  uint64_t missing_;
+  uint64_t late_;
+  uint64_t duplicates_;
+
+public:
+  //! Number of sequence numbers behind the highest one told late or duplicate exactly
+  static constexpr ObjectIDPaketSeqType kWindow = 64;
+
+  seq_tracker() { reset(); }
+
+  void reset()
+  {
+    next_ = 0;
+    window_ = 0;
+    last_ = 0;
+    received_ = 0;
+    gaps_ = 0;
+    missing_ = 0;
+    late_ = 0;
+    duplicates_ = 0;
+  }
+
+  /*!
+   * \brief Account the arrival of the packet of sequence number \p seq.
+   */
+  seq_event observe(ObjectIDPaketSeqType seq)
+  {
+    const bool first = received_++ == 0;
+    last_ = seq;
+    if (first || seq == next_) {
+      window_ = first ? 1 : (window_ << 1) | 1;
+      next_ = seq + 1;
+      return seq_event::IN_ORDER;
+    }
+
+    if (seq > next_) {
+      const ObjectIDPaketSeqType shift = seq + 1 - next_;
+      window_ = (shift < kWindow ? window_ << shift : 0) | 1;
+      gaps_++;
+      missing_ += seq - next_;
+      next_ = seq + 1;
+      return seq_event::GAP;
+    }
+
+    const ObjectIDPaketSeqType behind = next_ - 1 - seq;
+    if (behind < kWindow) {
+      const uint64_t bit = uint64_t(1) << behind;
+      if (window_ & bit) {
+        duplicates_++;
+        return seq_event::DUPLICATE;
+      }
+      window_ |= bit;
+    }
+    late_++;
+    if (missing_ != 0)
+      missing_--;
+    return seq_event::LATE;
+  }
+
+  /*!
+   * \brief Account the arrival of the packet of index \p index, the low bits of its
+   *        sequence number, as encoded in an ObjectID.
+   */
+  seq_event observe_index(ObjectIDPaketIndexType index)
+  {
+    return observe(received_ == 0 ? index : seq_unwrap(index, next_ - 1));
+  }
+
+  bool started() const { return received_ != 0; }
+
+  //! Sequence number of the packet seen last
+  ObjectIDPaketSeqType last() const { return last_; }
+
+  //! Sequence number after the highest one seen
+  ObjectIDPaketSeqType next() const { return next_; }
+
+  uint64_t received() const { return received_; }
+  uint64_t gaps() const { return gaps_; }
+  uint64_t missing() const { return missing_; }
+  uint64_t late() const { return late_; }
+  uint64_t duplicates() const { return duplicates_; }
+
+  //! Whether the packets have arrived once each and in order so far
+  bool in_order() const { return gaps_ == 0 && late_ == 0 && duplicates_ == 0; }
+
+  void print(std::ostream& os) const
+  {
+    os << "received " << received_ << ", gaps " << gaps_ << " (" << missing_ << " missing)"
+       << ", late " << late_ << ", duplicates " << duplicates_;
+  }
+};
+
+} // namespace pl_proc
+
+#endif /* SEQ_TRACKER_H */
@@ -9,97 +9,345 @@
 #ifndef SIGNAL_SLOT_H
 #define SIGNAL_SLOT_H
 
-#include <functional>
-#include <map>
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
 #include <memory>
+#include <mutex>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
 
 
 namespace pl_proc {
 
+// Type erased callable of a slot, like std::function<void(Args...)> but
+// keeping callables of up to kInlineSize bytes (a lambda with two captured
+// shared pointers and two pointers, as the pipeline edges, or a shared
+// pointer and a member function pointer) in place, so calling a slot costs
+// one indirect call and no allocation is made at connect time for the
+// usual slots.
+
+template <typename... Args>
+class slot_function {
+
+ public:
+
+  static constexpr std::size_t kInlineSize = 6 * sizeof(void*);
+
+  slot_function() : invoke_(nullptr), manage_(nullptr) {}
+
+  template <typename F, typename = typename std::enable_if<
+                          !std::is_same<typename std::decay<F>::type, slot_function>::value>::type>
+  slot_function(F&& f) : invoke_(nullptr), manage_(nullptr) {
+    using Fn = typename std::decay<F>::type;
+    if constexpr (is_inline<Fn>()) {
+      new (storage_) Fn(std::forward<F>(f));
+      invoke_ = &invoke_inline<Fn>;
+      manage_ = &manage_inline<Fn>;
+    } else {
+      *reinterpret_cast<Fn**>(storage_) = new Fn(std::forward<F>(f));
+      invoke_ = &invoke_heap<Fn>;
+      manage_ = &manage_heap<Fn>;
+    }
+  }
+
+  slot_function(slot_function&& other) noexcept : invoke_(nullptr), manage_(nullptr) {
+    take(other);
+  }
+
+  slot_function& operator=(slot_function&& other) noexcept {
+    if (this != &other) {
+      reset();
+      take(other);
+    }
+    return *this;
+  }
+
+  slot_function(slot_function const& other) : invoke_(nullptr), manage_(nullptr) {
+    if (other.manage_ != nullptr)
+      other.manage_(op::COPY, storage_, const_cast<unsigned char*>(other.storage_));
+    invoke_ = other.invoke_;
+    manage_ = other.manage_;
+  }
+
+  slot_function& operator=(slot_function const& other) {
+    if (this != &other) {
+      slot_function copy(other);
+      *this = std::move(copy);
+    }
+    return *this;
+  }
+
+  ~slot_function() { reset(); }
+
+  explicit operator bool() const { return invoke_ != nullptr; }
+
+  void operator()(Args... args) const {
+    invoke_(const_cast<unsigned char*>(storage_), std::forward<Args>(args)...);
+  }
+
+ private:
+
+  enum class op { COPY, MOVE, DESTROY };
+
+  using invoke_fn = void (*)(void*, Args...);
+  using manage_fn = void (*)(op, void*, void*);
+
+  template <typename Fn>
+  static constexpr bool is_inline() {
+    return sizeof(Fn) <= kInlineSize && alignof(Fn) <= alignof(std::max_align_t) &&
+           std::is_nothrow_move_constructible<Fn>::value;
+  }
+
+  template <typename Fn>
+  static void invoke_inline(void* storage, Args... args) {
+    (*static_cast<Fn*>(storage))(std::forward<Args>(args)...);
+  }
+
+  template <typename Fn>
+  static void invoke_heap(void* storage, Args... args) {
+    (**static_cast<Fn**>(storage))(std::forward<Args>(args)...);
+  }
+
+  template <typename Fn>
+  static void manage_inline(op o, void* dst, void* src) {
+    Fn* f = static_cast<Fn*>(src);
+    if (o == op::COPY) {
+      new (dst) Fn(*f);
+      return;
+    }
+    if (o == op::MOVE)
+      new (dst) Fn(std::move(*f));
+    f->~Fn();
+  }
+
+  template <typename Fn>
+  static void manage_heap(op o, void* dst, void* src) {
+    if (o == op::COPY)
+      *static_cast<Fn**>(dst) = new Fn(**static_cast<Fn**>(src));
+    else if (o == op::MOVE)
+      *static_cast<Fn**>(dst) = *static_cast<Fn**>(src);
+    else
+      delete *static_cast<Fn**>(src);
+  }
+
+  void take(slot_function& other) {
+    if (other.manage_ != nullptr)
+      other.manage_(op::MOVE, storage_, other.storage_);
+    invoke_ = other.invoke_;
+    manage_ = other.manage_;
+    other.invoke_ = nullptr;
+    other.manage_ = nullptr;
+  }
+
+  void reset() {
+    if (manage_ != nullptr)
+      manage_(op::DESTROY, nullptr, storage_);
+    invoke_ = nullptr;
+    manage_ = nullptr;
+  }
+
+  alignas(std::max_align_t) unsigned char storage_[kInlineSize];
+  invoke_fn invoke_;
+  manage_fn manage_;
+};
+
+// Read side of the RCU scheme of signal_slot: the number of threads which
+// are emitting some signal. Emits nest (the slots of an edge run the next
+// processor which emits its own signals), so a thread is only counted once,
+// by its outermost emit, and the inner ones cost a thread local increment.
+
+class emit_section {
+
+ public:
+
+  emit_section() {
+    // counted before the slots are read, so that a writer which swapped
+    // them either sees this reader or is seen by it
+    if (depth()++ == 0)
+      readers().fetch_add(1, std::memory_order_seq_cst);
+  }
+
+  ~emit_section() {
+    if (--depth() == 0)
+      readers().fetch_sub(1, std::memory_order_release);
+  }
+
+  emit_section(emit_section const&) = delete;
+  emit_section& operator=(emit_section const&) = delete;
+
+  // true if no thread is emitting, so no replaced slot vector is in use
+  static bool idle() {
+    return readers().load(std::memory_order_seq_cst) == 0;
+  }
+
+ private:
+
+  static std::atomic<int>& readers() {
+    static std::atomic<int> readers(0);
+    return readers;
+  }
+
+  static int& depth() {
+    thread_local int depth = 0;
+    return depth;
+  }
+};
+
 // A signal object may call multiple slots with the
 // same signature. You can connect functions to the signal
 // which will be called when the emit() method on the
 // signal object is invoked. Any argument passed to emit()
 // will be passed to the given functions.
+//
+// The slots are kept in a flat vector in connection order, so ids
+// increase along it and disconnect finds a slot by binary search.
+//
+// connect and disconnect may be called from any thread, also while the
+// signal is emitted (e.g. to attach a probe or a logger to a running
+// pipeline). The slot vector is never modified once published: they copy
+// it, change the copy and publish it with an atomic pointer swap (RCU
+// style), so emit only takes a snapshot and never blocks. A replaced
+// vector is deleted once no thread is emitting (see emit_section), at the
+// next connect or disconnect of the signal which sees it, or with the
+// signal. An emit running while a slot is disconnected may still call it.
 
 template <typename... Args>
 class signal_slot {
 
  public:
 
-  signal_slot() : current_id_(0) {}
+  signal_slot() : slots_(new slot_list()), size_(0), current_id_(0) {}
 
   // copy creates new signal
-  signal_slot(signal_slot const& other) : current_id_(0) {}
+  signal_slot(signal_slot const& other) : slots_(new slot_list()), size_(0), current_id_(0) {}
+
+  ~signal_slot() {
+    delete slots_.load(std::memory_order_relaxed);
+    for (auto l : retired_)
+      delete l;
+  }
 
   // connects a member function to this Signal
   template <typename T>
   int connect_member(T *inst, void (T::*func)(Args...)) {
-    return connect([=](Args... args) {
-      (inst->*func)(args...);
-    });
+    return connect(member_thunk<T*, void (T::*)(Args...)>{inst, func});
   }
 
   // connects a const member function to this Signal
   template <typename T>
   int connect_member(T *inst, void (T::*func)(Args...) const) {
-    return connect([=](Args... args) {
-      (inst->*func)(args...);
-    });
+    return connect(member_thunk<T*, void (T::*)(Args...) const>{inst, func});
   }
 
   // connects a member function to this Signal (shared pointer)
   template <typename T>
   int connect_member(std::shared_ptr<T> inst, void (T::*func)(Args...)) {
-    return connect([=](Args... args) {
-//      (inst->*func)(args...);
-   	  T *inst_raw = inst.get();
-   	  (inst_raw->*func)(args...);
-    });
+    return connect(member_thunk<std::shared_ptr<T>, void (T::*)(Args...)>{std::move(inst), func});
   }
 
 
   // connects a const member function to this Signal  (shared pointer)
   template <typename T>
   int connect_member(std::shared_ptr<T> inst, void (T::*func)(Args...) const) {
-    return connect([=](Args... args) {
-//      (inst->*func)(args...);
-      T *inst_raw = inst.get();
-      (inst_raw->*func)(args...);
-    });
+    return connect(member_thunk<std::shared_ptr<T>, void (T::*)(Args...) const>{std::move(inst), func});
   }
 
-  // connects a std::function to the signal. The returned
-  // value can be used to disconnect the function again
-  int connect(std::function<void(Args...)> const& slot) const {
-    slots_.insert(std::make_pair(++current_id_, slot));
+  // connects a callable (lambda, function pointer, std::function) to the
+  // signal. The returned value can be used to disconnect the function again
+  template <typename F>
+  int connect(F&& slot) const {
+    slot_function<Args...> fn(std::forward<F>(slot));
+    std::lock_guard<std::mutex> lock(mutex_);
+    slot_list* next = new slot_list(*slots_.load(std::memory_order_relaxed));
+    next->push_back(slot_entry{++current_id_, std::move(fn)});
+    publish(next);
     return current_id_;
   }
 
   // disconnects a previously connected function
   void disconnect(int id) const {
-    slots_.erase(id);
+    std::lock_guard<std::mutex> lock(mutex_);
+    const slot_list* current = slots_.load(std::memory_order_relaxed);
+    auto it = std::lower_bound(current->begin(), current->end(), id,
+                               [](slot_entry const& s, int i) { return s.id < i; });
+    if (it == current->end() || it->id != id)
+      return;
+
+    slot_list* next = new slot_list();
+    next->reserve(current->size() - 1);
+    for (auto const& s : *current) {
+      if (s.id != id)
+        next->push_back(s);
+    }
+    publish(next);
   }
 
   // disconnects all previously connected functions
   void disconnect_all() const {
-    slots_.clear();
+    std::lock_guard<std::mutex> lock(mutex_);
+    publish(new slot_list());
+  }
+
+  // number of connected functions; a counter kept by publish, as the slot
+  // vector may only be read inside an emit_section
+  std::size_t size() const {
+    return size_.load(std::memory_order_acquire);
   }
 
+  // true if no function is connected, safe outside an emit like size()
+  bool empty() const { return size() == 0; }
+
   // calls all connected functions
   void emit(Args... p) {
-    for(auto it : slots_) {
-      it.second(p...);
+    emit_section section;
+    const slot_list* current = slots_.load(std::memory_order_seq_cst);
+    for (auto const& s : *current) {
+      s.fn(p...);
     }
   }
 
   // assignment creates new Signal
   signal_slot& operator=(signal_slot const& other) {
     disconnect_all();
+    return *this;
   }
 
  private:
-  mutable std::map<int, std::function<void(Args...)>> slots_;
+
+  template <typename P, typename M>
+  struct member_thunk {
+    P inst;
+    M func;
+    void operator()(Args... args) const {
+      ((*inst).*func)(std::forward<Args>(args)...);
+    }
+  };
+
+  struct slot_entry {
+    int id;
+    slot_function<Args...> fn;
+  };
+
+  using slot_list = std::vector<slot_entry>;
+
+  // called with mutex_ held
+  void publish(slot_list* next) const {
+    size_.store(next->size(), std::memory_order_release);
+    retired_.push_back(slots_.exchange(next, std::memory_order_seq_cst));
+    if (emit_section::idle()) {
+      for (auto l : retired_)
+        delete l;
+      retired_.clear();
+    }
+  }
+
+  mutable std::atomic<const slot_list*> slots_;
+  mutable std::atomic<std::size_t> size_;
+  mutable std::mutex mutex_;
+  mutable std::vector<const slot_list*> retired_;
   mutable int current_id_;
 };
 
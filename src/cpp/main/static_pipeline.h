@@ -0,0 +1,172 @@
+/**
+ * @file   static_pipeline.h
+ *
+ * @author Armin Zare Zadeh ali.a.zarezadeh@gmail.com
+ *         Eric J. Mayo eric@pozicom.net
+ *
+ * @brief   static_pipeline.h includes a header only API to describe a fixed
+ *          processing pipeline as a type and compile it into a single loop.
+ */
+
+#ifndef STATIC_PIPELINE_H
+#define STATIC_PIPELINE_H
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <stdexcept>
+#include <type_traits>
+#include <vector>
+
+
+namespace pl_proc {
+
+/*!
+ * The dynamic pipeline built by sys_builder wires processor nodes at run-time
+ * through signal/slot connections, so every edge is an indirect call and every
+ * node writes a complete output genVector. For a fixed production graph the
+ * same pipeline can be described as a type instead:
+ *
+ * \code
+ *   using sample_pipeline = static_pipeline<
+ *     static_vec_sink<
+ *       static_adder<static_vec_src<std::uint8_t, 0>,
+ *                    static_vec_src<std::uint8_t, 1>>>>;
+ *
+ *   sample_pipeline pipeline(paket_len, {&data1, &data2});
+ *   while (pipeline.run_paket()) { use(pipeline.getData()); }
+ * \endcode
+ *
+ * Each stage is a stateless type with a static eval() returning the item at a
+ * given position of the current packet, so all edges resolve to direct inline
+ * calls and the compiler fuses the whole graph into one (vectorizable) loop
+ * without intermediate buffers. Both APIs co-exist; the static one has no
+ * logging, tags or run-time rewiring.
+ */
+
+/*!
+ * \brief Source stage that streams the items of input vector \p I, in packets,
+ *        like vec_src_blk without repeat.
+ */
+template <class T, std::size_t I>
+struct static_vec_src
+{
+  using value_type = T;
+  static constexpr std::size_t num_sources = I + 1;
+
+  template <std::size_t N>
+  static T eval(const std::array<const T*, N>& src, std::size_t k)
+  {
+    return src[I][k];
+  }
+};
+
+/*!
+ * \brief Adder stage that adds the items of its two input stages, like adder_blk.
+ */
+template <class In1, class In2>
+struct static_adder
+{
+  static_assert(std::is_same<typename In1::value_type, typename In2::value_type>::value,
+                "static_adder inputs must have the same item type");
+
+  using value_type = typename In1::value_type;
+  static constexpr std::size_t num_sources = std::max(In1::num_sources, In2::num_sources);
+
+  template <std::size_t N>
+  static value_type eval(const std::array<const value_type*, N>& src, std::size_t k)
+  {
+    return In1::eval(src, k) + In2::eval(src, k);
+  }
+};
+
+/*!
+ * \brief Sink stage that keeps the last packet produced by its input stage,
+ *        like vec_sink_blk.
+ */
+template <class In>
+struct static_vec_sink
+{
+  using value_type = typename In::value_type;
+  using input = In;
+  static constexpr std::size_t num_sources = In::num_sources;
+};
+
+/*!
+ * \brief Pipeline compiled from the graph ending in the sink stage \p Sink.
+ *        All source vectors share the item type of the sink.
+ */
+template <class Sink>
+class static_pipeline
+{
+public:
+  using value_type = typename Sink::value_type;
+  static constexpr std::size_t num_sources = Sink::num_sources;
+
+private:
+  std::array<const std::vector<value_type>*, num_sources> data_;
+  std::vector<value_type> out_;
+  std::size_t paket_len_;
+  std::size_t offset_;
+  std::size_t paketIndex_;
+
+public:
+  static_pipeline(std::size_t paket_len, const std::array<const std::vector<value_type>*, num_sources>& data)
+    : data_(data),
+      out_(paket_len, value_type(0)),
+      paket_len_(paket_len),
+      offset_(0),
+      paketIndex_(0)
+  {
+    for (auto d : data_) {
+      if (d == nullptr)
+        throw std::invalid_argument("static_pipeline source data must not be null");
+    }
+  }
+
+  void rewind() { offset_ = 0; paketIndex_ = 0; }
+
+  /*!
+   * \brief Push the next packet through the pipeline.
+   *        Returns false once a source has no more data.
+   */
+  bool run_paket()
+  {
+    std::size_t n = paket_len_;
+    for (auto d : data_) {
+      if (offset_ >= d->size())
+        return false; // Done!
+      n = std::min(n, d->size() - offset_);
+    }
+
+    std::array<const value_type*, num_sources> src;
+    for (std::size_t i = 0; i < num_sources; i++)
+      src[i] = data_[i]->data() + offset_;
+
+    value_type* out = out_.data();
+    for (std::size_t k = 0; k < n; k++)
+      out[k] = Sink::input::eval(src, k);
+
+    offset_ += n;
+    paketIndex_++;
+    return true;
+  }
+
+  /*!
+   * \brief Push all packets through the pipeline and return their number.
+   */
+  std::size_t run()
+  {
+    std::size_t n = 0;
+    while (run_paket())
+      n++;
+    return n;
+  }
+
+  const std::vector<value_type>& getData() const { return out_; }
+  std::size_t getPaketIndex() const { return paketIndex_; }
+};
+
+} // namespace pl_proc
+
+#endif /* STATIC_PIPELINE_H */
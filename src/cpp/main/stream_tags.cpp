@@ -0,0 +1,57 @@
+/**
+ * @file   stream_tags.cpp
+ *
+ * @author Armin Zare Zadeh ali.a.zarezadeh@gmail.com
+ *         Eric J. Mayo eric@pozicom.net
+ *
+ * @brief   stream_tags.cpp includes the configuration of the stream tags
+ */
+
+#include "stream_tags.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+
+namespace pl_proc {
+
+tag_propagation_policy TagPropagationFromString(const std::string& name)
+{
+  if      (name == "DONT")       return tag_propagation_policy::DONT;
+  else if (name == "ALL_TO_ALL") return tag_propagation_policy::ALL_TO_ALL;
+  else if (name == "ONE_TO_ONE") return tag_propagation_policy::ONE_TO_ONE;
+  throw std::invalid_argument("unknown __tag_propagation__ policy: " + name);
+}
+
+std::vector<stream_tag> StreamTagsFromJson(const json11::Json& cfg, ObjectIDModuleIndexType srcid)
+{
+  if (!cfg.is_array())
+    throw std::invalid_argument("__stream_tags__ must be a JSON array");
+
+  std::vector<stream_tag> tags;
+  for (auto const& t : cfg.array_items()) {
+    if (!t.is_array() || t.array_items().size() != 3 || !t[0].is_number() || !t[1].is_string())
+      throw std::invalid_argument("__stream_tags__ entries must be [offset, \"key\", value]: " + t.dump());
+    if (t[0].number_value() < 0)
+      throw std::invalid_argument("__stream_tags__ offsets must not be negative: " + t.dump());
+
+    pmt::pmt_t value;
+    if (t[2].is_bool())
+      value = pmt::from_bool(t[2].bool_value());
+    else if (t[2].is_number() && t[2].number_value() == static_cast<double>(t[2].int_value()))
+      value = pmt::from_long(t[2].int_value());
+    else if (t[2].is_number())
+      value = pmt::from_double(t[2].number_value());
+    else if (t[2].is_string())
+      value = pmt::intern(t[2].string_value());
+    else
+      throw std::invalid_argument("__stream_tags__ values must be numbers, booleans or strings: " + t.dump());
+
+    tags.push_back(stream_tag{static_cast<uint64_t>(t[0].number_value()), pmt::intern(t[1].string_value()), value, srcid});
+  }
+
+  std::stable_sort(tags.begin(), tags.end(), stream_tag::offset_compare);
+  return tags;
+}
+
+} // namespace pl_proc
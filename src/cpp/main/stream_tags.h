@@ -0,0 +1,210 @@
+/**
+ * @file   stream_tags.h
+ *
+ * @author Armin Zare Zadeh ali.a.zarezadeh@gmail.com
+ *         Eric J. Mayo eric@pozicom.net
+ *
+ * @brief   stream_tags.h includes the stream tags carried along the pipeline
+ *          connections and the sorted ring which stores them
+ */
+
+#ifndef STREAM_TAGS_H
+#define STREAM_TAGS_H
+
+#include "pmt.h"
+#include "id.h"
+#include "json11.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+
+namespace pl_proc {
+
+/*!
+ * \brief Stream tag, like the GNU Radio item tags: a (key, value) pair attached to
+ *        the item at absolute index \p offset_ of a stream.
+ *
+ * \details
+ * Unlike tag_t, which describes a whole packet for the logger, stream tags travel
+ * with the items through the pipeline connections: a processor node adds them to
+ * its output with add_item_tag(), its consumers read the ones of their input window
+ * with get_tags_in_range(), and the propagation policy of every node forwards them
+ * from its inputs to its output.
+ */
+struct stream_tag {
+  //! the absolute index of the tagged item in the stream
+  uint64_t offset_;
+
+  //! the key of \p tag (as a PMT symbol)
+  pmt::pmt_t key_;
+
+  //! the value of \p tag (as a PMT)
+  pmt::pmt_t value_;
+
+  //! the module index of the processor node which added \p tag
+  ObjectIDModuleIndexType srcid_;
+
+  static inline bool offset_compare(const stream_tag& x, const stream_tag& y)
+  {
+    return x.offset_ < y.offset_;
+  }
+};
+
+/*!
+ * \brief How a processor node forwards the stream tags of its input windows to its
+ *        output packet, with the item offsets shifted to the output stream:
+ *
+ * - DONT:       the tags stop at this node
+ * - ALL_TO_ALL: the tags of every input port (default)
+ * - ONE_TO_ONE: only the tags of the Proc port, the input the output items are made of
+ */
+enum class tag_propagation_policy { DONT, ALL_TO_ALL, ONE_TO_ONE };
+
+/*!
+ * \brief Policy named \p name (DONT, ALL_TO_ALL or ONE_TO_ONE).
+ *        Throws std::invalid_argument if it is unknown.
+ */
+tag_propagation_policy TagPropagationFromString(const std::string& name);
+
+/*!
+ * \brief Stream tags out of a __stream_tags__ JSON array of [offset, "key", value]
+ *        triples, sorted by offset; the value is a number, a boolean or a symbol.
+ *        Throws std::invalid_argument if it is malformed.
+ */
+std::vector<stream_tag> StreamTagsFromJson(const json11::Json& cfg, ObjectIDModuleIndexType srcid);
+
+/*!
+ * \brief Stream tags of one connection, sorted by offset, in a ring of fixed capacity.
+ *
+ * \details
+ * The slots are allocated once, with the first tag, so storing a tag only copies
+ * its key and value handles, and a range lookup is a binary search over the ring.
+ * Tags normally arrive in offset order and are appended; an out of order one is
+ * inserted at its place.  Once the ring is full the oldest tag is dropped, and
+ * counted.
+ */
+class tag_ring
+{
+private:
+  std::vector<stream_tag> slots_; //< allocated by the first push, most connections never carry tags
+  size_t capacity_;
+  size_t mask_;
+  size_t head_;   //< slot of the oldest tag
+  size_t size_;
+  uint64_t dropped_;
+
+  stream_tag& at(size_t k) { return slots_[(head_ + k) & mask_]; }
+  const stream_tag& at(size_t k) const { return slots_[(head_ + k) & mask_]; }
+
+  void drop_front()
+  {
+    stream_tag& t = at(0);
+    t.key_ = nullptr;
+    t.value_ = nullptr;
+    head_ = (head_ + 1) & mask_;
+    size_--;
+  }
+
+public:
+  //! Default number of tags a ring holds
+  static constexpr size_t kDefaultCapacity = 64;
+
+  explicit tag_ring(size_t capacity = kDefaultCapacity)
+    : capacity_(1), mask_(0), head_(0), size_(0), dropped_(0)
+  {
+    while (capacity_ < capacity)
+      capacity_ <<= 1;
+    mask_ = capacity_ - 1;
+  }
+
+  bool empty() const { return size_ == 0; }
+  size_t size() const { return size_; }
+  size_t capacity() const { return capacity_; }
+  uint64_t dropped() const { return dropped_; }
+
+  const stream_tag& operator[](size_t k) const { return at(k); }
+
+  /*!
+   * \brief Index of the first tag at offset \p offset or later.
+   */
+  size_t lower_bound(uint64_t offset) const
+  {
+    size_t lo = 0, hi = size_;
+    while (lo < hi) {
+      const size_t mid = lo + (hi - lo) / 2;
+      if (at(mid).offset_ < offset)
+        lo = mid + 1;
+      else
+        hi = mid;
+    }
+    return lo;
+  }
+
+  void push(const stream_tag& tag)
+  {
+    if (size_ == slots_.size()) {
+      if (slots_.empty()) {
+        slots_.resize(capacity_);
+      } else {
+        drop_front();
+        dropped_++;
+      }
+    }
+
+    // the common case: tags arrive in offset order
+    size_t k = size_;
+    if (size_ != 0 && tag.offset_ < at(size_ - 1).offset_) {
+      k = lower_bound(tag.offset_ + 1);
+      for (size_t j = size_; j > k; j--)
+        at(j) = at(j - 1);
+    }
+    size_++;
+    at(k) = tag;
+  }
+
+  /*!
+   * \brief Drop the tags before offset \p offset.
+   */
+  void prune(uint64_t offset)
+  {
+    while (size_ != 0 && at(0).offset_ < offset)
+      drop_front();
+  }
+
+  void clear()
+  {
+    while (size_ != 0)
+      drop_front();
+  }
+
+  /*!
+   * \brief Append the tags within [\p start, \p end) to \p tags, with \p key only if not null.
+   */
+  void get_in_range(std::vector<stream_tag>& tags, uint64_t start, uint64_t end, const pmt::pmt_t& key = nullptr) const
+  {
+    for (size_t k = lower_bound(start); k < size_ && at(k).offset_ < end; k++) {
+      if (!key || pmt::eqv(at(k).key_, key))
+        tags.push_back(at(k));
+    }
+  }
+
+  /*!
+   * \brief Push the tags within [\p start, \p end) of this ring to \p dst, their
+   *        offsets shifted by \p shift.
+   */
+  void copy_range(tag_ring& dst, uint64_t start, uint64_t end, int64_t shift = 0) const
+  {
+    for (size_t k = lower_bound(start); k < size_ && at(k).offset_ < end; k++) {
+      stream_tag t = at(k);
+      t.offset_ += shift;
+      dst.push(t);
+    }
+  }
+};
+
+} // namespace pl_proc
+
+#endif /* STREAM_TAGS_H */
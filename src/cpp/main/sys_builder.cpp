@@ -18,20 +18,92 @@
 
 #include "pmt.h"
 #include "tags.h"
+#include "stream_tags.h"
 
 
 #include <stdlib.h>
+#include <algorithm>
 #include <cmath>
+#include <complex>
 #include <cstdio>
 #include <fstream>
+#include <functional>
 #include <iostream>
 #include <stdexcept>
 #include <string>
 #include <regex>
+#include <map>
+#include <set>
 
 namespace pl_proc {
 
-sys_builder::sys_builder(const char* cfg_file_name)
+/*!
+ * \brief Tile sizes timed at startup when __tile_bytes__ is not set, from L1 to L2 sized.
+ */
+static const std::vector<size_t> kTileBytesCandidates = {
+  4 * 1024, 8 * 1024, 16 * 1024, 32 * 1024, 64 * 1024, 128 * 1024, 256 * 1024, 512 * 1024, 1024 * 1024
+};
+
+template <class T>
+static pmt::pmt_t to_genVector(const std::vector<std::uint8_t>& data)
+{
+  return pmt::init_genVector<T>(data.size(), std::vector<T>(data.begin(), data.end()));
+}
+
+/*!
+ * \brief Source data converted from the bytes of the data file to items of type \p typeStr,
+ *        one item per byte.
+ */
+static pmt::pmt_t make_source_data(const std::string& typeStr, const std::vector<std::uint8_t>& data)
+{
+  const std::map<pmt::DataType, std::function<pmt::pmt_t()>> factory{
+    {pmt::DataType::UINT8,          [&]() { return to_genVector<std::uint8_t>(data); } },
+    {pmt::DataType::INT8,           [&]() { return to_genVector<std::int8_t>(data); } },
+    {pmt::DataType::UINT16,         [&]() { return to_genVector<std::uint16_t>(data); } },
+    {pmt::DataType::INT16,          [&]() { return to_genVector<std::int16_t>(data); } },
+    {pmt::DataType::UINT32,         [&]() { return to_genVector<std::uint32_t>(data); } },
+    {pmt::DataType::INT32,          [&]() { return to_genVector<std::int32_t>(data); } },
+    {pmt::DataType::UINT64,         [&]() { return to_genVector<std::uint64_t>(data); } },
+    {pmt::DataType::INT64,          [&]() { return to_genVector<std::int64_t>(data); } },
+    {pmt::DataType::FLOAT,          [&]() { return to_genVector<float>(data); } },
+    {pmt::DataType::DOUBLE,         [&]() { return to_genVector<double>(data); } },
+    {pmt::DataType::COMPLEX_FLOAT,  [&]() { return to_genVector<std::complex<float>>(data); } },
+    {pmt::DataType::COMPLEX_DOUBLE, [&]() { return to_genVector<std::complex<double>>(data); } }
+  };
+  auto it = factory.find(pmt::TypeFromString(typeStr));
+  return (it != factory.end()) ? it->second() : to_genVector<std::uint8_t>(data);
+}
+
+/*!
+ * \brief Tag settings of the processor node \p node out of its configuration:
+ *        "__tag_batch__" (default \p tagBatch), "__tag_propagation__" policy,
+ *        and "__stream_tags__" of a source node.
+ */
+static void configure_tags(const processor::sptr& node, const json11::Json& cfg, int tagBatch)
+{
+  if (!node)
+    return;
+
+  // TAG batches, from the node or the __general__ section
+  if (!cfg["__tag_batch__"].is_null()) {
+    LOG(INFO, true) << "    - Tag Batch: " << cfg["__tag_batch__"].int_value() << "\n";
+    tagBatch = cfg["__tag_batch__"].int_value();
+  }
+  node->setTagBatchSize(std::max(1, tagBatch));
+
+  if (!cfg["__tag_propagation__"].is_null()) {
+    LOG(INFO, true) << "    - Tag Propagation: " << cfg["__tag_propagation__"].string_value() << "\n";
+    node->setTagPropagationPolicy(TagPropagationFromString(cfg["__tag_propagation__"].string_value()));
+  }
+  if (!cfg["__stream_tags__"].is_null()) {
+    LOG(INFO, true) << "    - Stream Tags: " << cfg["__stream_tags__"].dump() << "\n";
+    if (!node->setSourceTags(StreamTagsFromJson(cfg["__stream_tags__"], node->getModuleIndex()))) {
+      LOG(WARNING, true) << ", sys_builder, " << node->getModuleName().c_str() << " is no source, ignoring its __stream_tags__\n";
+    }
+  }
+}
+
+json11::Json sys_builder::parse_cfg_file(const char* cfg_file_name)
 {
   // read json configuration file
   std::ifstream t(cfg_file_name);
@@ -43,6 +115,26 @@ sys_builder::sys_builder(const char* cfg_file_name)
   std::string err;
   const auto json = json11::Json::parse(cfgFileBuff.str(), err);
   CHECK(err.empty()) << "Json::parse failed with errors: " << err;
+  return json;
+}
+
+sys_builder::sys_builder(const char* cfg_file_name)
+  : sys_builder(parse_cfg_file(cfg_file_name))
+{
+}
+
+sys_builder::sys_builder(const json11::Json& json)
+  : fusion_(true),
+    instrumentation_(false),
+    tiling_(false),
+    tileBytes_(0),
+    metricsPeriodMs_(1000),
+    numPakets_(1),
+    tagBatch_(1)
+{
+  // calibrate the clock of the timetags now rather than on the first packet
+  timing::now_ns();
+
 
   // print simulation information details (json __sim_model_info__ field) into logger
   for (auto &k : json["__sim_model_info__"].object_items()) {
@@ -56,6 +148,7 @@ sys_builder::sys_builder(const char* cfg_file_name)
   int pkt_len = 0;
   int nb_pkt = 0;
   std::string data_file_name;
+  json11::Json logPolicy;
 
   // print simulation information details (json __general__ field) into logger
   for (auto &k : json["__general__"].object_items()) {
@@ -66,21 +159,60 @@ sys_builder::sys_builder(const char* cfg_file_name)
     if (k.first == "__num_of_paket__") { 
       LOG(INFO, true) << ", sys_builder, Number of Packets: " << k.second.int_value() <<"\n";
       nb_pkt = k.second.int_value();
+      numPakets_ = std::max(1, nb_pkt);
     }
     if (k.first == "__data_file_name__") {
       LOG(INFO, true) << ", sys_builder, Data File Name: "    << k.second.string_value() <<"\n";
       data_file_name = k.second.string_value();
     }
+    if (k.first == "__fusion__") {
+      LOG(INFO, true) << ", sys_builder, Fusion: "            << k.second.bool_value() <<"\n";
+      fusion_ = k.second.bool_value();
+    }
+    if (k.first == "__instrumentation__") {
+      LOG(INFO, true) << ", sys_builder, Instrumentation: "   << k.second.bool_value() <<"\n";
+      instrumentation_ = k.second.bool_value();
+    }
+    if (k.first == "__trace_file__") {
+      LOG(INFO, true) << ", sys_builder, Trace File Name: "   << k.second.string_value() <<"\n";
+      traceFileName_ = k.second.string_value();
+    }
+    if (k.first == "__metrics_file__") {
+      LOG(INFO, true) << ", sys_builder, Metrics File Name: " << k.second.string_value() <<"\n";
+      metricsFileName_ = k.second.string_value();
+    }
+    if (k.first == "__metrics_period_ms__") {
+      LOG(INFO, true) << ", sys_builder, Metrics Period: "    << k.second.int_value() <<" ms\n";
+      metricsPeriodMs_ = std::max(1, k.second.int_value());
+    }
+    if (k.first == "__tiling__") {
+      LOG(INFO, true) << ", sys_builder, Tiling: "            << k.second.bool_value() <<"\n";
+      tiling_ = k.second.bool_value();
+    }
+    if (k.first == "__tile_bytes__") {
+      LOG(INFO, true) << ", sys_builder, Tile Bytes: "        << k.second.int_value() <<"\n";
+      tileBytes_ = k.second.int_value();
+    }
+    if (k.first == "__tag_batch__") {
+      LOG(INFO, true) << ", sys_builder, Tag Batch: "         << k.second.int_value() <<"\n";
+      tagBatch_ = std::max(1, k.second.int_value());
+    }
+    if (k.first == "__log_policy__") {
+      LOG(INFO, true) << ", sys_builder, Log Policy: "        << k.second.dump() <<"\n";
+      logPolicy = k.second;
+    }
   }
 
   std::vector<std::uint8_t> vec_src;
   if (!is_file_exist(data_file_name.c_str())) {
     vec_src = genrandvec<std::uint8_t>(0, 1, nb_pkt*pkt_len);
 
-    // open the file
-    std::ofstream fout(data_file_name, std::ios::out | std::ios::binary);
-    fout.write(reinterpret_cast<const char*>(&vec_src[0]), vec_src.size()*sizeof(std::uint8_t));
-    fout.close();
+    // keep it for the next runs, unless no data file is configured
+    if (!data_file_name.empty()) {
+      std::ofstream fout(data_file_name, std::ios::out | std::ios::binary);
+      fout.write(reinterpret_cast<const char*>(&vec_src[0]), vec_src.size()*sizeof(std::uint8_t));
+      fout.close();
+    }
   }
   else {
     // open the file
@@ -101,7 +233,7 @@ sys_builder::sys_builder(const char* cfg_file_name)
               std::back_inserter(vec_src));
   }
 
-  pmt::pmt_t pmtVecSrc = pmt::init_genVector<std::uint8_t>(vec_src.size(), vec_src);
+  std::map<std::string, pmt::pmt_t> pmtVecSrc; // by source item type, shared by the sources of that type
 
   // iterate over processors nodes print (json __processors__ field) and insert them into heterogeneous container
   ObjectIDModuleIndexType idx = 0;
@@ -115,6 +247,15 @@ sys_builder::sys_builder(const char* cfg_file_name)
     LOG(INFO, true) << "    - Output Vector Size: " << k.second["__out_vector_size__"].int_value() << "\n";
     LOG(INFO, true) << "    - Trigger Start: " << k.second["__trig_start__"].bool_value() << "\n";
 
+    // the logging policy of the node, or the default one of __general__
+    const json11::Json& nodeLogPolicy = k.second["__log_policy__"].is_null() ? logPolicy : k.second["__log_policy__"];
+    if (!nodeLogPolicy.is_null()) {
+      LOG(INFO, true) << "    - Log Policy: " << nodeLogPolicy.dump() << "\n";
+      log_policy::sptr policy = log_policy::from_json(nodeLogPolicy);
+      if (!policy->is_all())
+        logPolicies_[k.first] = policy;
+    }
+
     std::list<std::tuple<std::string, std::string, std::string>> conList;
     for (auto &l : k.second["__adjacency_connection_to__"].object_items()) {
       conList.emplace_back(std::make_tuple(l.second[0].string_value(), 
@@ -129,15 +270,20 @@ sys_builder::sys_builder(const char* cfg_file_name)
     // create bits source node
     else if (k.second["__proc_type__"].string_value() == "SRC_VEC_PROC")
     {  
-      processor::sptr bitsSrcNode = proc_factory::createSRC(k.second["__out_data_type__"].string_value(), 
+      const std::string& outType = k.second["__out_data_type__"].string_value();
+      if (!pmtVecSrc.count(outType))
+        pmtVecSrc[outType] = make_source_data(outType, vec_src);
+      processor::sptr bitsSrcNode = proc_factory::createSRC(outType, 
                                                             idx, 
                                                             k.first, 
                                                             std::move(conList), 
                                                             k.second["__out_vector_size__"].int_value(), 
                                                             k.second["__trig_start__"].bool_value(), 
-                                                            pmtVecSrc, 
+                                                            pmtVecSrc[outType], 
                                                             k.second["__repeat__"].bool_value(), 
                                                             k.second["__vlen__"].int_value());        
+      configure_tags(bitsSrcNode, k.second, tagBatch_);
+      replicate_proc(bitsSrcNode, k.second, nullptr);
       processors_.push_back(std::move(bitsSrcNode));
     }
     // create adder node
@@ -149,6 +295,16 @@ sys_builder::sys_builder(const char* cfg_file_name)
                                                             std::move(conList), 
                                                             k.second["__out_vector_size__"].int_value(),
                                                             k.second["__trig_start__"].bool_value());
+      configure_tags(adderNode, k.second, tagBatch_);
+      replicate_proc(adderNode, k.second, [&]() {
+        // never connected: the primary node receives and emits the packets
+        return proc_factory::createADDER(k.second["__out_data_type__"].string_value(),
+                                         idx,
+                                         k.first,
+                                         std::list<std::tuple<std::string, std::string, std::string>>(),
+                                         k.second["__out_vector_size__"].int_value(),
+                                         false);
+      });
       processors_.push_back(std::move(adderNode));
     }
     // create vector sink node
@@ -160,8 +316,29 @@ sys_builder::sys_builder(const char* cfg_file_name)
                                                           std::move(conList), 
                                                           k.second["__out_vector_size__"].int_value(), 
                                                           k.second["__trig_start__"].bool_value());
+      configure_tags(sinkNode, k.second, tagBatch_);
+      replicate_proc(sinkNode, k.second, nullptr);
       processors_.push_back(std::move(sinkNode));
     }
+    // create reorder node
+    else if (k.second["__proc_type__"].string_value() == "REORDER_PROC")
+    {
+      LOG(INFO, true) << "    - Reorder Window: " << k.second["__reorder_window__"].int_value() << "\n";
+      processor::sptr reorderNode = proc_factory::createREORDER(k.second["__in_data_type__"].string_value(),
+                                                                idx,
+                                                                k.first,
+                                                                std::move(conList),
+                                                                k.second["__out_vector_size__"].int_value(),
+                                                                k.second["__trig_start__"].bool_value(),
+                                                                static_cast<size_t>(std::max(0, k.second["__reorder_window__"].int_value())));
+      configure_tags(reorderNode, k.second, tagBatch_);
+      if (reorderNode && !k.second["__tag_propagation__"].is_null()) {
+        LOG(WARNING, true) << ", sys_builder, " << k.first.c_str() << " forwards the stream tags of every packet with it, ignoring its __tag_propagation__\n";
+        reorderNode->setTagPropagationPolicy(tag_propagation_policy::DONT);
+      }
+      replicate_proc(reorderNode, k.second, nullptr);
+      processors_.push_back(std::move(reorderNode));
+    }
     // Logger node
     else if (k.second["__proc_type__"].string_value() == "LOGGER")
     {
@@ -174,6 +351,39 @@ sys_builder::sys_builder(const char* cfg_file_name)
 
 }
 
+void sys_builder::replicate_proc(const processor::sptr& node, const json11::Json& cfg, const std::function<processor::sptr()>& createReplica)
+{
+  if (!node || cfg["__replicas__"].is_null())
+    return;
+
+  const int replicas = cfg["__replicas__"].int_value();
+  LOG(INFO, true) << "    - Replicas: " << replicas << "\n";
+  if (replicas < 1)
+    return;
+  if (!createReplica || !node->isStateless()) {
+    LOG(WARNING, true) << ", sys_builder, " << node->getModuleName().c_str() << " is not stateless, ignoring its __replicas__\n";
+    return;
+  }
+
+  replica_dispatch dispatch = replica_dispatch::ROUND_ROBIN;
+  if (!cfg["__replica_dispatch__"].is_null()) {
+    LOG(INFO, true) << "    - Replica Dispatch: " << cfg["__replica_dispatch__"].string_value() << "\n";
+    dispatch = ReplicaDispatchFromString(cfg["__replica_dispatch__"].string_value());
+  }
+  if (!cfg["__replica_window__"].is_null()) {
+    LOG(INFO, true) << "    - Replica Window: " << cfg["__replica_window__"].int_value() << "\n";
+  }
+
+  std::vector<processor::sptr> copies;
+  for (int r = 0; r < replicas; r++)
+    copies.push_back(createReplica());
+  replicaGroups_.push_back(std::make_shared<replica_group>(node,
+                                                           copies,
+                                                           dispatch,
+                                                           node->getTagPropagationPolicy(),
+                                                           static_cast<size_t>(std::max(0, cfg["__replica_window__"].int_value()))));
+}
+
 void sys_builder::print_pipeline()
 {
   print_container(processors_);
@@ -191,17 +401,328 @@ size_t sys_builder::get_pipeline_number_of_proc()
 
 void sys_builder::connect_pipeline_2_logger()
 {
-  connect_2_logger_container(processors_);
+  connect_2_logger_container(processors_, logPolicies_);
 }
 
 void sys_builder::connect_pipeline_proc()
 {
-  connect_processors_container(processors_);
+  connect_processors_container(processors_, edges_);
+  replicate_pipeline_proc();
+  if (fusion_)
+    fuse_pipeline_proc();
+  align_pipeline_proc();
+}
+
+size_t sys_builder::input_lag() const
+{
+  size_t lag = 0;
+  for (auto const& group : replicaGroups_)
+    lag += 2 * group->getWindow();
+  return lag;
+}
+
+void sys_builder::replicate_pipeline_proc()
+{
+  const size_t lag = input_lag();
+  for (auto const& group : replicaGroups_) {
+    group->setPendingWindow(lag);
+    for (proc_edge& in : edges_) {
+      const int port = processor::tagPortIndex(in.portName);
+      if (in.dst != group->getPrimary() || in.sigName != "NewData" || port < 0)
+        continue;
+
+      // The producers now deliver to the group, which dispatches the packets to the replicas
+      in.src->getOnNewDataGen()->disconnect(in.slotId);
+      const uint32_t traceId = in.traceNameId;
+      std::shared_ptr<edge_stats> stats = in.stats;
+      const processor* src = in.src.get(); // owns the slot
+      const processor::tag_port tagPort = static_cast<processor::tag_port>(port);
+      group->addInput(tagPort);
+      in.slotId = in.src->getOnNewDataGen()->connect([group, src, tagPort, traceId, stats](pmt::pmt_t& items) {
+        edge_delivery delivery(*stats, traceId);
+        group->deliver(tagPort, *src, items);
+      });
+    }
+
+    LOG(INFO, true) << ", sys_builder, Replicated " << group->getPrimary()->getModuleName().c_str() << " on " << group->getReplicas()
+                    << " threads, " << ReplicaDispatchToString(group->getDispatch()) << " dispatch, window of " << group->getWindow()
+                    << " packets, " << group->getPendingWindow() << " pending\n";
+  }
+}
+
+void sys_builder::drain_replicas()
+{
+  for (auto const& group : replicaGroups_)
+    group->drain();
+}
+
+void sys_builder::fuse_pipeline_proc()
+{
+  std::set<processor*> replicated;
+  for (auto const& group : replicaGroups_)
+    replicated.insert(group->getPrimary().get());
+
+  std::map<processor*, std::vector<size_t>> newDataOut;
+  std::map<processor*, std::vector<size_t>> procIn;
+  for (size_t e = 0; e < edges_.size(); e++) {
+    if (edges_[e].sigName == "NewData")
+      newDataOut[edges_[e].src.get()].push_back(e);
+    if (edges_[e].portName == "Proc")
+      procIn[edges_[e].dst.get()].push_back(e);
+  }
+
+  auto isLogged = [](const processor::sptr& p) {
+    for (auto const& c : p->getAdjacencyConnection()) {
+      if (std::get<0>(c) == "logger")
+        return true;
+    }
+    return false;
+  };
+
+  // Edge from P to the next stage of its chain. Without tiling the output of P
+  // must only be seen by that stage, as the fused chain never writes it; with
+  // tiling P may be observed by others too, and is then materialized.
+  std::map<processor*, size_t> next;
+  std::set<processor*> hasPrev;
+  std::set<processor*> observed;
+  for (auto const& out : newDataOut) {
+    processor* p = out.first;
+    const bool shared = out.second.size() != 1 || isLogged(edges_[out.second[0]].src);
+    if (shared && !tiling_)
+      continue;
+    for (size_t e : out.second) {
+      const proc_edge& edge = edges_[e];
+      if (edge.portName != "Proc" || edge.src == edge.dst || procIn[edge.dst.get()].size() != 1)
+        continue;
+      if (replicated.count(edge.src.get()) || replicated.count(edge.dst.get()))
+        continue;
+      if (!edge.src->isElementwise() || !edge.dst->isElementwise())
+        continue;
+      if (!edge.src->isInput1Bound() || !edge.dst->isInput1Bound())
+        continue; // In1 not connected, the kernel has nothing to read
+      if (pmt::length(edge.src->getOutputItems()) != pmt::length(edge.dst->getOutputItems()))
+        continue;
+      next[p] = e;
+      hasPrev.insert(edge.dst.get());
+      if (shared)
+        observed.insert(p);
+      break;
+    }
+  }
+
+  std::set<size_t> fusedEdges;
+  for (auto const& n : next) {
+    if (hasPrev.count(n.first))
+      continue;
+
+    std::vector<processor::sptr> stages{edges_[n.second].src};
+    std::vector<bool> materialize{observed.count(n.first) > 0};
+    std::vector<size_t> links;
+    for (auto it = next.find(n.first); it != next.end(); it = next.find(stages.back().get())) {
+      links.push_back(it->second);
+      stages.push_back(edges_[it->second].dst);
+      materialize.push_back(observed.count(stages.back().get()) > 0);
+    }
+
+    fused_chain::sptr chain;
+    try {
+      chain = std::make_shared<fused_chain>(stages, materialize, tileBytes_ ? tileBytes_ : kDefaultTileBytes);
+    } catch (const std::exception& ex) {
+      LOG(WARNING, true) << ", sys_builder, Skip fusion of " << stages.front()->getModuleName().c_str() << ": " << ex.what() << "\n";
+      continue;
+    }
+
+    // Producers of the chain head now run the whole chain ...
+    const std::vector<size_t>& headIn = procIn[stages.front().get()];
+    for (size_t e : headIn) {
+      proc_edge& in = edges_[e];
+      in.src->getOnNewDataGen()->disconnect(in.slotId);
+      const uint32_t traceId = in.traceNameId;
+      std::shared_ptr<edge_stats> stats = in.stats;
+      const processor* src = in.src.get(); // owns the slot
+      in.slotId = in.src->getOnNewDataGen()->connect([chain, src, traceId, stats](pmt::pmt_t& items) {
+        edge_delivery delivery(*stats, traceId);
+        chain->process(*src, items);
+      });
+    }
+    // ... and the links inside the chain are no longer taken.
+    for (size_t e : links) {
+      edges_[e].src->getOnNewDataGen()->disconnect(edges_[e].slotId);
+      fusedEdges.insert(e);
+    }
+
+    if (tileBytes_ == 0 && !headIn.empty()) {
+      try {
+        chain->autoTune(edges_[headIn.front()].src->getOutputItems(), kTileBytesCandidates);
+      } catch (const std::exception& ex) {
+        LOG(WARNING, true) << ", sys_builder, Skip tile size tuning of " << chain->getName().c_str() << ": " << ex.what() << "\n";
+      }
+    }
+
+    LOG(INFO, true) << ", sys_builder, Fused " << chain->getName().c_str() << " with tiles of " << chain->getTileBytes() << " bytes\n";
+    fusedChains_.push_back(std::move(chain));
+  }
+
+  std::vector<proc_edge> edges;
+  for (size_t e = 0; e < edges_.size(); e++) {
+    if (!fusedEdges.count(e))
+      edges.push_back(edges_[e]);
+  }
+  edges_.swap(edges);
+}
+
+void sys_builder::align_pipeline_proc()
+{
+  std::set<processor*> replicated;
+  for (auto const& group : replicaGroups_)
+    replicated.insert(group->getPrimary().get());
+
+  // A fused chain is aligned as one node: the Proc port of its head and the In1 ports of its stages
+  std::map<processor*, fused_chain::sptr> chainOf;
+  for (auto const& chain : fusedChains_) {
+    for (auto const& stage : chain->getStages())
+      chainOf[stage.get()] = chain;
+  }
+
+  std::map<processor*, std::vector<size_t>> procIn;
+  std::map<processor*, std::vector<size_t>> in1;
+  std::vector<processor::sptr> heads;
+  for (size_t e = 0; e < edges_.size(); e++) {
+    const proc_edge& edge = edges_[e];
+    if (edge.sigName != "NewData" || replicated.count(edge.dst.get()))
+      continue;
+    if (edge.portName == "Proc") {
+      if (procIn[edge.dst.get()].empty())
+        heads.push_back(edge.dst);
+      procIn[edge.dst.get()].push_back(e);
+    } else if (edge.portName == "In1") {
+      in1[edge.dst.get()].push_back(e);
+    }
+  }
+
+  const size_t window = std::max(input_aligner::kDefaultWindow, input_lag());
+  for (auto const& head : heads) {
+    auto it = chainOf.find(head.get());
+    const fused_chain::sptr chain = it != chainOf.end() ? it->second : nullptr;
+    const std::vector<processor::sptr> stages = chain ? chain->getStages() : std::vector<processor::sptr>{head};
+    const std::string name = chain ? chain->getName() : head->getModuleName();
+
+    std::vector<size_t> inputs = procIn[head.get()];
+    bool shared = inputs.size() != 1;
+    for (auto const& stage : stages) {
+      const std::vector<size_t>& e = in1[stage.get()];
+      shared = shared || e.size() > 1;
+      inputs.insert(inputs.end(), e.begin(), e.end());
+    }
+    if (inputs.size() < 2)
+      continue;
+    if (shared) {
+      LOG(WARNING, true) << ", sys_builder, Inputs of " << name.c_str() << " not aligned: a port has several producers\n";
+      continue;
+    }
+
+    std::vector<input_aligner::input_port> ports;
+    for (size_t e : inputs)
+      ports.push_back(input_aligner::input_port{edges_[e].dst, edges_[e].portName == "Proc" ? processor::TAG_PORT_PROC : processor::TAG_PORT_IN1});
+    input_aligner::process_fn process;
+    if (chain)
+      process = [chain](pmt::pmt_t& items) { chain->process(items); };
+    else
+      process = [head](pmt::pmt_t& items) { head->runProcess(items); };
+    auto aligner = std::make_shared<input_aligner>(ports, process, window);
+
+    // The producers now deliver to the aligner, which processes the packets once aligned
+    for (size_t k = 0; k < inputs.size(); k++) {
+      proc_edge& in = edges_[inputs[k]];
+      in.src->getOnNewDataGen()->disconnect(in.slotId);
+      const uint32_t traceId = in.traceNameId;
+      std::shared_ptr<edge_stats> stats = in.stats;
+      const processor* src = in.src.get(); // owns the slot
+      const uint32_t port = static_cast<uint32_t>(k);
+      in.slotId = in.src->getOnNewDataGen()->connect([aligner, src, stats, port, traceId](pmt::pmt_t& items) {
+        edge_delivery delivery(*stats, traceId);
+        aligner->deliver(port, *src, items);
+      });
+    }
+
+    LOG(INFO, true) << ", sys_builder, Aligned " << inputs.size() << " inputs of " << name.c_str() << ", window of " << aligner->getWindow() << " packets\n";
+    inputAligners_.push_back(std::move(aligner));
+  }
 }
 
 void sys_builder::run_sim()
 {
-  run_sim_container(processors_);
+  // process-wide switches, set from the configuration of the pipeline which runs
+  proc_stats::set_enabled(instrumentation_);
+  edge_stats::set_enabled(!metricsFileName_.empty());
+
+  if (!traceFileName_.empty())
+    tracer::start();
+
+  if (!metricsFileName_.empty()) {
+    std::vector<edge_metrics_sampler::edge> edges;
+    for (auto const& e : edges_)
+      edges.push_back(edge_metrics_sampler::edge{e.src->getModuleName(), e.sigName, e.dst->getModuleName(), e.portName, e.stats});
+    if (!metricsSampler_.start(edges, metricsFileName_, std::chrono::milliseconds(metricsPeriodMs_))) {
+      LOG(ERROR, true) << ", sys_builder, Can not write edge metrics to " << metricsFileName_ << "\n";
+    }
+  }
+
+  run_sim_container(processors_, numPakets_);
+  drain_replicas();
+  drain_container(processors_);
+  drain_replicas(); // of the packets the drained nodes emitted to replicated ones
+  for (auto const& aligner : inputAligners_)
+    aligner->flush();
+  flush_tags_container(processors_);
+  check_seq_container(processors_);
+
+  for (auto const& group : replicaGroups_) {
+    std::stringstream os;
+    for (size_t r = 0; r < group->getReplicas(); r++)
+      os << (r ? "/" : "") << group->getPakets(r);
+    os << " packets, " << group->getDropped() << " dropped missing an input, merge: ";
+    group->getMergeStats().print(os);
+    LOG(INFO, true) << ", sys_builder, Replicas of " << group->getPrimary()->getModuleName().c_str() << ": " << os.str() << "\n";
+  }
+
+  for (auto const& aligner : inputAligners_) {
+    const processor::sptr& node = aligner->getPorts().front().node_;
+    if (aligner->getDropped() != 0 || aligner->getLate() != 0)
+      LOG(WARNING, true) << ", sys_builder, Inputs of " << node->getModuleName().c_str() << ": " << aligner->getPakets() << " packets, "
+                         << aligner->getDropped() << " dropped missing an input, " << aligner->getLate() << " inputs late\n";
+  }
+
+  metricsSampler_.stop();
+  proc_stats::set_enabled(false);
+  edge_stats::set_enabled(false);
+
+  if (!traceFileName_.empty()) {
+    tracer::stop();
+    if (tracer::write(traceFileName_)) {
+      LOG(INFO, true) << ", sys_builder, Execution trace written to " << traceFileName_ << "\n";
+    } else {
+      LOG(ERROR, true) << ", sys_builder, Can not write execution trace to " << traceFileName_ << "\n";
+    }
+  }
+
+  if (instrumentation_)
+    print_proc_stats();
+
+  for (auto const& p : logPolicies_)
+    p.second->finish();
+}
+
+const proc_stats* sys_builder::get_proc_stats(const std::string& name)
+{
+  processor::sptr found;
+  processors_.visit_element(het_container_find_processor{name, found});
+  return found ? &found->getStats() : nullptr;
+}
+
+void sys_builder::print_proc_stats()
+{
+  print_stats_container(processors_);
 }
 
 } // namespace pl_proc
@@ -15,8 +15,17 @@
 #include "logging.h"
 #include "het_container.h"
 #include "processor_factory.h"
+#include "fused_chain.h"
+#include "replica_group.h"
+#include "input_aligner.h"
+#include "log_policy.h"
+#include "edge_metrics.h"
+#include "json11.h"
 
+#include <functional>
 #include <iosfwd>
+#include <map>
+#include <sstream>
 #include <vector>
 #include <iostream>
 
@@ -33,20 +42,69 @@ struct het_container_print_processor : het_container_visitor_base<processor::spt
 
 struct het_container_connect_2_logger : het_container_visitor_base<processor::sptr>
 {
+  const std::map<std::string, log_policy::sptr>& policies_;
+
+  explicit het_container_connect_2_logger(const std::map<std::string, log_policy::sptr>& policies) : policies_(policies) {}
+
   template<class T>
   void operator()(T& _in)
   {
     for (auto const& i : _in->getAdjacencyConnection()) {
       if(std::get<0>(i) == "logger"){
-        _in->getOnNewTag()->connect(&PL_Log::LogTag);
-        LOG(INFO, true) << ", het_container_connect_2_logger, Connect " << _in->getModuleName().c_str() << " to logger\n";
+        auto policy = policies_.find(_in->getModuleName());
+        if (policy != policies_.end()) {
+          log_policy::sptr p = policy->second;
+          _in->getOnNewTags()->connect([p](const tag_span& tags) { p->log(tags); });
+          LOG(INFO, true) << ", het_container_connect_2_logger, Connect " << _in->getModuleName().c_str() << " to logger with log policy\n";
+        } else {
+          _in->getOnNewTags()->connect(&PL_Log::LogTags);
+          LOG(INFO, true) << ", het_container_connect_2_logger, Connect " << _in->getModuleName().c_str() << " to logger\n";
+        }
       }
     }
   }
 };
 
+/*!
+ * \brief Connection made by het_container_connect_processors from signal \p sigName
+ *        of \p src to port \p portName of \p dst, with the id of the connected slot,
+ *        the name of the connection in the execution trace and its counters.
+ */
+struct proc_edge
+{
+  processor::sptr src;
+  std::string sigName;
+  processor::sptr dst;
+  std::string portName;
+  int slotId;
+  uint32_t traceNameId;
+  std::shared_ptr<edge_stats> stats;
+};
+
 struct het_container_connect_processors : het_container_visitor_base<processor::sptr>
 {
+  std::vector<proc_edge>& edges_;
+
+  explicit het_container_connect_processors(std::vector<proc_edge>& edges) : edges_(edges) {}
+
+  /*!
+   * \brief Check the type of the data delivered from \p src to \p dst once, at connect
+   *        time, so that \p dst can access its input without runtime type tests.
+   */
+  template<class T>
+  static void bind_typed_input(const T& src, const T& dst, const std::string& port)
+  {
+    if (dst->bindInput(port, src->getOutputItems())) {
+      LOG(INFO, true) << ", het_container_connect_processors, Bind typed input " << port << " of " << dst->getModuleName().c_str() << " to output of " << src->getModuleName().c_str() << "\n";
+    }
+  }
+
+  template<class T>
+  static uint32_t edge_trace_name(const T& src, const std::string& sigName, const T& dst, const std::string& port)
+  {
+    return tracer::name_id(src->getModuleName() + "." + sigName + " -> " + dst->getModuleName() + "." + port);
+  }
+
   template<class T>
   void operator()(std::vector<T>& _in)
   {
@@ -60,13 +118,41 @@ struct het_container_connect_processors : het_container_visitor_base<processor::
           for (auto const& k : _in) {
             if(procName == k->getModuleName() && i->getModuleName() != k->getModuleName()) {
               if (sigName == "NewData" && funName == "Proc") {
-                i->getOnNewDataGen()->template connect_member<processor>(k, &processor::process);
+                bind_typed_input(i, k, funName);
+                const uint32_t traceId = edge_trace_name(i, sigName, k, funName);
+                auto stats = std::make_shared<edge_stats>();
+                processor::sptr dst = k;
+                const processor* src = i.get(); // owns the slot
+                int id = i->getOnNewDataGen()->connect([src, dst, traceId, stats](pmt::pmt_t& items) {
+                  edge_delivery delivery(*stats, traceId);
+                  dst->receiveTags(processor::TAG_PORT_PROC, *src);
+                  dst->runProcess(items);
+                });
+                edges_.push_back(proc_edge{i, sigName, k, funName, id, traceId, stats});
                 LOG(INFO, true) << ", het_container_connect_processors, Connect NewData on " << i->getModuleName().c_str() << " port to " << k->getModuleName().c_str() << " on Process port\n";
               } else if (sigName == "NewData" && funName == "In1") {
-                i->getOnNewDataGen()->template connect_member<processor>(k, &processor::setInput1);
+                bind_typed_input(i, k, funName);
+                const uint32_t traceId = edge_trace_name(i, sigName, k, funName);
+                auto stats = std::make_shared<edge_stats>();
+                processor::sptr dst = k;
+                const processor* src = i.get(); // owns the slot
+                int id = i->getOnNewDataGen()->connect([src, dst, traceId, stats](pmt::pmt_t& items) {
+                  edge_delivery delivery(*stats, traceId);
+                  dst->receiveTags(processor::TAG_PORT_IN1, *src);
+                  dst->setInput1(items);
+                  dst->emitFirstInput();
+                });
+                edges_.push_back(proc_edge{i, sigName, k, funName, id, traceId, stats});
                 LOG(INFO, true) << ", het_container_connect_processors, Connect NewData on " << i->getModuleName().c_str() << " port to " << k->getModuleName().c_str() << " on Input1 port\n";
               } else if (sigName == "SetIn1" && funName == "Strt") {
-                i->getFirstInputSet()->template connect_member<processor>(k, &processor::start);
+                const uint32_t traceId = edge_trace_name(i, sigName, k, funName);
+                auto stats = std::make_shared<edge_stats>();
+                processor::sptr dst = k;
+                int id = i->getFirstInputSet()->connect([dst, traceId, stats]() {
+                  edge_delivery delivery(*stats, traceId);
+                  dst->runStart();
+                });
+                edges_.push_back(proc_edge{i, sigName, k, funName, id, traceId, stats});
                 LOG(INFO, true) << ", het_container_connect_processors, Connect FirstInputSet on " << i->getModuleName().c_str() << " port to " << k->getModuleName().c_str() << " on Start port\n";
               } else {
                 LOG(FATAL, true) << ", het_container_connect_processors, Undefined Connection from " << i->getModuleName().c_str() << " to " << k->getModuleName().c_str() << "\n";
@@ -87,31 +173,121 @@ struct het_container_run_sim : het_container_visitor_base<processor::sptr>
     for (auto const& i : _in) {
       if(i->getTrigStart()) {
         LOG(INFO, true) << ", het_container_run_sim, " << i->getModuleName().c_str() << "\n";
-        i->start();
+        i->runStart();
       }
     }    
   }
 };
 
+struct het_container_drain : het_container_visitor_base<processor::sptr>
+{
+  template<class T>
+  void operator()(T& _in)
+  {
+    _in->drain();
+  }
+};
+
+struct het_container_flush_tags : het_container_visitor_base<processor::sptr>
+{
+  template<class T>
+  void operator()(T& _in)
+  {
+    _in->flushTags();
+  }
+};
+
+struct het_container_print_stats : het_container_visitor_base<processor::sptr>
+{
+  template<class T>
+  void operator()(T& _in)
+  {
+    std::stringstream os;
+    _in->getStats().print(os, _in->getModuleName());
+    std::string line;
+    while (std::getline(os, line))
+      LOG(INFO, true) << ", het_container_print_stats, " << line << "\n";
+  }
+};
+
+struct het_container_check_seq : het_container_visitor_base<processor::sptr>
+{
+  template<class T>
+  void operator()(T& _in)
+  {
+    static const char* const portNames[processor::NUM_TAG_PORTS] = {"Proc", "In1"};
+    for (int port = 0; port < processor::NUM_TAG_PORTS; port++) {
+      const seq_tracker& seq = _in->getInputSeq(static_cast<processor::tag_port>(port));
+      if (seq.in_order())
+        continue;
+      std::stringstream os;
+      seq.print(os);
+      LOG(WARNING, true) << ", het_container_check_seq, Out of sequence packets on " << _in->getModuleName().c_str() << "." << portNames[port] << ": " << os.str() << "\n";
+    }
+    if (const reorder_stats* reorder = _in->getReorderStats()) {
+      std::stringstream os;
+      reorder->print(os);
+      LOG(INFO, true) << ", het_container_check_seq, Reorder " << _in->getModuleName().c_str() << ": " << os.str() << "\n";
+    }
+    if (_in->getMisalignedPakets() != 0)
+      LOG(WARNING, true) << ", het_container_check_seq, " << _in->getMisalignedPakets() << " packets of " << _in->getModuleName().c_str() << " merged inputs of different sequence numbers\n";
+  }
+};
+
+struct het_container_find_processor : het_container_visitor_base<processor::sptr>
+{
+  const std::string& name_;
+  processor::sptr& found_;
+
+  het_container_find_processor(const std::string& name, processor::sptr& found) : name_(name), found_(found) {}
+
+  template<class T>
+  void operator()(T& _in)
+  {
+    if (_in->getModuleName() == name_)
+      found_ = _in;
+  }
+};
+
 /*!
  * \brief Visitor pattern lambda function to print existing processor nodes in heterogeneous container.
  */
-auto print_container = [](heterogeneous_container& _in){_in.visit_element(het_container_print_processor{}); std::cout << std::endl;};
+inline auto print_container = [](heterogeneous_container& _in){_in.visit_element(het_container_print_processor{}); std::cout << std::endl;};
 
 /*!
  * \brief Visitor pattern lambda function to connect existing processor nodes in heterogeneous container to logger.
  */
-auto connect_2_logger_container = [](heterogeneous_container& _in){_in.visit_element(het_container_connect_2_logger{}); std::cout << std::endl;};
+inline auto connect_2_logger_container = [](heterogeneous_container& _in, const std::map<std::string, log_policy::sptr>& _policies){_in.visit_element(het_container_connect_2_logger{_policies}); std::cout << std::endl;};
 
 /*!
  * \brief Visitor pattern lambda function to connect existing processor nodes in heterogeneous container together.
  */
-auto connect_processors_container = [](heterogeneous_container& _in){_in.visit_elements(het_container_connect_processors{}); std::cout << std::endl;};
+inline auto connect_processors_container = [](heterogeneous_container& _in, std::vector<proc_edge>& _edges){_in.visit_elements(het_container_connect_processors{_edges}); std::cout << std::endl;};
+
+/*!
+ * \brief Visitor pattern lambda function to emit the packets the processor nodes in heterogeneous container still hold at the end of a run.
+ */
+inline auto drain_container = [](heterogeneous_container& _in){_in.visit_element(het_container_drain{});};
+
+/*!
+ * \brief Visitor pattern lambda function to emit the TAGs the processor nodes in heterogeneous container still gather in batches.
+ */
+inline auto flush_tags_container = [](heterogeneous_container& _in){_in.visit_element(het_container_flush_tags{});};
+
+/*!
+ * \brief Visitor pattern lambda function to print the instrumentation of the processor nodes in heterogeneous container.
+ */
+inline auto print_stats_container = [](heterogeneous_container& _in){_in.visit_element(het_container_print_stats{});};
+
+/*!
+ * \brief Visitor pattern lambda function to report the gaps, reorderings and misaligned merges of the packet sequence numbers, and the reorder buffers, in heterogeneous container.
+ */
+inline auto check_seq_container = [](heterogeneous_container& _in){_in.visit_element(het_container_check_seq{});};
 
 /*!
  * \brief Visitor pattern lambda function to find the starting processor node in heterogeneous container and start it.
  */
-auto run_sim_container = [](heterogeneous_container& _in){_in.visit_elements(het_container_run_sim{}); std::cout << std::endl;};
+inline auto run_sim_container = [](heterogeneous_container& _in, int _pakets){for (int p = 0; p < _pakets; p++) _in.visit_elements(het_container_run_sim{}); std::cout << std::endl;};
 
 /*!
  * \brief System builder class to construct the simulation pipeline out of JSON configuration file.
@@ -120,6 +296,65 @@ class sys_builder : noncopyable
 {
 private:
   heterogeneous_container processors_;
+  std::vector<proc_edge> edges_;
+  std::vector<fused_chain::sptr> fusedChains_;
+  std::vector<replica_group::sptr> replicaGroups_;
+  std::vector<input_aligner::sptr> inputAligners_;
+  std::map<std::string, log_policy::sptr> logPolicies_; //< by module name, only the ones not logging ALL
+  bool fusion_;
+  bool instrumentation_;
+  bool tiling_;
+  size_t tileBytes_;
+  std::string traceFileName_; //< __trace_file__, empty if the execution is not traced
+  std::string metricsFileName_; //< __metrics_file__, empty if the edges are not sampled
+  int metricsPeriodMs_;
+  edge_metrics_sampler metricsSampler_;
+  int numPakets_; //< __num_of_paket__, the number of times run_sim starts the trigger nodes
+  int tagBatch_;  //< __tag_batch__, the default number of TAGs a processor node emits per batch
+
+  static json11::Json parse_cfg_file(const char* cfg_file_name);
+
+  /*!
+   * \brief Run the processor node \p node by "__replicas__" replicas of it, made by
+   *        \p createReplica, dispatched by "__replica_dispatch__" (ROUND_ROBIN or
+   *        LEAST_LOADED) with at most "__replica_window__" packets in flight.
+   *        Only stateless nodes can be replicated; \p createReplica is empty for the
+   *        node types which can not.
+   */
+  void replicate_proc(const processor::sptr& node, const json11::Json& cfg, const std::function<processor::sptr()>& createReplica);
+
+  /*!
+   * \brief Connect the inputs of the replicated processor nodes to their replica group.
+   */
+  void replicate_pipeline_proc();
+
+  /*!
+   * \brief Wait for the packets the replica groups still process and emit them.
+   */
+  void drain_replicas();
+
+  /*!
+   * \brief Packets an input of a merge point may lag behind the others: the ones the
+   *        replica groups upstream hold, pending or in flight.
+   */
+  size_t input_lag() const;
+
+  /*!
+   * \brief Deliver the inputs of every processor node, or fused chain, with several
+   *        connected input ports to an input_aligner, which processes a packet once
+   *        all its inputs of the same sequence number arrived. Replicated nodes align
+   *        their inputs themselves.
+   */
+  void align_pipeline_proc();
+
+  /*!
+   * \brief Graph optimization pass: run every chain of elementwise processor nodes,
+   *        each one only feeding the Proc port of the next, as a single fused_chain.
+   *        With __tiling__ the chains may also go through nodes observed by the logger
+   *        or other consumers. The tile size is __tile_bytes__, or auto-tuned if unset.
+   *        Replicated nodes are not fused.
+   */
+  void fuse_pipeline_proc();
 
 public:
 
@@ -131,6 +366,15 @@ public:
    */
   sys_builder(const char* cfg_file_name);
 
+  /*!
+   * \brief Constructor to create a simulation pipeline out of a parsed JSON configuration,
+   *        e.g. generated by a benchmark.
+   *
+   * \param json        configuration, with the layout of the configuration file
+   *
+   */
+  sys_builder(const json11::Json& json);
+
   virtual ~sys_builder() { processors_.clear(); }
 
   /*!
@@ -155,25 +399,67 @@ public:
   size_t get_pipeline_number_of_proc();
 
   /*!
-   * \brief connect processors in pipeline to logger.
+   * \brief connect processors in pipeline to logger, through their __log_policy__ if any.
    *
    * \param none
    */
   void connect_pipeline_2_logger();
 
   /*!
-   * \brief connect processors in pipeline together.
+   * \brief connect processors in pipeline together, the replicated ones through their
+   *        replica group, then fuse the chains of elementwise processors unless
+   *        __fusion__ is disabled, and align the inputs of the merge points.
    *
    * \param none
    */
   void connect_pipeline_proc();
 
   /*!
-   * \brief run simulation.
+   * \brief get the fused chains of processors built by connect_pipeline_proc.
+   *
+   * \param none
+   */
+  const std::vector<fused_chain::sptr>& get_fused_chains() const { return fusedChains_; }
+
+  /*!
+   * \brief get the replica groups of the processors configured with __replicas__.
+   *
+   * \param none
+   */
+  const std::vector<replica_group::sptr>& get_replica_groups() const { return replicaGroups_; }
+
+  /*!
+   * \brief get the input aligners of the processors, or fused chains, with several inputs.
+   *
+   * \param none
+   */
+  const std::vector<input_aligner::sptr>& get_input_aligners() const { return inputAligners_; }
+
+  /*!
+   * \brief run simulation, starting the trigger nodes __num_of_paket__ times, then emit the TAG batches still gathered
+   *        and write the tags retained by the log policies,
+   *        with __instrumentation__ the statistics of the processors to the log
+   *        and with __trace_file__ the execution trace. With __metrics_file__ the
+   *        counters of the connections are sampled to that file while running.
    *
    * \param none
    */
   void run_sim();
+
+  /*!
+   * \brief get the instrumentation of the processor \p name, or nullptr if there is none.
+   *        Can be called while the simulation runs.
+   *
+   * \param name        processor module name
+   */
+  const proc_stats* get_proc_stats(const std::string& name);
+
+  /*!
+   * \brief print the instrumentation of all processors in pipeline to the log.
+   *
+   * \param none
+   */
+  void print_proc_stats();
 };
 
 } // namespace pl_proc
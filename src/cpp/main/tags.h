@@ -18,6 +18,9 @@
 #include "pmt.h"
 #include "id.h"
 
+#include <cstddef>
+#include <cstdint>
+
 
 namespace pl_proc {
 
@@ -25,9 +28,12 @@ namespace pl_proc {
  * \brief Implementation of TAG generator
  */
 struct tag_t {
-  //! the item \p tag occurred at (as a uint64_t)
+  //! the time \p tag occurred at, in ns of the monotonic clock of timing::now_ns()
   int64_t timetag_;
 
+  //! the absolute index, in the output stream of its module, of the first item of \p tag
+  uint64_t offset_;
+
   //! the key of \p tag (as a PMT symbol)
   ObjectID key_;
 
@@ -51,11 +57,13 @@ struct tag_t {
            (t.key_.GetModuleType() == key_.GetModuleType()) &&
            (t.key_.GetModuleIndex() == key_.GetModuleIndex()) &&
            (t.key_.GetPaketIndex() == key_.GetPaketIndex()) &&
-           (t.timetag_ == timetag_);
+           (t.timetag_ == timetag_) &&
+           (t.offset_ == offset_);
   }
 
-  tag_t(int64_t timetag, ObjectID key, pmt::DataType valueDataType, pmt::pmt_t value)
+  tag_t(int64_t timetag, ObjectID key, pmt::DataType valueDataType, pmt::pmt_t value, uint64_t offset = 0)
         : timetag_(timetag),
+          offset_(offset),
           key_(key),
           valueDataType_(valueDataType),
           value_(value)
@@ -63,7 +71,7 @@ struct tag_t {
   }
 
   tag_t(const tag_t& rhs)
-        : timetag_(rhs.timetag_), key_(rhs.key_), valueDataType_(rhs.valueDataType_), value_(rhs.value_)
+        : timetag_(rhs.timetag_), offset_(rhs.offset_), key_(rhs.key_), valueDataType_(rhs.valueDataType_), value_(rhs.value_)
   {
   }
 
@@ -71,6 +79,7 @@ struct tag_t {
   {
     if (this != &rhs) {
       timetag_ = rhs.timetag_;
+      offset_ = rhs.offset_;
       key_ = rhs.key_;
       valueDataType_ = rhs.valueDataType_;
       value_ = rhs.value_;
@@ -81,6 +90,20 @@ struct tag_t {
   ~tag_t() {}
 };
 
+/*!
+ * \brief Contiguous batch of TAGs, delivered by a single signal emission
+ */
+struct tag_span {
+  tag_t* data_;
+  size_t size_;
+
+  tag_t* begin() const { return data_; }
+  tag_t* end() const { return data_ + size_; }
+  size_t size() const { return size_; }
+  bool empty() const { return size_ == 0; }
+  tag_t& operator[](size_t k) const { return data_[k]; }
+};
+
 } // namespace pl_proc
 
 #endif /*TAGS_H*/
@@ -0,0 +1,78 @@
+/**
+ * @file   timing.cpp
+ *
+ * @author Armin Zare Zadeh ali.a.zarezadeh@gmail.com
+ *         Eric J. Mayo eric@pozicom.net
+ *
+ * @brief   timing.cpp includes the high resolution monotonic clock of the TAG timetags
+ */
+
+#include "timing.h"
+
+#include <chrono>
+
+#if PL_TIMING_HAS_TSC
+#include <cpuid.h>
+#endif
+
+
+namespace pl_proc {
+
+int64_t timing::monotonic_ns()
+{
+  // CLOCK_MONOTONIC on Linux, QueryPerformanceCounter on Windows
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+    std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+double timing::tsc_hz()
+{
+  const calibration& c = get_calibration();
+  return c.tsc_ ? 1e9 * (uint64_t(1) << kShift) / c.nsPerTick_ : 0.0;
+}
+
+timing::calibration timing::calibrate()
+{
+  calibration c{false, 0, 0, 0};
+#if PL_TIMING_HAS_TSC
+  // CPUID.80000007H:EDX[8] is the invariant TSC flag
+  unsigned int eax, ebx, ecx, edx;
+  if (!__get_cpuid(0x80000007, &eax, &ebx, &ecx, &edx) || !(edx & (1u << 8)))
+    return c;
+
+  // Pair TSC and monotonic_ns() reads, keeping the pair of the fastest
+  // monotonic_ns() to bound the error of each reading.
+  auto sample = [](uint64_t& ticks, int64_t& ns) {
+    uint64_t best = ~uint64_t(0);
+    for (int k = 0; k < 5; k++) {
+      const uint64_t t0 = __rdtsc();
+      const int64_t n = monotonic_ns();
+      const uint64_t t1 = __rdtsc();
+      if (t1 - t0 < best) {
+        best = t1 - t0;
+        ticks = t0 + (t1 - t0) / 2;
+        ns = n;
+      }
+    }
+  };
+
+  uint64_t ticks0 = 0, ticks1 = 0;
+  int64_t ns0 = 0, ns1 = 0;
+  sample(ticks0, ns0);
+  const int64_t until = ns0 + 20 * 1000000; // 20 ms, ~1 ppm with ~20 ns reads
+  do {
+    sample(ticks1, ns1);
+  } while (ns1 < until);
+
+  if (ticks1 <= ticks0)
+    return c;
+
+  c.tsc_ = true;
+  c.baseTicks_ = ticks1;
+  c.baseNs_ = ns1;
+  c.nsPerTick_ = static_cast<uint64_t>((static_cast<unsigned __int128>(ns1 - ns0) << kShift) / (ticks1 - ticks0));
+#endif
+  return c;
+}
+
+} // namespace pl_proc
@@ -0,0 +1,91 @@
+/**
+ * @file   timing.h
+ *
+ * @author Armin Zare Zadeh ali.a.zarezadeh@gmail.com
+ *         Eric J. Mayo eric@pozicom.net
+ *
+ * @brief   timing.h includes the high resolution monotonic clock of the TAG timetags
+ */
+
+#ifndef TIMING_H
+#define TIMING_H
+
+#include <cstdint>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define PL_TIMING_HAS_TSC 1
+#else
+#define PL_TIMING_HAS_TSC 0
+#endif
+
+
+namespace pl_proc {
+
+/*!
+ * \brief Monotonic nanosecond clock for timetags and latency measurements.
+ *
+ * \details
+ * On x86 CPUs with an invariant TSC (constant rate, not stopped in deep sleep
+ * states) the clock reads the TSC and scales it to nanoseconds, which costs a
+ * few ns instead of the ~20 ns of a clock_gettime call. The scale is calibrated
+ * once, on first use, against std::chrono::steady_clock (CLOCK_MONOTONIC on
+ * Linux), and the clock is aligned with it: timing::now_ns() and steady_clock
+ * can be mixed. Elsewhere it reads steady_clock.
+ */
+class timing
+{
+public:
+  /*!
+   * \brief Nanoseconds on the std::chrono::steady_clock time base.
+   */
+  static int64_t now_ns()
+  {
+#if PL_TIMING_HAS_TSC
+    const calibration& c = get_calibration();
+    if (c.tsc_) {
+      const uint64_t ticks = __rdtsc() - c.baseTicks_;
+      return c.baseNs_ + static_cast<int64_t>((static_cast<unsigned __int128>(ticks) * c.nsPerTick_) >> kShift);
+    }
+#endif
+    return monotonic_ns();
+  }
+
+  /*!
+   * \brief Nanoseconds of std::chrono::steady_clock, read through the OS.
+   */
+  static int64_t monotonic_ns();
+
+  /*!
+   * \brief True if now_ns() reads the TSC.
+   */
+  static bool uses_tsc() { return get_calibration().tsc_; }
+
+  /*!
+   * \brief Calibrated TSC frequency in Hz, 0 if the TSC is not used.
+   */
+  static double tsc_hz();
+
+private:
+  static constexpr unsigned kShift = 32; //< fixed point fraction bits of nsPerTick_
+
+  struct calibration
+  {
+    bool tsc_;
+    uint64_t baseTicks_;
+    int64_t baseNs_;
+    uint64_t nsPerTick_; //< ns per TSC tick << kShift
+  };
+
+  static calibration calibrate();
+
+  static const calibration& get_calibration()
+  {
+    static const calibration c = calibrate();
+    return c;
+  }
+};
+
+} // namespace pl_proc
+
+#endif /* TIMING_H */
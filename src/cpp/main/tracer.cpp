@@ -0,0 +1,188 @@
+/**
+ * @file   tracer.cpp
+ *
+ * @author Armin Zare Zadeh ali.a.zarezadeh@gmail.com
+ *         Eric J. Mayo eric@pozicom.net
+ *
+ * @brief   tracer.cpp includes the execution timeline tracer of the pipeline (Chrome Trace Event format)
+ */
+
+#include "tracer.h"
+
+#include <algorithm>
+#include <chrono>
+#include <deque>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+
+namespace pl_proc {
+
+std::atomic<bool> tracer::enabled_(false);
+
+namespace {
+
+struct trace_event
+{
+  uint64_t ts_;     //< ns since the start of the trace
+  uint32_t nameId_;
+  trace_category cat_;
+  char ph_;         //< Chrome Trace Event phase: 'B', 'E' or 'i'
+};
+
+struct trace_buffer
+{
+  uint32_t tid_;
+  std::vector<trace_event> events_;
+  uint64_t dropped_;
+};
+
+struct trace_state
+{
+  std::mutex mutex_; //< guards everything but the events of the buffers
+  std::deque<std::string> names_;
+  std::unordered_map<std::string, uint32_t> ids_;
+  std::vector<std::unique_ptr<trace_buffer>> buffers_;
+  std::chrono::steady_clock::time_point epoch_ = std::chrono::steady_clock::now();
+  size_t maxEvents_ = size_t(1) << 20;
+  std::atomic<uint64_t> generation_{0}; //< bumped by clear() to drop the thread buffers
+};
+
+trace_state& state()
+{
+  static trace_state s;
+  return s;
+}
+
+thread_local trace_buffer* t_buffer = nullptr;
+thread_local uint64_t t_generation = 0;
+
+trace_buffer* thread_buffer()
+{
+  trace_state& s = state();
+  if (t_buffer == nullptr || t_generation != s.generation_.load(std::memory_order_relaxed)) {
+    std::lock_guard<std::mutex> lock(s.mutex_);
+    s.buffers_.emplace_back(new trace_buffer{static_cast<uint32_t>(s.buffers_.size() + 1), {}, 0});
+    t_buffer = s.buffers_.back().get();
+    t_buffer->events_.reserve(std::min<size_t>(s.maxEvents_, 4096));
+    t_generation = s.generation_.load(std::memory_order_relaxed);
+  }
+  return t_buffer;
+}
+
+inline void record(uint32_t nameId, trace_category cat, char ph)
+{
+  trace_state& s = state();
+  const uint64_t ts = std::chrono::duration_cast<std::chrono::nanoseconds>(
+      std::chrono::steady_clock::now() - s.epoch_).count();
+  trace_buffer* b = thread_buffer();
+  if (b->events_.size() >= s.maxEvents_) {
+    b->dropped_++;
+    return;
+  }
+  b->events_.push_back(trace_event{ts, nameId, cat, ph});
+}
+
+const char* category_name(trace_category cat)
+{
+  switch (cat)
+  {
+  case trace_category::PROCESS: return "process";
+  case trace_category::START:   return "start";
+  case trace_category::CHAIN:   return "chain";
+  case trace_category::EDGE:    return "edge";
+  default:                      return "unknown";
+  }
+}
+
+void write_json_string(std::ostream& os, const std::string& str)
+{
+  os << '"';
+  for (char c : str) {
+    if (c == '"' || c == '\\') os << '\\' << c;
+    else if (static_cast<unsigned char>(c) < 0x20) os << ' ';
+    else os << c;
+  }
+  os << '"';
+}
+
+} // namespace
+
+void tracer::start(size_t maxEventsPerThread)
+{
+  trace_state& s = state();
+  {
+    std::lock_guard<std::mutex> lock(s.mutex_);
+    s.maxEvents_ = maxEventsPerThread;
+  }
+  enabled_.store(true, std::memory_order_relaxed);
+}
+
+void tracer::stop()
+{
+  enabled_.store(false, std::memory_order_relaxed);
+}
+
+uint32_t tracer::name_id(const std::string& name)
+{
+  trace_state& s = state();
+  std::lock_guard<std::mutex> lock(s.mutex_);
+  auto it = s.ids_.find(name);
+  if (it != s.ids_.end())
+    return it->second;
+
+  const uint32_t id = static_cast<uint32_t>(s.names_.size());
+  s.names_.push_back(name);
+  s.ids_.emplace(name, id);
+  return id;
+}
+
+void tracer::begin(uint32_t nameId, trace_category cat) { record(nameId, cat, 'B'); }
+void tracer::end(uint32_t nameId, trace_category cat) { record(nameId, cat, 'E'); }
+void tracer::instant(uint32_t nameId, trace_category cat) { record(nameId, cat, 'i'); }
+
+bool tracer::write(const std::string& file_name)
+{
+  std::ofstream os(file_name.c_str(), std::ios::out | std::ios::trunc);
+  if (!os)
+    return false;
+
+  trace_state& s = state();
+  std::lock_guard<std::mutex> lock(s.mutex_);
+
+  os << "{\"displayTimeUnit\": \"ns\", \"traceEvents\": [\n";
+  bool first = true;
+  for (auto const& b : s.buffers_) {
+    os << (first ? "" : ",\n") << "{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": " << b->tid_ <<
+          ", \"args\": {\"name\": \"thread " << b->tid_ << "\", \"dropped_events\": " << b->dropped_ << "}}";
+    first = false;
+
+    for (auto const& e : b->events_) {
+      os << ",\n{\"name\": ";
+      write_json_string(os, s.names_[e.nameId_]);
+      // ts is in microseconds, keep the ns as decimals
+      os << ", \"cat\": \"" << category_name(e.cat_) << "\", \"ph\": \"" << e.ph_ <<
+            "\", \"ts\": " << e.ts_ / 1000 << "." << (e.ts_ % 1000) / 100 << (e.ts_ % 100) / 10 << e.ts_ % 10 <<
+            ", \"pid\": 1, \"tid\": " << b->tid_;
+      if (e.ph_ == 'i')
+        os << ", \"s\": \"t\"";
+      os << "}";
+    }
+  }
+  os << "\n]}\n";
+  return static_cast<bool>(os);
+}
+
+void tracer::clear()
+{
+  trace_state& s = state();
+  std::lock_guard<std::mutex> lock(s.mutex_);
+  s.buffers_.clear();
+  s.generation_++;
+  s.epoch_ = std::chrono::steady_clock::now();
+}
+
+} // namespace pl_proc
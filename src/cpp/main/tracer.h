@@ -0,0 +1,105 @@
+/**
+ * @file   tracer.h
+ *
+ * @author Armin Zare Zadeh ali.a.zarezadeh@gmail.com
+ *         Eric J. Mayo eric@pozicom.net
+ *
+ * @brief   tracer.h includes the execution timeline tracer of the pipeline (Chrome Trace Event format)
+ */
+
+#ifndef TRACER_H
+#define TRACER_H
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+
+namespace pl_proc {
+
+enum class trace_category : uint8_t {
+  PROCESS = 0, //< processor::process() call
+  START   = 1, //< processor::start() call
+  CHAIN   = 2, //< fused_chain::process() call
+  EDGE    = 3  //< data delivered over a pipeline connection
+};
+
+/*!
+ * \brief Tracer of the pipeline execution, written as a Chrome Trace Event JSON
+ *        file which can be opened with chrome://tracing or https://ui.perfetto.dev.
+ *
+ * \details
+ * Every thread appends its events to its own buffer, without any lock or atomic
+ * read-modify-write; the buffers are only registered (under a mutex) on the first
+ * event of a thread.  Names are interned once, at connect time, so an event is a
+ * few words.  Each buffer holds at most the number of events given to start();
+ * later events are dropped and counted.  write() must be called when the pipeline
+ * is idle.
+ */
+class tracer
+{
+private:
+  static std::atomic<bool> enabled_;
+
+public:
+  static bool enabled() { return enabled_.load(std::memory_order_relaxed); }
+
+  /*!
+   * \brief Start tracing, keeping at most \p maxEventsPerThread events per thread.
+   */
+  static void start(size_t maxEventsPerThread = size_t(1) << 20);
+  static void stop();
+
+  /*!
+   * \brief Intern \p name and return its id for the event functions.
+   */
+  static uint32_t name_id(const std::string& name);
+
+  static void begin(uint32_t nameId, trace_category cat);
+  static void end(uint32_t nameId, trace_category cat);
+  static void instant(uint32_t nameId, trace_category cat);
+
+  /*!
+   * \brief Write all the events recorded so far to \p file_name, in the Chrome
+   *        Trace Event JSON format. Returns false if the file can not be written.
+   */
+  static bool write(const std::string& file_name);
+
+  /*!
+   * \brief Drop all the events recorded so far.
+   */
+  static void clear();
+};
+
+/*!
+ * \brief Scoped begin/end event pair, recorded only if the tracer is enabled
+ *        when the scope is entered.
+ */
+class trace_scope
+{
+private:
+  uint32_t nameId_;
+  trace_category cat_;
+  bool enabled_;
+
+public:
+  trace_scope(uint32_t nameId, trace_category cat)
+    : nameId_(nameId), cat_(cat), enabled_(tracer::enabled())
+  {
+    if (enabled_)
+      tracer::begin(nameId_, cat_);
+  }
+
+  ~trace_scope()
+  {
+    if (enabled_)
+      tracer::end(nameId_, cat_);
+  }
+
+  trace_scope(const trace_scope&) = delete;
+  trace_scope& operator=(const trace_scope&) = delete;
+};
+
+} // namespace pl_proc
+
+#endif /* TRACER_H */
@@ -0,0 +1,90 @@
+/**
+ * @file   typed_buffer.h
+ *
+ * @author Armin Zare Zadeh ali.a.zarezadeh@gmail.com
+ *         Eric J. Mayo eric@pozicom.net
+ *
+ * @brief   typed_buffer.h includes a statically typed handle to a genVector
+ */
+
+#ifndef TYPED_BUFFER_H
+#define TYPED_BUFFER_H
+
+#include "pmt.h"
+
+#include <cstddef>
+#include <stdexcept>
+
+
+namespace pl_proc {
+
+/*!
+ * \brief Statically typed view of a pmt genVector of T items.
+ *
+ * \details
+ * The type of the underlying genVector is verified once, when the handle is
+ * bound (typically at connect time).  Afterwards the items are accessed through
+ * a plain pointer, without going through the pmt interface or any dynamic_cast.
+ * The handle shares ownership of the genVector, and since a genVector never
+ * changes its length the cached pointer stays valid as long as the handle lives.
+ */
+template <class T>
+class typed_buffer
+{
+private:
+  pmt::pmt_t items_;
+  T* data_;
+  size_t size_;
+
+public:
+  typed_buffer() : data_(nullptr), size_(0) {}
+
+  explicit typed_buffer(const pmt::pmt_t& items) : data_(nullptr), size_(0) { bind(items); }
+
+  /*!
+   * \brief Bind the handle to \p items after checking it is a genVector of T.
+   *        Throws std::invalid_argument otherwise.
+   */
+  void bind(const pmt::pmt_t& items)
+  {
+    if (!items || !pmt::is_genVector<T>(items))
+      throw std::invalid_argument("pmt data must be generic vector (genVector) of the expected item type");
+
+    size_t len = 0;
+    data_ = pmt::genVector_writable_elements<T>(items, len);
+    size_ = len;
+    items_ = items;
+  }
+
+  /*!
+   * \brief Bind the handle to \p items unless it already is; the common case
+   *        costs a single pointer compare.
+   */
+  void rebind(const pmt::pmt_t& items)
+  {
+    if (items.get() != items_.get())
+      bind(items);
+  }
+
+  bool is_bound() const { return items_ != nullptr; }
+  bool is_bound_to(const pmt::pmt_t& items) const { return items_ && items.get() == items_.get(); }
+
+  const pmt::pmt_t& items() const { return items_; }
+  static constexpr pmt::DataType data_type() { return pmt::genVector_traits<T>::type; }
+
+  T* data() { return data_; }
+  const T* data() const { return data_; }
+  size_t size() const { return size_; }
+
+  T& operator[](size_t k) { return data_[k]; }
+  const T& operator[](size_t k) const { return data_[k]; }
+
+  T* begin() { return data_; }
+  T* end() { return data_ + size_; }
+  const T* begin() const { return data_; }
+  const T* end() const { return data_ + size_; }
+};
+
+} // namespace pl_proc
+
+#endif /* TYPED_BUFFER_H */
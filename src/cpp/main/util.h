@@ -28,6 +28,7 @@
 #include "logging.h"
 
 #include <chrono>
+#include <ctime>
 #include <iomanip>
 #include <iterator>
 #include <mutex>
@@ -39,27 +40,63 @@
 #include <fstream>
 
 
-inline std::string getTimestamp() {
-  // get a precise timestamp as a string
-  const auto now = std::chrono::system_clock::now();
+/// Thread safe std::localtime.
+inline std::tm local_time(std::time_t t) {
+  std::tm tm{};
+#if defined(_WIN32)
+  localtime_s(&tm, &t);
+#else
+  localtime_r(&t, &tm);
+#endif
+  return tm;
+}
+
+inline std::string getTimestamp(const std::chrono::system_clock::time_point& now) {
+  // get a precise timestamp as a string; the calendar part is only formatted
+  // (put_time / localtime) once per second and thread
+  thread_local std::time_t cachedTimeT = -1;
+  thread_local std::string cachedPrefix;
+
   const auto nowAsTimeT = std::chrono::system_clock::to_time_t(now);
   const auto nowMs = std::chrono::duration_cast<std::chrono::milliseconds>(
       now.time_since_epoch()) % 1000;
-  std::stringstream nowSs;
-//  nowSs << std::put_time(std::localtime(&nowAsTimeT), "%c");
-  nowSs
-      << std::put_time(std::localtime(&nowAsTimeT), "%c")
-      << '.' << std::setfill('0') << std::setw(3) << nowMs.count();
+  if (nowAsTimeT != cachedTimeT) {
+    const std::tm tm = local_time(nowAsTimeT);
+    std::stringstream nowSs;
+    nowSs << std::put_time(&tm, "%c");
+    cachedPrefix = nowSs.str();
+    cachedTimeT = nowAsTimeT;
+  }
 
-  return nowSs.str();
+  const int ms = static_cast<int>(nowMs.count());
+  std::string ts;
+  ts.reserve(cachedPrefix.size() + 4);
+  ts += cachedPrefix;
+  ts += '.';
+  ts += static_cast<char>('0' + ms / 100);
+  ts += static_cast<char>('0' + ms / 10 % 10);
+  ts += static_cast<char>('0' + ms % 10);
+  return ts;
+}
+
+inline std::string getTimestamp() {
+  return getTimestamp(std::chrono::system_clock::now());
 }
 
 inline std::string get_date_string() {
+  // cached per second and thread like getTimestamp
+  thread_local std::time_t cachedTimeT = -1;
+  thread_local std::string cachedDate;
+
   std::time_t now = std::chrono::system_clock::to_time_t(std::chrono::system_clock::now());
-  struct tm tm;
-  char buf[100] = {0};
-  std::strftime(buf, sizeof(buf), "%Y-%m-%d  %H:%M:%S", std::localtime(&now));
-  return std::string{buf};
+  if (now != cachedTimeT) {
+    const std::tm tm = local_time(now);
+    char buf[100] = {0};
+    std::strftime(buf, sizeof(buf), "%Y-%m-%d  %H:%M:%S", &tm);
+    cachedDate = buf;
+    cachedTimeT = now;
+  }
+  return cachedDate;
 }
 
 /// Return the number of milliseconds since the steady clock epoch. NOTE: The
@@ -30,7 +30,8 @@ namespace pl_proc {
                 moduleName,
                 adjacencyConnection,
                 noutput_items,
-                trigStart)
+                trigStart),
+      streamTags_(kStreamTags)
   {
     data_ = pmt::make_genVector<T>(noutput_items, 0);
   }
@@ -54,22 +55,54 @@ namespace pl_proc {
     return tags_;
   }
 
+  template <class T>
+  std::vector<stream_tag> vec_sink_blk<T>::getStreamTags() const
+  {
+    std::lock_guard<std::mutex> locker(mutex_);
+    std::vector<stream_tag> tags;
+    streamTags_.get_in_range(tags, 0, UINT64_MAX);
+    return tags;
+  }
+
+  template <class T>
+  uint64_t vec_sink_blk<T>::getDroppedStreamTags() const
+  {
+    std::lock_guard<std::mutex> locker(mutex_);
+    return streamTags_.dropped();
+  }
+
   template <class T>
   void vec_sink_blk<T>::reset()
   {
     std::lock_guard<std::mutex> locker(mutex_);
     tags_.clear();
+    streamTags_.clear();
     pmt::genVector_fill<T>(data_, 0);
   }
 
+  template <class T>
+  bool vec_sink_blk<T>::bindInput(const std::string& port, const pmt::pmt_t& items)
+  {
+    if (port != "Proc")
+      return false;
+
+    std::lock_guard<std::mutex> locker(mutex_);
+    in_.bind(items);
+    return true;
+  }
+
   template <class T>
   void vec_sink_blk<T>::process(pmt::pmt_t& input_items)
   {
-    const T* inVec = pmt::genVector_raw<T>(input_items);
+    in_.rebind(input_items);
+    const T* inVec = in_.data();
 
     // can't touch this (as long as process() is working, the accessors shall not
     // read the data
     std::lock_guard<std::mutex> locker(mutex_);
+    get_tags_in_window(windowTags_, TAG_PORT_PROC, 0, noutput_items_);
+    for (auto const& t : windowTags_)
+      streamTags_.push(t);
 //    for (unsigned int i = 0; i < noutput_items_; i++)
 //      data_.push_back(iptr[i]);
   }
@@ -16,6 +16,7 @@
 #define VECTOR_SINK_H
 
 #include "processor.h"
+#include "typed_buffer.h"
 
 namespace pl_proc {
 
@@ -28,9 +29,15 @@ class vec_sink_blk : public processor
 private:
   pmt::pmt_t data_;
   std::vector<tag_t> tags_;
+  tag_ring streamTags_;                //< the last kStreamTags stream tags received
+  std::vector<stream_tag> windowTags_; //< the ones of the last packet, kept for their capacity
+  typed_buffer<T> in_;
 
 
 public:
+  //! Number of stream tags a sink keeps, the oldest ones are dropped
+  static constexpr size_t kStreamTags = 1024;
+
   vec_sink_blk(ObjectIDModuleIndexType moduleIndex,
                const std::string& moduleName,
                const std::list<std::tuple<std::string, std::string, std::string>>& adjacencyConnection,
@@ -41,9 +48,12 @@ public:
   void reset();
   pmt::pmt_t getData() const;
   std::vector<tag_t> getTags() const;
+  std::vector<stream_tag> getStreamTags() const;
+  uint64_t getDroppedStreamTags() const;
   void setInput1(pmt::pmt_t& input_items1) override { return; };
   void start() override { return; };
   bool getDone() override { return true; };
+  bool bindInput(const std::string& port, const pmt::pmt_t& items) override;
   void process(pmt::pmt_t& input_items) override;
 };
 
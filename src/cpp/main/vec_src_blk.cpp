@@ -47,8 +47,10 @@ vec_src_blk<T>::vec_src_blk(ObjectIDModuleIndexType moduleIndex,
     throw std::invalid_argument("pmt data must be generic vector (genVector)");
 
   dataType_= pmt::getType_genVector<T>(data);
+  dataBuf_.bind(data_);
 
   output_items_ = pmt::make_genVector<T>(noutput_items_);
+  out_.bind(output_items_);
 
   if ((pmt::getLength_genVector<T>(data) % vlen) != 0)
     throw std::invalid_argument("data length must be a multiple of vlen");
@@ -62,25 +64,56 @@ vec_src_blk<T>::~vec_src_blk()
 template <class T>
 void vec_src_blk<T>::setData(const pmt::pmt_t& data)
 {
+  dataBuf_.bind(data);
   data_ = data;
   rewind();
 }
 
+template <class T>
+bool vec_src_blk<T>::setSourceTags(const std::vector<stream_tag>& tags)
+{
+  srcTags_ = tags;
+  std::stable_sort(srcTags_.begin(), srcTags_.end(), stream_tag::offset_compare);
+  return true;
+}
+
+template <class T>
+void vec_src_blk<T>::addSourceTags(unsigned int begin, unsigned int end, uint64_t offset)
+{
+  stream_tag first{begin, nullptr, nullptr, 0};
+  for (auto it = std::lower_bound(srcTags_.begin(), srcTags_.end(), first, stream_tag::offset_compare);
+       it != srcTags_.end() && it->offset_ < end; ++it) {
+    add_item_tag(offset + (it->offset_ - begin), it->key_, it->value_);
+  }
+}
+
 template <class T>
 void vec_src_blk<T>::start()
 {
-  size_t len = 0;
-  const T* inVec = pmt::genVector_elements<T>(data_, len);
-  T* outVec = pmt::genVector_writable_elements<T>(output_items_, len);
+  const T* inVec = dataBuf_.data();
+  T* outVec = out_.data();
 
   if (repeat_) {
-    unsigned int size = pmt::getLength_genVector<T>(data_);
+    unsigned int size = dataBuf_.size();
     unsigned int offset = offset_;
     if (size == 0) {
   	  done_ = true;
       return;
     }
 
+    if (!srcTags_.empty()) {
+      // the packet covers the data from offset_ on, wrapping around as often as needed
+      uint64_t itemOffset = getNitemsWritten();
+      unsigned int pos = offset_;
+      for (unsigned int left = noutput_items_; left > 0; ) {
+        const unsigned int run = std::min(left, size - pos);
+        addSourceTags(pos, pos + run, itemOffset);
+        itemOffset += run;
+        left -= run;
+        pos = (pos + run) % size;
+      }
+    }
+
     for (int i = 0; i < static_cast<int>(noutput_items_ * vlen_); i++) {
    	  outVec[i] = inVec[offset++];
       if (offset >= size) {
@@ -93,16 +126,18 @@ void vec_src_blk<T>::start()
     emitNewData();
     return;
   } else {
-    if (offset_ >= pmt::getLength_genVector<T>(data_)) {
+    if (offset_ >= dataBuf_.size()) {
       done_ =  true;
       return; // Done!
     }
 
-    unsigned n = std::min((unsigned)pmt::getLength_genVector<T>(data_) - offset_,
+    unsigned n = std::min((unsigned)dataBuf_.size() - offset_,
                           (unsigned)noutput_items_);
     for (unsigned i = 0; i < n; i++) {
    	  outVec[i] = inVec[offset_ + i];
     }
+    if (!srcTags_.empty())
+      addSourceTags(offset_, offset_ + n, getNitemsWritten());
     offset_ += n;
 
     emitNewTag(dataType_);
@@ -17,6 +17,7 @@
 #define VECTOR_SOURCE_H
 
 #include "processor.h"
+#include "typed_buffer.h"
 
 namespace pl_proc {
 
@@ -27,7 +28,8 @@ namespace pl_proc {
  * This block produces a stream of samples based on an input
  * vector. The data can repeat infinitely
  * until the flowgraph is terminated by some other event or, the
- * default, run the data once and stop.
+ * default, run the data once and stop. Stream tags set on items of the
+ * data are added to the output every time these items are streamed.
  */
 template <class T>
 class vec_src_blk : public processor
@@ -35,10 +37,15 @@ class vec_src_blk : public processor
 private:
   pmt::DataType dataType_;
   pmt::pmt_t data_;
+  typed_buffer<T> dataBuf_;
+  typed_buffer<T> out_;
   bool repeat_;
   unsigned int offset_;
   unsigned int vlen_;
   bool done_;
+  std::vector<stream_tag> srcTags_; //< sorted by their item index in data_
+
+  void addSourceTags(unsigned int begin, unsigned int end, uint64_t offset);
 
 public:
   vec_src_blk(ObjectIDModuleIndexType moduleIndex,
@@ -54,6 +61,7 @@ public:
   void rewind() { offset_ = 0; }
   void setData(const pmt::pmt_t& data);
   void setRepeat(bool repeat) { repeat_ = repeat; };
+  bool setSourceTags(const std::vector<stream_tag>& tags) override;
   void setInput1(pmt::pmt_t& input_items1) override { return; };  
   void start() override;  
   bool getDone() override { return done_; };
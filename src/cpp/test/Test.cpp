@@ -3,10 +3,702 @@
  * @brief  Unit test for Pipeline Processing Pipeline Framework.
  */
 
-#include <gtest\gtest.h>
+#include <gtest/gtest.h>
+
+#include "event_log.h"
+#include "event_log_format.h"
+#include "input_aligner.h"
+#include "object_id_map.h"
+#include "reorder_buffer.h"
+#include "replica_group.h"
+#include "seq_tracker.h"
+#include "signal_slot.h"
+#include "stream_tags.h"
+#include "tags.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
 
 namespace pl_proc {
 
-// TBD
+/*!
+ * \brief Reorder buffer of sequence numbers, recording the ones it releases
+ */
+struct reorder_fixture
+{
+  reorder_buffer<ObjectIDPaketSeqType> buffer;
+  std::vector<ObjectIDPaketSeqType> out;
+
+  explicit reorder_fixture(size_t window) : buffer(window) {}
+
+  void arrive(ObjectIDPaketSeqType seq)
+  {
+    auto release = [this](ObjectIDPaketSeqType s, const ObjectIDPaketSeqType& item) { EXPECT_EQ(s, item); out.push_back(item); };
+    switch (buffer.arrive(seq, release)) {
+    case reorder_event::IN_ORDER:
+      out.push_back(seq);
+      buffer.advance(release);
+      break;
+    case reorder_event::BUFFERED:
+      buffer.item(seq) = seq;
+      break;
+    case reorder_event::LATE:
+      break;
+    }
+  }
+
+  void flush()
+  {
+    buffer.flush([this](ObjectIDPaketSeqType, const ObjectIDPaketSeqType& item) { out.push_back(item); });
+  }
+};
+
+TEST(ReorderBuffer, RestoresOrder)
+{
+  reorder_fixture f(8);
+  for (ObjectIDPaketSeqType seq : {0, 2, 3, 1, 5, 4})
+    f.arrive(seq);
+  EXPECT_EQ(f.out, (std::vector<ObjectIDPaketSeqType>{0, 1, 2, 3, 4, 5}));
+  EXPECT_EQ(f.buffer.stats().buffered_, 3u);
+  EXPECT_EQ(f.buffer.stats().maxDepth_, 2u);
+  EXPECT_EQ(f.buffer.depth(), 0u);
+}
+
+TEST(ReorderBuffer, DropsLateAndDuplicatePakets)
+{
+  reorder_fixture f(8);
+  f.arrive(0);
+  f.arrive(1);
+  f.arrive(3);
+  f.arrive(3); // duplicate of a buffered packet
+  f.arrive(0); // behind the order
+  f.arrive(2);
+  EXPECT_EQ(f.out, (std::vector<ObjectIDPaketSeqType>{0, 1, 2, 3}));
+  EXPECT_EQ(f.buffer.stats().late_, 2u);
+  EXPECT_EQ(f.buffer.stats().lost_, 0u);
+}
+
+TEST(ReorderBuffer, JumpBeyondWindowReleasesBuffered)
+{
+  reorder_fixture f(4);
+  f.arrive(0);
+  f.arrive(2);
+  f.arrive(7); // 1 is given up, 2 released, then 3 is lost to make room
+  EXPECT_EQ(f.out, (std::vector<ObjectIDPaketSeqType>{0, 2}));
+  EXPECT_EQ(f.buffer.stats().lost_, 2u);
+  EXPECT_EQ(f.buffer.next(), 4u);
+  f.arrive(4);
+  f.arrive(5);
+  f.arrive(6);
+  EXPECT_EQ(f.out, (std::vector<ObjectIDPaketSeqType>{0, 2, 4, 5, 6, 7}));
+}
+
+TEST(ReorderBuffer, FarJumpMovesWindowAtOnce)
+{
+  reorder_fixture f(64);
+  f.arrive(0);
+  const ObjectIDPaketSeqType far = ObjectIDPaketSeqType(1) << 62;
+  f.arrive(far); // must not step through the missing sequence numbers one by one
+  EXPECT_EQ(f.buffer.stats().lost_, far - 64);
+  EXPECT_EQ(f.buffer.depth(), 1u);
+  f.flush();
+  EXPECT_EQ(f.out, (std::vector<ObjectIDPaketSeqType>{0, far}));
+  EXPECT_EQ(f.buffer.stats().lost_, far - 1);
+}
+
+TEST(ReorderBuffer, FlushGivesUpOnMissing)
+{
+  reorder_fixture f(8);
+  f.arrive(0);
+  f.arrive(2);
+  f.arrive(5);
+  f.flush();
+  EXPECT_EQ(f.out, (std::vector<ObjectIDPaketSeqType>{0, 2, 5}));
+  EXPECT_EQ(f.buffer.stats().lost_, 3u);
+  EXPECT_EQ(f.buffer.depth(), 0u);
+  f.arrive(1);
+  EXPECT_EQ(f.buffer.stats().late_, 1u);
+}
+
+/*!
+ * \brief Processor node emitting a single item per packet, or recording the packets
+ *        it merges (its In1 item, its Proc item)
+ */
+class test_node : public processor
+{
+private:
+  ObjectIDPaketSeqType started_;
+  uint64_t in1_;
+
+public:
+  std::vector<std::pair<uint64_t, uint64_t>> merged_;
+
+  explicit test_node(ObjectIDModuleIndexType index)
+    : processor(static_cast<ObjectIDModuleType>(ModuleType::ADDER_MODULE), index, "node" + std::to_string(index), {}, 1, false),
+      started_(0),
+      in1_(~uint64_t(0))
+  {
+    output_items_ = pmt::make_genVector<uint64_t>(1, 0);
+  }
+
+  //! Start packet \p seq, skipping the ones before it, holding the item \p seq
+  pmt::pmt_t& paket(ObjectIDPaketSeqType seq)
+  {
+    while (started_ <= seq) {
+      passPaket();
+      started_++;
+    }
+    size_t len = 0;
+    static_cast<uint64_t*>(pmt::uniform_vector_writable_elements(output_items_, len))[0] = seq;
+    return output_items_;
+  }
+
+  static uint64_t item(const pmt::pmt_t& items)
+  {
+    size_t len = 0;
+    return static_cast<const uint64_t*>(pmt::uniform_vector_elements(items, len))[0];
+  }
+
+  void setInput1(pmt::pmt_t& items) override { in1_ = item(items); }
+  void process(pmt::pmt_t& items) override { merged_.emplace_back(in1_, item(items)); }
+  void start() override {}
+  bool getDone() override { return true; }
+};
+
+/*!
+ * \brief Aligner of the Proc port of a node, fed by proc, and of its In1 port, fed by in1
+ */
+struct aligner_fixture
+{
+  std::shared_ptr<test_node> node = std::make_shared<test_node>(0);
+  test_node proc{1};
+  test_node in1{2};
+  input_aligner aligner;
+
+  explicit aligner_fixture(size_t window)
+    : aligner({{node, processor::TAG_PORT_PROC}, {node, processor::TAG_PORT_IN1}},
+              [this](pmt::pmt_t& items) { node->process(items); }, window)
+  {
+  }
+
+  void deliverProc(ObjectIDPaketSeqType seq) { aligner.deliver(0, proc, proc.paket(seq)); }
+  void deliverIn1(ObjectIDPaketSeqType seq) { aligner.deliver(1, in1, in1.paket(seq)); }
+
+  bool aligned() const
+  {
+    for (auto const& m : node->merged_) {
+      if (m.first != m.second)
+        return false;
+    }
+    return true;
+  }
+};
+
+TEST(InputAligner, AlignsOutOfOrderPorts)
+{
+  aligner_fixture f(8);
+  for (ObjectIDPaketSeqType seq = 0; seq < 4; seq++)
+    f.deliverProc(seq); // the Proc port runs ahead of In1
+  EXPECT_TRUE(f.node->merged_.empty());
+  for (ObjectIDPaketSeqType seq = 0; seq < 4; seq++)
+    f.deliverIn1(seq);
+  ASSERT_EQ(f.node->merged_.size(), 4u);
+  EXPECT_TRUE(f.aligned());
+  EXPECT_EQ(f.node->merged_.back().second, 3u);
+  EXPECT_EQ(f.aligner.getPakets(), 4u);
+  EXPECT_EQ(f.aligner.getDropped(), 0u);
+}
+
+TEST(InputAligner, DropsPaketMissingAnInput)
+{
+  aligner_fixture f(4);
+  for (ObjectIDPaketSeqType seq = 0; seq < 4; seq++)
+    f.deliverIn1(seq);
+  f.deliverProc(0);
+  f.deliverProc(2); // 1 never arrives on Proc
+  f.deliverProc(3);
+  EXPECT_EQ(f.node->merged_.size(), 1u);
+  for (ObjectIDPaketSeqType seq = 4; seq < 6; seq++) {
+    f.deliverIn1(seq); // a window ahead of packet 1: it is given up
+    f.deliverProc(seq);
+  }
+  EXPECT_EQ(f.aligner.getDropped(), 1u);
+  EXPECT_EQ(f.node->merged_.size(), 5u);
+  EXPECT_TRUE(f.aligned());
+  f.deliverProc(1); // late
+  EXPECT_EQ(f.aligner.getLate(), 1u);
+  EXPECT_EQ(f.node->merged_.size(), 5u);
+}
+
+TEST(InputAligner, CountsLateInput)
+{
+  aligner_fixture f(4);
+  f.deliverProc(0);
+  f.deliverIn1(0);
+  f.deliverIn1(0); // duplicate of a processed packet
+  EXPECT_EQ(f.aligner.getLate(), 1u);
+  EXPECT_EQ(f.node->merged_.size(), 1u);
+}
+
+TEST(InputAligner, FlushDropsIncomplete)
+{
+  aligner_fixture f(8);
+  f.deliverProc(0);
+  f.deliverIn1(0);
+  f.deliverProc(1);
+  f.deliverProc(2);
+  f.aligner.flush();
+  EXPECT_EQ(f.aligner.getDropped(), 2u);
+  f.deliverIn1(1);
+  EXPECT_EQ(f.aligner.getLate(), 1u);
+  EXPECT_EQ(f.node->merged_.size(), 1u);
+}
+
+TEST(InputAligner, GivesUpPaketStartedAfterItsTurn)
+{
+  // Proc misses 9 and 13: 9 is skipped before In1 delivers it, which must not
+  // hold its slot when packet 13 comes in on In1
+  aligner_fixture f(4);
+  for (ObjectIDPaketSeqType seq = 0; seq < 9; seq++) {
+    f.deliverProc(seq);
+    f.deliverIn1(seq);
+  }
+  for (ObjectIDPaketSeqType seq : {10, 11, 12, 14, 15, 16})
+    f.deliverProc(seq);
+  for (ObjectIDPaketSeqType seq = 9; seq < 17; seq++)
+    f.deliverIn1(seq);
+  f.aligner.flush();
+  EXPECT_TRUE(f.aligned());
+  // Proc ran a window ahead: 10 to 12 were given up before In1 delivered them, late,
+  // then 9 and 13 which Proc never delivered
+  EXPECT_EQ(f.aligner.getPakets(), 12u);
+  EXPECT_EQ(f.aligner.getDropped(), 5u);
+  EXPECT_EQ(f.aligner.getLate(), 3u);
+  EXPECT_EQ(f.node->merged_.back().second, 16u);
+}
+
+TEST(InputAligner, JumpsFarAhead)
+{
+  aligner_fixture f(4);
+  f.deliverProc(0);
+  f.deliverIn1(0);
+  f.deliverProc(1);
+  const ObjectIDPaketSeqType far = (1 << 20) + 1;
+  f.deliverProc(far); // gives up 1, whose slot it takes
+  EXPECT_EQ(f.aligner.getDropped(), 1u);
+  f.deliverIn1(far);
+  f.aligner.flush();
+  ASSERT_EQ(f.node->merged_.size(), 2u);
+  EXPECT_TRUE(f.aligned());
+  EXPECT_EQ(f.node->merged_.back().second, far);
+  EXPECT_EQ(f.aligner.getDropped(), 1u);
+}
+
+TEST(InputAligner, ConcurrentPortsStayAligned)
+{
+  aligner_fixture f(16);
+  const ObjectIDPaketSeqType pakets = 20000;
+  std::thread in1([&f, pakets] {
+    for (ObjectIDPaketSeqType seq = 0; seq < pakets; seq++)
+      f.deliverIn1(seq);
+  });
+  for (ObjectIDPaketSeqType seq = 0; seq < pakets; seq++)
+    f.deliverProc(seq);
+  in1.join();
+  f.aligner.flush();
+  EXPECT_TRUE(f.aligned());
+  EXPECT_EQ(f.aligner.getPakets() + f.aligner.getDropped(), pakets);
+  for (size_t k = 1; k < f.node->merged_.size(); k++)
+    EXPECT_LT(f.node->merged_[k - 1].second, f.node->merged_[k].second);
+}
+
+TEST(SignalSlot, SizeWhileConnecting)
+{
+  signal_slot<int&> signal;
+  std::atomic<int> running(2);
+  std::vector<std::thread> writers;
+  for (int t = 0; t < 2; t++) {
+    writers.emplace_back([&signal, &running] {
+      for (int k = 0; k < 20000; k++) {
+        const int id = signal.connect([](int& n) { n++; });
+        signal.disconnect(id);
+      }
+      running--;
+    });
+  }
+  // size() must not read a slot vector a concurrent connect or disconnect retired
+  while (running.load() != 0)
+    ASSERT_LE(signal.size(), 2u);
+  for (auto& t : writers)
+    t.join();
+  EXPECT_TRUE(signal.empty());
+
+  int n = 0;
+  signal.connect([](int& n) { n += 2; });
+  signal.emit(n);
+  EXPECT_EQ(signal.size(), 1u);
+  EXPECT_EQ(n, 2);
+}
+
+/*!
+ * \brief Stateless processor node doubling the single item of its packets, slowly
+ *        for some of them so that its replicas complete out of order
+ */
+class double_node : public processor
+{
+public:
+  explicit double_node(ObjectIDModuleIndexType index)
+    : processor(static_cast<ObjectIDModuleType>(ModuleType::ADDER_MODULE), index, "double" + std::to_string(index), {}, 1, false)
+  {
+    output_items_ = pmt::make_genVector<uint64_t>(1, 0);
+  }
+
+  void process(pmt::pmt_t& items) override
+  {
+    const uint64_t item = test_node::item(items);
+    if (item % 3 == 0)
+      std::this_thread::sleep_for(std::chrono::microseconds(50));
+    size_t len = 0;
+    static_cast<uint64_t*>(pmt::uniform_vector_writable_elements(output_items_, len))[0] = 2 * item;
+  }
+
+  void setInput1(pmt::pmt_t&) override {}
+  void start() override {}
+  bool getDone() override { return true; }
+  bool isStateless() const override { return true; }
+};
+
+TEST(ReplicaGroup, MergesReplicasInOrder)
+{
+  auto primary = std::make_shared<double_node>(0);
+  std::vector<processor::sptr> replicas;
+  for (ObjectIDModuleIndexType r = 1; r <= 3; r++)
+    replicas.push_back(std::make_shared<double_node>(r));
+  std::vector<uint64_t> out;
+  primary->getOnNewDataGen()->connect([&out](pmt::pmt_t& items) { out.push_back(test_node::item(items)); });
+
+  test_node src(4);
+  const ObjectIDPaketSeqType pakets = 200;
+  {
+    replica_group group(primary, replicas, replica_dispatch::ROUND_ROBIN, tag_propagation_policy::DONT, 8);
+    group.addInput(processor::TAG_PORT_PROC);
+    for (ObjectIDPaketSeqType seq = 0; seq < pakets; seq++)
+      group.deliver(processor::TAG_PORT_PROC, src, src.paket(seq));
+    group.drain();
+
+    uint64_t processed = 0;
+    for (size_t r = 0; r < group.getReplicas(); r++) {
+      EXPECT_GT(group.getPakets(r), 0u);
+      processed += group.getPakets(r);
+    }
+    EXPECT_EQ(processed, pakets);
+    EXPECT_EQ(group.getDropped(), 0u);
+    EXPECT_EQ(group.getMergeStats().lost_, 0u);
+  }
+  ASSERT_EQ(out.size(), pakets);
+  for (ObjectIDPaketSeqType seq = 0; seq < pakets; seq++)
+    EXPECT_EQ(out[seq], 2 * seq);
+}
+
+TEST(ReplicaGroup, LeastLoadedSkipsMissingPakets)
+{
+  auto primary = std::make_shared<double_node>(0);
+  std::vector<processor::sptr> replicas{std::make_shared<double_node>(1), std::make_shared<double_node>(2)};
+  std::vector<uint64_t> out;
+  primary->getOnNewDataGen()->connect([&out](pmt::pmt_t& items) { out.push_back(test_node::item(items)); });
+
+  test_node src(3);
+  std::vector<uint64_t> expected;
+  {
+    replica_group group(primary, replicas, replica_dispatch::LEAST_LOADED, tag_propagation_policy::DONT, 4);
+    group.addInput(processor::TAG_PORT_PROC);
+    for (ObjectIDPaketSeqType seq = 0; seq < 100; seq++) {
+      if (seq % 7 == 3)
+        continue; // never delivered
+      group.deliver(processor::TAG_PORT_PROC, src, src.paket(seq));
+      expected.push_back(2 * seq);
+    }
+    group.drain();
+  }
+  EXPECT_EQ(out, expected);
+}
+
+TEST(ObjectIdMap, ResolvesCollisions)
+{
+  object_id_map<uint32_t> map(16);
+  // keys landing in the same slot, as the map hashes them
+  auto slot = [](uint64_t key) { return (key * 0x9e3779b97f4a7c15ull) >> 60; };
+  std::vector<uint64_t> keys;
+  for (uint64_t key = 1; keys.size() < 5; key++) {
+    if (slot(key) == slot(1))
+      keys.push_back(key);
+  }
+  for (size_t k = 0; k < keys.size(); k++)
+    EXPECT_TRUE(map.insert(keys[k], static_cast<uint32_t>(k)));
+  EXPECT_FALSE(map.insert(keys[2], 99)); // already in the map
+  EXPECT_EQ(map.size(), keys.size());
+
+  uint32_t value = 0;
+  for (size_t k = 0; k < keys.size(); k++) {
+    ASSERT_TRUE(map.find(keys[k], value));
+    EXPECT_EQ(value, k);
+  }
+
+  // erasing a key in the middle of the chain must not hide the ones after it
+  EXPECT_TRUE(map.erase(keys[1]));
+  EXPECT_FALSE(map.contains(keys[1]));
+  ASSERT_TRUE(map.find(keys[4], value));
+  EXPECT_EQ(value, 4u);
+  EXPECT_TRUE(map.insert_or_assign(keys[3], 33));
+  ASSERT_TRUE(map.find(keys[3], value));
+  EXPECT_EQ(value, 33u);
+  EXPECT_EQ(map.size(), keys.size() - 1);
+}
+
+TEST(ObjectIdMap, FillsUpAndReusesErasedSlots)
+{
+  object_id_map<uint32_t> map(64);
+  const ObjectID id = ObjectID::ForModuleIndex(*JobRunID::getInstance(), static_cast<ObjectIDModuleType>(ModuleType::ADDER_MODULE), 1, 0);
+  for (uint32_t p = 0; p < map.capacity(); p++)
+    EXPECT_TRUE(map.insert(id.WithPaketIndex(p), p));
+  EXPECT_EQ(map.size(), map.capacity());
+  EXPECT_FALSE(map.insert(id.WithPaketIndex(1000), 1000)); // full
+  EXPECT_FALSE(map.insert(ObjectID::Nil(), 0));            // reserved
+
+  // a sliding window of packets, which leaves tombstones all around the table
+  const uint32_t window = 48;
+  for (uint32_t p = 0; p < map.capacity() - window; p++)
+    EXPECT_TRUE(map.erase(id.WithPaketIndex(p)));
+  for (uint32_t p = map.capacity(); p < 100000; p++) {
+    ASSERT_TRUE(map.insert(id.WithPaketIndex(p), p));
+    ASSERT_TRUE(map.erase(id.WithPaketIndex(p - window)));
+  }
+  EXPECT_EQ(map.size(), window);
+  uint32_t value = 0;
+  for (uint32_t p = 100000 - window; p < 100000; p++) {
+    ASSERT_TRUE(map.find(id.WithPaketIndex(p), value));
+    EXPECT_EQ(value, p);
+  }
+  EXPECT_FALSE(map.contains(id.WithPaketIndex(100000 - window - 1)));
+
+  map.clear();
+  EXPECT_TRUE(map.empty());
+  EXPECT_FALSE(map.contains(id.WithPaketIndex(99999)));
+}
+
+TEST(SeqTracker, CountsGapsLateAndDuplicates)
+{
+  seq_tracker t;
+  EXPECT_EQ(t.observe(10), seq_event::IN_ORDER); // the first packet sets the order
+  EXPECT_EQ(t.observe(11), seq_event::IN_ORDER);
+  EXPECT_EQ(t.observe(14), seq_event::GAP);
+  EXPECT_EQ(t.missing(), 2u);
+  EXPECT_EQ(t.observe(12), seq_event::LATE);
+  EXPECT_EQ(t.observe(12), seq_event::DUPLICATE);
+  EXPECT_EQ(t.observe(14), seq_event::DUPLICATE);
+  EXPECT_EQ(t.observe(15), seq_event::IN_ORDER);
+  EXPECT_EQ(t.received(), 7u);
+  EXPECT_EQ(t.gaps(), 1u);
+  EXPECT_EQ(t.missing(), 1u);
+  EXPECT_EQ(t.late(), 1u);
+  EXPECT_EQ(t.duplicates(), 2u);
+  EXPECT_EQ(t.next(), 16u);
+  EXPECT_FALSE(t.in_order());
+
+  // beyond the window a packet can only be told late
+  EXPECT_EQ(t.observe(15 + seq_tracker::kWindow + 10), seq_event::GAP);
+  EXPECT_EQ(t.observe(11), seq_event::LATE);
+}
+
+TEST(SeqTracker, UnwrapsPaketIndices)
+{
+  seq_tracker t;
+  const ObjectIDPaketSeqType base = 0xfffffffeull;
+  for (ObjectIDPaketSeqType seq = base; seq < base + 4; seq++)
+    EXPECT_EQ(t.observe_index(static_cast<ObjectIDPaketIndexType>(seq)), seq_event::IN_ORDER);
+  EXPECT_EQ(t.last(), base + 3);
+  EXPECT_TRUE(t.in_order());
+  EXPECT_TRUE(seq_before(0xffffffffu, 0u));
+  EXPECT_EQ(seq_unwrap(1, 0xffffffffull), 0x100000001ull);
+  EXPECT_EQ(seq_unwrap(0xffffffffu, 0x100000001ull), 0xffffffffull);
+}
+
+TEST(TagRing, KeepsTagsSortedAndDropsOldest)
+{
+  tag_ring ring(4);
+  const pmt::pmt_t key = pmt::intern("test_key");
+  for (uint64_t offset : {10, 30, 20, 40, 50})
+    ring.push(stream_tag{offset, key, pmt::from_uint64(offset), 0});
+  EXPECT_EQ(ring.size(), 4u);
+  EXPECT_EQ(ring.dropped(), 1u);
+
+  std::vector<stream_tag> tags;
+  ring.get_in_range(tags, 0, 100);
+  ASSERT_EQ(tags.size(), 4u);
+  for (size_t k = 0; k < tags.size(); k++)
+    EXPECT_EQ(tags[k].offset_, 20 + 10 * k); // 10 dropped, 20 inserted in place
+
+  tags.clear();
+  ring.get_in_range(tags, 30, 50, pmt::intern("other_key"));
+  EXPECT_TRUE(tags.empty());
+  ring.get_in_range(tags, 30, 50, key);
+  EXPECT_EQ(tags.size(), 2u);
+
+  ring.prune(40);
+  EXPECT_EQ(ring.size(), 2u);
+  EXPECT_EQ(ring[0].offset_, 40u);
+  tag_ring copy;
+  ring.copy_range(copy, 0, 100, -40);
+  EXPECT_EQ(copy[1].offset_, 10u);
+  ring.clear();
+  EXPECT_TRUE(ring.empty());
+}
+
+TEST(Pmt, InternsSymbolsConcurrently)
+{
+  // more symbols than the initial table holds, so that it grows under the threads
+  const size_t names = 5000;
+  std::vector<std::vector<pmt::pmt_t>> symbols(4);
+  std::vector<std::thread> threads;
+  for (size_t t = 0; t < symbols.size(); t++) {
+    threads.emplace_back([&symbols, t, names] {
+      for (size_t k = 0; k < names; k++)
+        symbols[t].push_back(pmt::intern("test_symbol_" + std::to_string((k + 997 * t) % names)));
+    });
+  }
+  for (auto& t : threads)
+    t.join();
+
+  for (size_t k = 0; k < names; k++) {
+    const pmt::pmt_t sym = pmt::intern("test_symbol_" + std::to_string(k));
+    EXPECT_EQ(pmt::symbol_to_string(sym), "test_symbol_" + std::to_string(k));
+    for (size_t t = 0; t < symbols.size(); t++)
+      ASSERT_EQ(symbols[t][(k + names - 997 * t % names) % names].get(), sym.get());
+  }
+}
+
+/*!
+ * \brief Event record of packet \p p, holding \p n items of a run of equal bytes
+ */
+static event_record test_record(ObjectIDPaketIndexType p, size_t n)
+{
+  event_record rec;
+  rec.stamp_ = std::chrono::system_clock::time_point(std::chrono::nanoseconds(1600000000000000000ll + p));
+  rec.timetag_ = 1000 + p;
+  rec.offset_ = 64 * p;
+  rec.key_ = ObjectID::ForModuleIndex(*JobRunID::getInstance(), static_cast<ObjectIDModuleType>(ModuleType::ADDER_MODULE), 2, p);
+  rec.valueDataType_ = pmt::DataType::GVEC_UINT8;
+  for (size_t k = 0; k < n; k++)
+    rec.payload_.push_back(static_cast<uint8_t>(k < n / 2 ? 7 : k));
+  return rec;
+}
+
+static void expect_same(const event_record& a, const event_record& b)
+{
+  EXPECT_EQ(a.stamp_, b.stamp_);
+  EXPECT_EQ(a.timetag_, b.timetag_);
+  EXPECT_EQ(a.offset_, b.offset_);
+  EXPECT_EQ(a.key_, b.key_);
+  EXPECT_EQ(a.valueDataType_, b.valueDataType_);
+  EXPECT_EQ(a.payload_, b.payload_);
+}
+
+TEST(EventLogFormat, BinaryRoundTrip)
+{
+  for (bool compress : {false, true}) {
+    std::string out;
+    write_binary_header(out);
+    std::vector<event_record> recs{test_record(0, 0), test_record(1, 1), test_record(2, 300)};
+    for (auto const& rec : recs)
+      encode_binary(out, rec, compress);
+
+    std::istringstream is(out);
+    ASSERT_EQ(read_binary_header(is), kEventLogVersion);
+    event_record rec;
+    for (auto const& expected : recs) {
+      ASSERT_TRUE(decode_binary(is, rec));
+      expect_same(rec, expected);
+    }
+    EXPECT_FALSE(decode_binary(is, rec));
+  }
+}
+
+TEST(EventLogFormat, PackBitsRoundTrip)
+{
+  std::vector<uint8_t> raw(1000, 0);
+  for (size_t k = 500; k < raw.size(); k++)
+    raw[k] = static_cast<uint8_t>(k * 31);
+  std::string packed;
+  packbits_encode(raw.data(), raw.size(), packed);
+  EXPECT_LT(packed.size(), raw.size());
+  std::vector<uint8_t> unpacked;
+  ASSERT_TRUE(packbits_decode(reinterpret_cast<const uint8_t*>(packed.data()), packed.size(), raw.size(), unpacked));
+  EXPECT_EQ(unpacked, raw);
+  EXPECT_FALSE(packbits_decode(reinterpret_cast<const uint8_t*>(packed.data()), packed.size() - 1, raw.size(), unpacked));
+}
+
+TEST(EventLogFormat, RejectsTruncatedRecord)
+{
+  std::string out;
+  write_binary_header(out);
+  encode_binary(out, test_record(3, 40), false);
+  out.resize(out.size() - 10);
+  std::istringstream is(out);
+  ASSERT_EQ(read_binary_header(is), kEventLogVersion);
+  event_record rec;
+  EXPECT_THROW(decode_binary(is, rec), std::runtime_error);
+
+  std::istringstream csv("Time,Timetag\n");
+  EXPECT_EQ(read_binary_header(csv), 0);
+}
+
+TEST(EventLog, WritesEveryPushedTag)
+{
+  const std::string file = "unit_test_event_log.bin";
+  const size_t pakets = 3000; // a few laps of the ring
+  std::vector<event_record> expected;
+  {
+    event_log log;
+    ASSERT_TRUE(log.open(file, EventLogFormat::BINARY_RLE));
+    const ObjectID id = ObjectID::ForModuleIndex(*JobRunID::getInstance(), static_cast<ObjectIDModuleType>(ModuleType::ADDER_MODULE), 5, 0);
+    pmt::pmt_t value = pmt::make_genVector<uint32_t>(16, 0);
+    for (size_t p = 0; p < pakets; p++) {
+      size_t len = 0;
+      static_cast<uint32_t*>(pmt::uniform_vector_writable_elements(value, len))[p % 16] = static_cast<uint32_t>(p);
+      tag_t tag(static_cast<int64_t>(p), id.WithPaketIndex(p), pmt::DataType::GVEC_UINT32, value, 16 * p);
+      expected.emplace_back();
+      event_log::snapshot(tag, expected.back());
+      if (p % 2)
+        log.push(tag);
+      else
+        log.push(tag_span{&tag, 1});
+      if (p == pakets / 2)
+        log.flush();
+    }
+    log.close();
+  }
+
+  std::ifstream is(file, std::ios::binary);
+  ASSERT_EQ(read_binary_header(is), kEventLogVersion);
+  event_record rec;
+  for (auto const& e : expected) {
+    ASSERT_TRUE(decode_binary(is, rec));
+    EXPECT_EQ(rec.timetag_, e.timetag_);
+    EXPECT_EQ(rec.offset_, e.offset_);
+    EXPECT_EQ(rec.key_, e.key_);
+    EXPECT_EQ(rec.payload_, e.payload_);
+  }
+  EXPECT_FALSE(decode_binary(is, rec));
+  is.close();
+  std::remove(file.c_str());
+}
 
 } // namespace pl_proc
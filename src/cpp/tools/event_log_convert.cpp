@@ -0,0 +1,85 @@
+/**
+ * @file   event_log_convert.cpp
+ *
+ * @author Armin Zare Zadeh ali.a.zarezadeh@gmail.com
+ *         Eric J. Mayo eric@pozicom.net
+ *
+ * @brief   event_log_convert.cpp includes an offline converter of the binary
+ *          tag event log (pl_event_*.bin) into the CSV or JSON layout.
+ *
+ * Usage: event_log_convert [--csv | --json] <pl_event_X.bin> [<output file>]
+ *
+ * The CSV output has the same layout as the text event log; the JSON output is
+ * an array with one object per tag. Without an output file it writes to stdout.
+ */
+
+#include "event_log_format.h"
+
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+
+
+int main(int argc, char* argv[])
+{
+  bool json = false;
+  int arg = 1;
+  if (arg < argc && std::strcmp(argv[arg], "--json") == 0) {
+    json = true;
+    arg++;
+  } else if (arg < argc && std::strcmp(argv[arg], "--csv") == 0) {
+    arg++;
+  }
+
+  if (arg >= argc || argc - arg > 2) {
+    std::cerr << "Usage: " << argv[0] << " [--csv | --json] <pl_event_X.bin> [<output file>]\n";
+    return 1;
+  }
+
+  std::ifstream fin(argv[arg], std::ios::in | std::ios::binary);
+  if (!fin) {
+    std::cerr << "Can not open " << argv[arg] << "\n";
+    return 1;
+  }
+  const int version = pl_proc::read_binary_header(fin);
+  if (version == 0) {
+    std::cerr << argv[arg] << " is not a binary event log\n";
+    return 1;
+  }
+
+  std::ofstream fout;
+  if (argc - arg == 2) {
+    fout.open(argv[arg + 1], std::ios::out | std::ios::trunc);
+    if (!fout) {
+      std::cerr << "Can not open " << argv[arg + 1] << "\n";
+      return 1;
+    }
+  }
+  std::ostream& os = fout.is_open() ? fout : std::cout;
+
+  size_t nrecords = 0;
+  try {
+    pl_proc::event_record rec;
+    if (json) os << "[";
+    else      pl_proc::write_csv_header(os);
+
+    while (pl_proc::decode_binary(fin, rec, version)) {
+      if (json) {
+        os << (nrecords ? ",\n " : "\n ");
+        pl_proc::format_json(os, rec);
+      } else {
+        pl_proc::format_csv(os, rec);
+      }
+      nrecords++;
+    }
+
+    if (json) os << "\n]\n";
+  }
+  catch (const std::runtime_error& e) {
+    std::cerr << argv[arg] << ": record " << nrecords << ": " << e.what() << "\n";
+    return 1;
+  }
+
+  return 0;
+}